@@ -1,13 +1,10 @@
-use std::{
-    ffi::CString,
-    io::{self, BufRead, BufReader},
-    mem,
-    os::unix::{net::UnixStream, prelude::AsRawFd},
-    thread,
-};
+use std::{io, ptr};
 
 use rte_error::ReturnValue as _;
-use tracing::*;
+
+pub use crate::log::{log_stats, LogConfig, LogStats};
+
+mod log;
 
 #[derive(thiserror::Error, Debug)]
 pub enum Error {
@@ -18,41 +15,28 @@ pub enum Error {
     Rte(#[from] rte_error::Error),
 }
 
-/// Set up unix stream for RTE logs (instead of stderr), spawn a thread for reading logs
-/// and writing them through global logging mechanism.
-fn init_log_reader() -> Result<(), Error> {
-    let (tx, rx) = UnixStream::pair()?;
-
-    unsafe {
-        let mode = CString::new("w").unwrap();
-        let fd = libc::fdopen(tx.as_raw_fd(), mode.as_ptr());
-        ffi::rte_openlog_stream(fd as *mut _).rte_ok()?;
-    }
-
-    // prevent the fd rte uses for logging from being dropped, which would
-    // cause it to be closed
-    mem::forget(tx);
-
-    thread::spawn(|| {
-        let mut logs = BufReader::new(rx).lines();
-        while let Some(Ok(log)) = logs.next() {
-            info!(target: "ddosd::rte", "{log}");
-        }
-    });
-
-    Ok(())
-}
-
 /// Initializes EAL by calling [`rte_eal_init`](https://doc.dpdk.org/api/rte__eal_8h.html#a5c3f4dddc25e38c5a186ecd8a69260e3),
 /// passing in the provided command line arguments, and returning an
 /// [`Iterator<Item = String>`](Iterator) of the arguments, skipping the ones
 /// "digested" by EAL.
+///
+/// DPDK's logs are forwarded to `tracing` using the default [`LogConfig`].
+#[inline]
 pub fn init<A, S>(args: A) -> Result<impl Iterator<Item = String>, Error>
 where
     A: IntoIterator<Item = S>,
     S: Into<String>,
 {
-    init_log_reader()?;
+    init_with_log_config(args, LogConfig::default())
+}
+
+/// Initializes EAL, see [`init`], forwarding DPDK's logs to `tracing` as configured by `log_config`.
+pub fn init_with_log_config<A, S>(args: A, log_config: LogConfig) -> Result<impl Iterator<Item = String>, Error>
+where
+    A: IntoIterator<Item = S>,
+    S: Into<String>,
+{
+    log::init_log_stream(log_config)?;
 
     let args = args.into_iter().map(S::into).collect::<Vec<_>>();
 
@@ -66,3 +50,33 @@ where
 
     Ok(args.into_iter().skip(args_read as usize))
 }
+
+/// The role of this process in a group of DPDK processes sharing the same hugepage memory (see `--proc-type`).
+///
+/// The primary process creates the shared resources (memory pools, rings, and devices), which secondary processes
+/// can then attach to, e.g. a new version of the primary taking over the data plane (while the devices and memory
+/// pools remain initialized), or a tool reading statistics or capturing packets.
+///
+/// See also: <https://doc.dpdk.org/guides-21.08/prog_guide/multi_proc_support.html>
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ProcessType {
+    Primary,
+    Secondary,
+}
+
+/// Returns the type of this process, or `None` if EAL hasn't been initialized.
+#[inline]
+pub fn process_type() -> Option<ProcessType> {
+    match unsafe { ffi::rte_eal_process_type() } {
+        ffi::rte_proc_type_t::RTE_PROC_PRIMARY => Some(ProcessType::Primary),
+        ffi::rte_proc_type_t::RTE_PROC_SECONDARY => Some(ProcessType::Secondary),
+        _ => None,
+    }
+}
+
+/// Returns `true` if the primary process (of the group using the default runtime directory) is running,
+/// e.g. for a secondary process to detect that it has to attach to a new primary.
+#[inline]
+pub fn primary_process_alive() -> bool {
+    unsafe { ffi::rte_eal_primary_proc_alive(ptr::null()) != 0 }
+}
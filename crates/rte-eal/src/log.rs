@@ -0,0 +1,222 @@
+//! Forwarding DPDK's logs to `tracing`, without ever blocking the (data-plane) threads that log.
+//!
+//! DPDK's log stream is replaced by a custom stream (see `fopencookie(3)`), whose writes push the log lines into a
+//! bounded channel, which is drained by a background thread. When the channel is full (e.g. during a log storm), lines
+//! are dropped and counted, instead of blocking. Lines are also rate limited per log type (i.e. per DPDK library
+//! or driver), and DPDK's log levels are mapped to `tracing` levels.
+
+use std::{
+    cell::RefCell,
+    ffi::CString,
+    io,
+    os::raw::{c_char, c_void},
+    ptr, slice,
+    sync::{
+        atomic::{AtomicU32, AtomicU64, Ordering},
+        mpsc::{self, Receiver, SyncSender},
+    },
+    thread,
+};
+
+use rte_error::ReturnValue as _;
+use tracing::*;
+
+use crate::Error;
+
+/// The number of log types whose rate limits are tracked separately, log types beyond that share limits.
+const MAX_SOURCES: usize = 256;
+
+const RTE_LOG_ERR: u32 = ffi::RTE_LOG_ERR as u32;
+const RTE_LOG_WARNING: u32 = ffi::RTE_LOG_WARNING as u32;
+const RTE_LOG_NOTICE: u32 = ffi::RTE_LOG_NOTICE as u32;
+const RTE_LOG_INFO: u32 = ffi::RTE_LOG_INFO as u32;
+
+static DROPPED: AtomicU64 = AtomicU64::new(0);
+static SUPPRESSED: AtomicU64 = AtomicU64::new(0);
+
+/// How DPDK's logs are forwarded, see [`crate::init_with_log_config`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct LogConfig {
+    /// The number of log lines buffered while waiting for the background thread, beyond which lines are dropped.
+    pub capacity: usize,
+    /// The number of lines per second forwarded for each log type, beyond which lines are suppressed
+    /// (the number of suppressed lines is logged once the next second starts). Unlimited if `None`.
+    pub rate_limit: Option<u32>,
+}
+
+impl Default for LogConfig {
+    fn default() -> Self {
+        Self { capacity: 4096, rate_limit: Some(100) }
+    }
+}
+
+/// The number of log lines that haven't been forwarded, see [`log_stats`].
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct LogStats {
+    /// Dropped because the channel was full.
+    pub dropped: u64,
+    /// Suppressed by the rate limit of their log type.
+    pub suppressed: u64,
+}
+
+/// Returns the number of DPDK log lines that haven't been forwarded since EAL was initialized.
+#[inline]
+pub fn log_stats() -> LogStats {
+    LogStats { dropped: DROPPED.load(Ordering::Relaxed), suppressed: SUPPRESSED.load(Ordering::Relaxed) }
+}
+
+#[derive(Debug)]
+struct Record {
+    level: u32,
+    logtype: u32,
+    line: String,
+}
+
+/// The rate limit state of a log type: the number of lines logged during the current one-second window.
+#[derive(Debug, Default)]
+struct RateLimit {
+    window: AtomicU64,
+    count: AtomicU32,
+    suppressed: AtomicU64,
+}
+
+impl RateLimit {
+    /// Returns `true` if a line logged at `now` (in seconds) is within the limit, along with the number of lines
+    /// suppressed during the previous window, if it just ended.
+    fn check(&self, now: u64, limit: u32) -> (bool, u64) {
+        let mut suppressed = 0;
+        let window = self.window.load(Ordering::Relaxed);
+        if window != now && self.window.compare_exchange(window, now, Ordering::Relaxed, Ordering::Relaxed).is_ok() {
+            self.count.store(0, Ordering::Relaxed);
+            suppressed = self.suppressed.swap(0, Ordering::Relaxed);
+        }
+
+        let allowed = self.count.fetch_add(1, Ordering::Relaxed) < limit;
+        if !allowed {
+            self.suppressed.fetch_add(1, Ordering::Relaxed);
+        }
+        (allowed, suppressed)
+    }
+}
+
+/// The state of the log stream, which is shared by all threads writing to it.
+struct Sink {
+    tx: SyncSender<Record>,
+    rate_limit: Option<u32>,
+    sources: Box<[RateLimit]>,
+}
+
+impl Sink {
+    fn push(&self, level: u32, logtype: u32, line: String) {
+        if let Some(limit) = self.rate_limit {
+            let (allowed, suppressed) = self.sources[logtype as usize % MAX_SOURCES].check(coarse_secs(), limit);
+            if suppressed > 0 {
+                let line = format!("suppressed {suppressed} log lines");
+                self.try_send(Record { level: RTE_LOG_WARNING, logtype, line });
+            }
+            if !allowed {
+                SUPPRESSED.fetch_add(1, Ordering::Relaxed);
+                return;
+            }
+        }
+        self.try_send(Record { level, logtype, line });
+    }
+
+    #[inline]
+    fn try_send(&self, record: Record) {
+        if self.tx.try_send(record).is_err() {
+            DROPPED.fetch_add(1, Ordering::Relaxed);
+        }
+    }
+}
+
+/// A monotonic clock in seconds, which is cheap enough to read for every log line.
+fn coarse_secs() -> u64 {
+    let mut ts = libc::timespec { tv_sec: 0, tv_nsec: 0 };
+    unsafe { libc::clock_gettime(libc::CLOCK_MONOTONIC_COARSE, &mut ts) };
+    ts.tv_sec as u64
+}
+
+thread_local! {
+    /// The incomplete last line written by this thread, if any.
+    static PARTIAL_LINE: RefCell<Vec<u8>> = RefCell::new(Vec::new());
+}
+
+unsafe extern "C" fn write_log(cookie: *mut c_void, buf: *const c_char, size: usize) -> isize {
+    let sink = &*(cookie as *const Sink);
+    let buf = slice::from_raw_parts(buf as *const u8, size);
+
+    // the level and type of the message being logged by this thread, set by `rte_vlog`
+    let level = ffi::rte_log_cur_msg_loglevel() as u32;
+    let logtype = ffi::rte_log_cur_msg_logtype() as u32;
+
+    PARTIAL_LINE.with(|partial| {
+        let mut partial = partial.borrow_mut();
+        let mut lines = buf.split(|&b| b == b'\n');
+        // the last chunk is either empty or an incomplete line
+        let last = lines.next_back().unwrap_or_default();
+        for line in lines {
+            partial.extend_from_slice(line);
+            sink.push(level, logtype, String::from_utf8_lossy(&partial).into_owned());
+            partial.clear();
+        }
+        partial.extend_from_slice(last);
+    });
+
+    // never fail (nor block), so that whatever's logging carries on
+    size as isize
+}
+
+fn forward_logs(rx: Receiver<Record>) {
+    for Record { level, logtype, line } in rx {
+        match level {
+            0..=RTE_LOG_ERR => error!(target: "ddosd::rte", logtype, "{line}"),
+            RTE_LOG_WARNING => warn!(target: "ddosd::rte", logtype, "{line}"),
+            RTE_LOG_NOTICE..=RTE_LOG_INFO => info!(target: "ddosd::rte", logtype, "{line}"),
+            _ => debug!(target: "ddosd::rte", logtype, "{line}"),
+        }
+    }
+}
+
+/// Sets up a non-blocking stream for RTE logs (instead of stderr), and spawns a thread forwarding them to `tracing`.
+pub(crate) fn init_log_stream(config: LogConfig) -> Result<(), Error> {
+    let (tx, rx) = mpsc::sync_channel(config.capacity);
+    thread::Builder::new().name("rte-log".into()).spawn(move || forward_logs(rx))?;
+
+    let sources = (0..MAX_SOURCES).map(|_| RateLimit::default()).collect();
+    // the stream (and so its sink) is used until the process exits
+    let sink = Box::into_raw(Box::new(Sink { tx, rate_limit: config.rate_limit, sources }));
+
+    unsafe {
+        let funcs = libc::cookie_io_functions_t { read: None, write: Some(write_log), seek: None, close: None };
+        let mode = CString::new("w").unwrap();
+        let stream = libc::fopencookie(sink as *mut c_void, mode.as_ptr(), funcs);
+        if stream.is_null() {
+            drop(Box::from_raw(sink));
+            return Err(io::Error::last_os_error().into());
+        }
+
+        // unbuffered, so that each message is written as soon as it's formatted
+        libc::setvbuf(stream, ptr::null_mut(), libc::_IONBF, 0);
+        ffi::rte_openlog_stream(stream as *mut _).rte_ok()?;
+    }
+
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn rate_limit_per_window() {
+        let limit = RateLimit::default();
+        assert!((0..3).all(|_| limit.check(1, 3) == (true, 0)));
+        assert_eq!(limit.check(1, 3), (false, 0));
+        assert_eq!(limit.check(1, 3), (false, 0));
+
+        // the number of suppressed lines is reported once, when the next window starts
+        assert_eq!(limit.check(2, 3), (true, 2));
+        assert_eq!(limit.check(2, 3), (true, 0));
+    }
+}
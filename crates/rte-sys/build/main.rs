@@ -5,10 +5,16 @@ use std::{env, path::PathBuf};
 const GENERATED_FILE: &str = "dpdk_bindings.rs";
 
 fn bind() {
-    cc::Build::new()
-        .file("src/stub.c")
-        .flag("-mssse3")
-        .compile("rte_stub");
+    let mut stub = cc::Build::new();
+    stub.file("src/stub.c").flag("-mssse3");
+
+    // the shims are tiny wrappers around inline DPDK functions, emitting them as (Thin)LTO bitcode allows the linker
+    // to inline them into their Rust callers, when linker-plugin LTO is enabled for the Rust code as well
+    if env::var_os("CARGO_FEATURE_CROSS_LANG_LTO").is_some() {
+        stub.compiler("clang").flag("-flto=thin");
+    }
+
+    stub.compile("rte_stub");
 
     let out_dir = PathBuf::from(env::var("OUT_DIR").unwrap());
 
@@ -26,7 +32,7 @@ fn bind() {
         .opaque_type("rte_l2tpv2_combined_msg_hdr")
         .allowlist_type(r"(rte|eth|DDOS)_.*")
         .allowlist_function(r"(_rte|rte|eth)_.*")
-        .allowlist_var(r"(_?RTE|EXT|DEV|ETH|MEMPOOL|PKT|LCORE|rte)_.*")
+        .allowlist_var(r"(_?RTE|EXT|DEV|ETH|MEMPOOL|PKT|LCORE|RING|rte)_.*")
         .derive_copy(true)
         .derive_debug(true)
         .derive_default(true)
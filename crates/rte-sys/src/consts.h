@@ -42,6 +42,27 @@ const uint64_t _RTE_ETH_TX_OFFLOAD_IP_TNL_TSO           = RTE_ETH_TX_OFFLOAD_IP_
 const uint64_t _RTE_ETH_TX_OFFLOAD_OUTER_UDP_CKSUM      = RTE_ETH_TX_OFFLOAD_OUTER_UDP_CKSUM;
 const uint64_t _RTE_ETH_TX_OFFLOAD_SEND_ON_TIMESTAMP    = RTE_ETH_TX_OFFLOAD_SEND_ON_TIMESTAMP;
 
+const uint64_t _RTE_MBUF_F_RX_VLAN                      = RTE_MBUF_F_RX_VLAN;
+const uint64_t _RTE_MBUF_F_RX_RSS_HASH                  = RTE_MBUF_F_RX_RSS_HASH;
+const uint64_t _RTE_MBUF_F_RX_FDIR                      = RTE_MBUF_F_RX_FDIR;
+const uint64_t _RTE_MBUF_F_RX_L4_CKSUM_BAD              = RTE_MBUF_F_RX_L4_CKSUM_BAD;
+const uint64_t _RTE_MBUF_F_RX_IP_CKSUM_BAD              = RTE_MBUF_F_RX_IP_CKSUM_BAD;
+const uint64_t _RTE_MBUF_F_RX_OUTER_IP_CKSUM_BAD        = RTE_MBUF_F_RX_OUTER_IP_CKSUM_BAD;
+const uint64_t _RTE_MBUF_F_RX_VLAN_STRIPPED             = RTE_MBUF_F_RX_VLAN_STRIPPED;
+const uint64_t _RTE_MBUF_F_RX_IP_CKSUM_GOOD             = RTE_MBUF_F_RX_IP_CKSUM_GOOD;
+const uint64_t _RTE_MBUF_F_RX_L4_CKSUM_GOOD             = RTE_MBUF_F_RX_L4_CKSUM_GOOD;
+const uint64_t _RTE_MBUF_F_RX_IEEE1588_PTP              = RTE_MBUF_F_RX_IEEE1588_PTP;
+const uint64_t _RTE_MBUF_F_RX_IEEE1588_TMST             = RTE_MBUF_F_RX_IEEE1588_TMST;
+const uint64_t _RTE_MBUF_F_RX_FDIR_ID                   = RTE_MBUF_F_RX_FDIR_ID;
+const uint64_t _RTE_MBUF_F_RX_FDIR_FLX                  = RTE_MBUF_F_RX_FDIR_FLX;
+const uint64_t _RTE_MBUF_F_RX_QINQ_STRIPPED             = RTE_MBUF_F_RX_QINQ_STRIPPED;
+const uint64_t _RTE_MBUF_F_RX_LRO                       = RTE_MBUF_F_RX_LRO;
+const uint64_t _RTE_MBUF_F_RX_SEC_OFFLOAD               = RTE_MBUF_F_RX_SEC_OFFLOAD;
+const uint64_t _RTE_MBUF_F_RX_SEC_OFFLOAD_FAILED        = RTE_MBUF_F_RX_SEC_OFFLOAD_FAILED;
+const uint64_t _RTE_MBUF_F_RX_QINQ                      = RTE_MBUF_F_RX_QINQ;
+const uint64_t _RTE_MBUF_F_RX_OUTER_L4_CKSUM_BAD        = RTE_MBUF_F_RX_OUTER_L4_CKSUM_BAD;
+const uint64_t _RTE_MBUF_F_RX_OUTER_L4_CKSUM_GOOD       = RTE_MBUF_F_RX_OUTER_L4_CKSUM_GOOD;
+
 const uint32_t _RTE_ETH_MQ_RX_RSS_FLAG   = RTE_ETH_MQ_RX_RSS_FLAG;
 const uint32_t _RTE_ETH_MQ_RX_DCB_FLAG   = RTE_ETH_MQ_RX_DCB_FLAG;
 const uint32_t _RTE_ETH_MQ_RX_VMDQ_FLAG  = RTE_ETH_MQ_RX_VMDQ_FLAG;
@@ -77,3 +98,8 @@ const uint32_t _RTE_ETH_RSS_PFCP =                  RTE_ETH_RSS_PFCP;
 const uint32_t _RTE_ETH_RSS_PPPOE =                 RTE_ETH_RSS_PPPOE;
 const uint32_t _RTE_ETH_RSS_ECPRI =                 RTE_ETH_RSS_ECPRI;
 const uint32_t _RTE_ETH_RSS_MPLS =                  RTE_ETH_RSS_MPLS;
+
+const uint64_t _RTE_GRO_TCP_IPV4 =                  RTE_GRO_TCP_IPV4;
+const uint64_t _RTE_GRO_IPV4_VXLAN_TCP_IPV4 =       RTE_GRO_IPV4_VXLAN_TCP_IPV4;
+const uint64_t _RTE_GRO_UDP_IPV4 =                  RTE_GRO_UDP_IPV4;
+const uint64_t _RTE_GRO_IPV4_VXLAN_UDP_IPV4 =       RTE_GRO_IPV4_VXLAN_UDP_IPV4;
@@ -1,11 +1,30 @@
 /// known issues:
 // 1. https://github.com/rust-lang/rust/issues/54341
 
+#include <rte_acl.h>
+#include <rte_bpf.h>
+#include <rte_cpuflags.h>
+#include <rte_cycles.h>
 #include <rte_eal.h>
+#include <rte_epoll.h>
 #include <rte_errno.h>
+#include <rte_eth_ring.h>
 #include <rte_ethdev.h>
+#include <rte_event_eth_rx_adapter.h>
+#include <rte_eventdev.h>
+#include <rte_flow.h>
+#include <rte_gro.h>
+#include <rte_gso.h>
+#include <rte_hash.h>
 #include <rte_lcore.h>
+#include <rte_lpm.h>
+#include <rte_lpm6.h>
 #include <rte_malloc.h>
+#include <rte_mbuf_pool_ops.h>
+#include <rte_pcapng.h>
+#include <rte_power_intrinsics.h>
+#include <rte_ring.h>
+#include <rte_service.h>
 
 #include "consts.h"
 
@@ -17,6 +36,11 @@ void _rte_set_mock_lcore(uint32_t lcore_id);
 
 unsigned _rte_lcore_id(void);
 
+/**
+ * Read the time base register (e.g. the TSC on x86).
+ */
+uint64_t _rte_rdtsc(void);
+
 /**
  * Error number value, stored per-thread, which can be queried after
  * calls to certain functions to determine why those functions failed.
@@ -28,11 +52,22 @@ int _rte_errno(void);
  */
 char *_rte_pktmbuf_prepend(struct rte_mbuf *m, uint16_t len);
 
+/**
+ * Attach an external buffer to a (direct) mbuf, sharing it through the given shared info.
+ */
+void _rte_pktmbuf_attach_extbuf(struct rte_mbuf *m, void *buf_addr, rte_iova_t buf_iova, uint16_t buf_len,
+                                struct rte_mbuf_ext_shared_info *shinfo);
+
 /**
  * Allocate a new mbuf from a mempool.
  */
 struct rte_mbuf *_rte_pktmbuf_alloc(struct rte_mempool *mp);
 
+/**
+ * Allocate a bulk of mbufs, initialize refcnt and reset the fields to default values.
+ */
+int _rte_pktmbuf_alloc_bulk(struct rte_mempool *pool, struct rte_mbuf **mbufs, unsigned count);
+
 /**
  * Free a packet mbuf back into its original mempool.
  */
@@ -43,6 +78,61 @@ void _rte_pktmbuf_free(struct rte_mbuf *m);
  */
 void _rte_mempool_put_bulk(struct rte_mempool *mp, void *const *obj_table, unsigned int n);
 
+/**
+ * Get a pointer to the mempool ops (driver) with the given index.
+ */
+struct rte_mempool_ops *_rte_mempool_get_ops(int ops_index);
+
+/**
+ * The debug statistics of a mempool, summed over all lcores.
+ */
+struct _rte_mempool_stats {
+    uint64_t put_bulk;
+    uint64_t put_objs;
+    uint64_t put_common_pool_bulk;
+    uint64_t get_common_pool_bulk;
+    uint64_t get_success_bulk;
+    uint64_t get_success_objs;
+    uint64_t get_fail_bulk;
+    uint64_t get_fail_objs;
+};
+
+/**
+ * Get the debug statistics of a mempool, summed over all lcores.
+ * Returns -ENOTSUP if DPDK was built without RTE_LIBRTE_MEMPOOL_STATS.
+ */
+int _rte_mempool_get_stats(const struct rte_mempool *mp, struct _rte_mempool_stats *stats);
+
+/**
+ * Enqueue several objects on a ring, using the ring's default producer synchronization mode.
+ */
+unsigned int _rte_ring_enqueue_bulk(struct rte_ring *r, void *const *obj_table, unsigned int n, unsigned int *free_space);
+
+/**
+ * Enqueue up to n objects on a ring, using the ring's default producer synchronization mode.
+ */
+unsigned int _rte_ring_enqueue_burst(struct rte_ring *r, void *const *obj_table, unsigned int n, unsigned int *free_space);
+
+/**
+ * Dequeue several objects from a ring, using the ring's default consumer synchronization mode.
+ */
+unsigned int _rte_ring_dequeue_bulk(struct rte_ring *r, void **obj_table, unsigned int n, unsigned int *available);
+
+/**
+ * Dequeue up to n objects from a ring, using the ring's default consumer synchronization mode.
+ */
+unsigned int _rte_ring_dequeue_burst(struct rte_ring *r, void **obj_table, unsigned int n, unsigned int *available);
+
+/**
+ * Return the number of entries in a ring.
+ */
+unsigned int _rte_ring_count(const struct rte_ring *r);
+
+/**
+ * Return the number of free entries in a ring.
+ */
+unsigned int _rte_ring_free_count(const struct rte_ring *r);
+
 /**
  * Retrieve a burst of input packets from a receive queue of an Ethernet
  * device. The retrieved packets are stored in *rte_mbuf* structures whose
@@ -55,6 +145,12 @@ uint16_t _rte_eth_rx_burst(uint16_t port_id, uint16_t queue_id, struct rte_mbuf
  */
 uint16_t _rte_eth_tx_burst(uint16_t port_id, uint16_t queue_id, struct rte_mbuf **tx_pkts, uint16_t nb_pkts);
 
+/**
+ * Process a burst of output packets on a transmit queue of an Ethernet device,
+ * checking (and possibly modifying) them so that they meet the device's TX offload requirements.
+ */
+uint16_t _rte_eth_tx_prepare(uint16_t port_id, uint16_t queue_id, struct rte_mbuf **tx_pkts, uint16_t nb_pkts);
+
 /**
  * Get the application private size of mbufs stored in a pktmbuf_pool.
  */
@@ -64,3 +160,38 @@ uint16_t _rte_pktmbuf_priv_size(struct rte_mempool *mp);
  * Get the data room size of mbufs stored in a pktmbuf_pool.
  */
 uint16_t _rte_pktmbuf_data_room_size(struct rte_mempool *mp);
+
+/**
+ * Lookup an IP (in host byte order) in the LPM table.
+ * Returns 0 on a hit (storing the next hop), -ENOENT on a miss.
+ */
+int _rte_lpm_lookup(const struct rte_lpm *lpm, uint32_t ip, uint32_t *next_hop);
+
+/**
+ * Lookup multiple IPs (in host byte order) in the LPM table. Each entry of next_hops is
+ * RTE_LPM_LOOKUP_SUCCESS | next hop on a hit, and 0 on a miss.
+ */
+int _rte_lpm_lookup_bulk(const struct rte_lpm *lpm, const uint32_t *ips, uint32_t *next_hops, unsigned n);
+
+/**
+ * Enqueue a burst of events (of any operation) on an event port.
+ * Returns the number of events enqueued, the remaining ones can be retried.
+ */
+uint16_t _rte_event_enqueue_burst(uint8_t dev_id, uint8_t port_id, const struct rte_event ev[], uint16_t nb_events);
+
+/**
+ * Enqueue a burst of RTE_EVENT_OP_NEW events on an event port.
+ */
+uint16_t _rte_event_enqueue_new_burst(uint8_t dev_id, uint8_t port_id, const struct rte_event ev[], uint16_t nb_events);
+
+/**
+ * Enqueue a burst of RTE_EVENT_OP_FORWARD events on an event port.
+ */
+uint16_t _rte_event_enqueue_forward_burst(uint8_t dev_id, uint8_t port_id, const struct rte_event ev[],
+                                          uint16_t nb_events);
+
+/**
+ * Dequeue a burst of events from the queues linked to an event port, waiting for up to timeout_ticks.
+ */
+uint16_t _rte_event_dequeue_burst(uint8_t dev_id, uint8_t port_id, struct rte_event ev[], uint16_t nb_events,
+                                  uint64_t timeout_ticks);
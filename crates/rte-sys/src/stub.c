@@ -1,7 +1,12 @@
+#include <rte_cycles.h>
 #include <rte_errno.h>
 #include <rte_ethdev.h>
 #include <rte_mbuf.h>
 #include <rte_mempool.h>
+#include <rte_ring.h>
+
+// for the shims' prototypes, and the types they share with Rust
+#include "dpdk_bindings.h"
 
 void _rte_set_mock_lcore(uint32_t lcore_id)
 {
@@ -13,6 +18,11 @@ unsigned _rte_lcore_id(void)
     return rte_lcore_id();
 }
 
+uint64_t _rte_rdtsc(void)
+{
+    return rte_rdtsc();
+}
+
 int _rte_errno(void)
 {
     return rte_errno;
@@ -23,11 +33,22 @@ char *_rte_pktmbuf_prepend(struct rte_mbuf *m, uint16_t len)
     return rte_pktmbuf_prepend(m, len);
 }
 
+void _rte_pktmbuf_attach_extbuf(struct rte_mbuf *m, void *buf_addr, rte_iova_t buf_iova, uint16_t buf_len,
+                                struct rte_mbuf_ext_shared_info *shinfo)
+{
+    rte_pktmbuf_attach_extbuf(m, buf_addr, buf_iova, buf_len, shinfo);
+}
+
 struct rte_mbuf *_rte_pktmbuf_alloc(struct rte_mempool *mp)
 {
     return rte_pktmbuf_alloc(mp);
 }
 
+int _rte_pktmbuf_alloc_bulk(struct rte_mempool *pool, struct rte_mbuf **mbufs, unsigned count)
+{
+    return rte_pktmbuf_alloc_bulk(pool, mbufs, count);
+}
+
 void _rte_pktmbuf_free(struct rte_mbuf *m)
 {
     rte_pktmbuf_free(m);
@@ -38,6 +59,64 @@ void _rte_mempool_put_bulk(struct rte_mempool *mp, void *const *obj_table, unsig
     rte_mempool_put_bulk(mp, obj_table, n);
 }
 
+struct rte_mempool_ops *_rte_mempool_get_ops(int ops_index)
+{
+    return rte_mempool_get_ops(ops_index);
+}
+
+int _rte_mempool_get_stats(const struct rte_mempool *mp, struct _rte_mempool_stats *stats)
+{
+#ifdef RTE_LIBRTE_MEMPOOL_STATS
+    *stats = (struct _rte_mempool_stats){0};
+    for (unsigned int i = 0; i < RTE_DIM(mp->stats); i++) {
+        const struct rte_mempool_debug_stats *s = &mp->stats[i];
+        stats->put_bulk += s->put_bulk;
+        stats->put_objs += s->put_objs;
+        stats->put_common_pool_bulk += s->put_common_pool_bulk;
+        stats->get_common_pool_bulk += s->get_common_pool_bulk;
+        stats->get_success_bulk += s->get_success_bulk;
+        stats->get_success_objs += s->get_success_objs;
+        stats->get_fail_bulk += s->get_fail_bulk;
+        stats->get_fail_objs += s->get_fail_objs;
+    }
+    return 0;
+#else
+    RTE_SET_USED(mp);
+    RTE_SET_USED(stats);
+    return -ENOTSUP;
+#endif
+}
+
+unsigned int _rte_ring_enqueue_bulk(struct rte_ring *r, void *const *obj_table, unsigned int n, unsigned int *free_space)
+{
+    return rte_ring_enqueue_bulk(r, obj_table, n, free_space);
+}
+
+unsigned int _rte_ring_enqueue_burst(struct rte_ring *r, void *const *obj_table, unsigned int n, unsigned int *free_space)
+{
+    return rte_ring_enqueue_burst(r, obj_table, n, free_space);
+}
+
+unsigned int _rte_ring_dequeue_bulk(struct rte_ring *r, void **obj_table, unsigned int n, unsigned int *available)
+{
+    return rte_ring_dequeue_bulk(r, obj_table, n, available);
+}
+
+unsigned int _rte_ring_dequeue_burst(struct rte_ring *r, void **obj_table, unsigned int n, unsigned int *available)
+{
+    return rte_ring_dequeue_burst(r, obj_table, n, available);
+}
+
+unsigned int _rte_ring_count(const struct rte_ring *r)
+{
+    return rte_ring_count(r);
+}
+
+unsigned int _rte_ring_free_count(const struct rte_ring *r)
+{
+    return rte_ring_free_count(r);
+}
+
 uint16_t _rte_eth_rx_burst(uint16_t port_id, uint16_t queue_id, struct rte_mbuf **rx_pkts, const uint16_t nb_pkts)
 {
     return rte_eth_rx_burst(port_id, queue_id, rx_pkts, nb_pkts);
@@ -48,6 +127,11 @@ uint16_t _rte_eth_tx_burst(uint16_t port_id, uint16_t queue_id, struct rte_mbuf
     return rte_eth_tx_burst(port_id, queue_id, tx_pkts, nb_pkts);
 }
 
+uint16_t _rte_eth_tx_prepare(uint16_t port_id, uint16_t queue_id, struct rte_mbuf **tx_pkts, uint16_t nb_pkts)
+{
+    return rte_eth_tx_prepare(port_id, queue_id, tx_pkts, nb_pkts);
+}
+
 uint16_t _rte_pktmbuf_priv_size(struct rte_mempool *mp)
 {
     return rte_pktmbuf_priv_size(mp);
@@ -57,3 +141,35 @@ uint16_t _rte_pktmbuf_data_room_size(struct rte_mempool *mp)
 {
     return rte_pktmbuf_data_room_size(mp);
 }
+
+int _rte_lpm_lookup(const struct rte_lpm *lpm, uint32_t ip, uint32_t *next_hop)
+{
+    return rte_lpm_lookup(lpm, ip, next_hop);
+}
+
+int _rte_lpm_lookup_bulk(const struct rte_lpm *lpm, const uint32_t *ips, uint32_t *next_hops, unsigned n)
+{
+    return rte_lpm_lookup_bulk(lpm, ips, next_hops, n);
+}
+
+uint16_t _rte_event_enqueue_burst(uint8_t dev_id, uint8_t port_id, const struct rte_event ev[], uint16_t nb_events)
+{
+    return rte_event_enqueue_burst(dev_id, port_id, ev, nb_events);
+}
+
+uint16_t _rte_event_enqueue_new_burst(uint8_t dev_id, uint8_t port_id, const struct rte_event ev[], uint16_t nb_events)
+{
+    return rte_event_enqueue_new_burst(dev_id, port_id, ev, nb_events);
+}
+
+uint16_t _rte_event_enqueue_forward_burst(uint8_t dev_id, uint8_t port_id, const struct rte_event ev[],
+                                          uint16_t nb_events)
+{
+    return rte_event_enqueue_forward_burst(dev_id, port_id, ev, nb_events);
+}
+
+uint16_t _rte_event_dequeue_burst(uint8_t dev_id, uint8_t port_id, struct rte_event ev[], uint16_t nb_events,
+                                  uint64_t timeout_ticks)
+{
+    return rte_event_dequeue_burst(dev_id, port_id, ev, nb_events, timeout_ticks);
+}
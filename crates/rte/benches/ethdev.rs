@@ -0,0 +1,151 @@
+//! Measures the cost of the data path of ethernet devices, using virtual devices, so that it doesn't depend on a NIC:
+//! - `net_null`, whose RX burst function allocates packets, and whose TX burst function frees them, i.e. a round trip
+//!   is a forwarding loop without any I/O.
+//! - `net_ring`, whose transmitted packets are received back from the same (looped back) ring.
+//!
+//! Also measures reading xstats, and the throughput (in Mpps, i.e. elements per second) of a forwarding loop running
+//! on a worker lcore, rather than on the main lcore, which runs Criterion itself.
+//!
+//! Run with `cargo bench -p rte --features test-utils --bench ethdev`.
+//!
+//! Criterion writes its results as JSON to `target/criterion/<group>/<benchmark>/new/estimates.json`, and results can be
+//! tracked across releases (of this crate, or of DPDK) using `-- --save-baseline <name>` and `-- --baseline <name>`.
+
+use std::time::{Duration, Instant};
+
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkGroup, BenchmarkId, Criterion, Throughput};
+use once_cell::sync::Lazy;
+use rte::{ethdev::EthDev, lcore, mbuf::MBufBatch, mempool::MemoryPool};
+
+const NB_DESC: u16 = 1024;
+
+struct Env {
+    mempool: MemoryPool,
+    null: EthDev,
+    ring: EthDev,
+}
+
+static ENV: Lazy<Env> = Lazy::new(|| {
+    rte_eal::init(["", "--no-huge", "-m", "1024", "--no-shconf", "-l", "0-1", "--vdev=net_null0", "--vdev=net_ring0"])
+        .expect("Could not initialize EAL for benchmarks");
+
+    let mempool =
+        MemoryPool::new("bench_ethdev_pool", 8191, 256, 0, ffi::RTE_MBUF_DEFAULT_BUF_SIZE as u16, None).unwrap();
+    let null = setup_port("net_null0", &mempool);
+    let ring = setup_port("net_ring0", &mempool);
+    Env { mempool, null, ring }
+});
+
+fn setup_port(name: &str, mempool: &MemoryPool) -> EthDev {
+    let dev = EthDev::from_name(name).unwrap();
+    dev.configure(1, 1, &Default::default()).unwrap();
+    dev.rx_queue_setup(0, NB_DESC, None, mempool).unwrap();
+    dev.tx_queue_setup(0, NB_DESC, None).unwrap();
+    dev.start().unwrap();
+    dev
+}
+
+type Group<'a> = BenchmarkGroup<'a, criterion::measurement::WallTime>;
+
+/// Receives a burst of up to `N` packets from `net_null`, and transmits it back.
+#[inline(always)]
+fn null_round_trip<const N: usize>(pkts: &mut MBufBatch<&'static MemoryPool, N>) -> usize {
+    unsafe { ENV.null.rx_burst(0, &ENV.mempool, pkts) };
+    let received = pkts.len();
+    unsafe { ENV.null.tx_burst(0, &ENV.mempool, pkts) };
+    pkts.free_all();
+    received
+}
+
+fn bench_null_burst<const N: usize>(group: &mut Group) {
+    group.throughput(Throughput::Elements(N as u64));
+    group.bench_function(BenchmarkId::new("net_null", N), |b| {
+        let mut pkts = MBufBatch::<_, N>::new();
+        b.iter(|| black_box(null_round_trip(&mut pkts)))
+    });
+}
+
+fn bench_ring_burst<const N: usize>(group: &mut Group) {
+    group.throughput(Throughput::Elements(N as u64));
+    group.bench_function(BenchmarkId::new("net_ring", N), |b| {
+        let mut pkts = MBufBatch::<_, N>::new();
+        ENV.mempool.alloc_bulk(&mut pkts).unwrap();
+        b.iter(|| unsafe {
+            ENV.ring.tx_burst(0, &ENV.mempool, &mut pkts);
+            ENV.ring.rx_burst(0, &ENV.mempool, &mut pkts);
+            black_box(pkts.len())
+        });
+    });
+}
+
+fn bench_round_trip(c: &mut Criterion) {
+    let mut group = c.benchmark_group("rx_tx_round_trip");
+
+    bench_null_burst::<1>(&mut group);
+    bench_null_burst::<8>(&mut group);
+    bench_null_burst::<32>(&mut group);
+    bench_null_burst::<64>(&mut group);
+    bench_null_burst::<256>(&mut group);
+
+    bench_ring_burst::<1>(&mut group);
+    bench_ring_burst::<8>(&mut group);
+    bench_ring_burst::<32>(&mut group);
+    bench_ring_burst::<64>(&mut group);
+    bench_ring_burst::<256>(&mut group);
+
+    group.finish();
+}
+
+fn bench_xstats(c: &mut Criterion) {
+    let dev = &ENV.ring;
+    let defs = dev.get_xstats_def().unwrap();
+    let selection = defs.select(|_| true);
+    let mut snapshot = rte::ethdev::XStatsSnapshot::new(&selection);
+
+    let mut group = c.benchmark_group("xstats");
+    group.throughput(Throughput::Elements(defs.names().len() as u64));
+    group.bench_function("get_xstats", |b| b.iter(|| black_box(dev.get_xstats(&defs).unwrap())));
+    group.bench_function("read_xstats", |b| {
+        b.iter(|| {
+            dev.read_xstats(&selection, &mut snapshot).unwrap();
+            black_box(snapshot.values()[0])
+        })
+    });
+    group.finish();
+}
+
+/// Runs `iters` forwarding loops of bursts of up to `N` packets on `worker`, and returns how long they took.
+fn run_on_worker<const N: usize>(worker: lcore::Id, iters: u64) -> Duration {
+    worker
+        .spawn(move || {
+            let mut pkts = MBufBatch::<_, N>::new();
+            let start = Instant::now();
+            for _ in 0..iters {
+                black_box(null_round_trip(&mut pkts));
+            }
+            start.elapsed()
+        })
+        .unwrap()
+        .join()
+}
+
+fn bench_worker_lcore(c: &mut Criterion) {
+    Lazy::force(&ENV);
+    let worker = match lcore::Id::iter_enabled(true).next() {
+        Some(worker) => worker,
+        None => {
+            eprintln!("skipping the worker lcore benchmarks, which require at least 2 lcores");
+            return;
+        }
+    };
+
+    let mut group = c.benchmark_group("worker_lcore");
+    group.throughput(Throughput::Elements(32));
+    group.bench_function(BenchmarkId::new("net_null", 32), |b| {
+        b.iter_custom(|iters| run_on_worker::<32>(worker, iters))
+    });
+    group.finish();
+}
+
+criterion_group!(benches, bench_round_trip, bench_xstats, bench_worker_lcore);
+criterion_main!(benches);
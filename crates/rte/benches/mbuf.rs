@@ -0,0 +1,87 @@
+//! Measures the per-packet cost of the mbuf life cycle, with the [`GlobalAllocator`] (i.e. the Rust heap) and with a
+//! DPDK [`MemoryPool`], and compares allocating and freeing bursts of mbufs one at a time and in bulk.
+//!
+//! Run with `cargo bench -p rte --features test-utils --bench mbuf`.
+//!
+//! Criterion writes its results as JSON to `target/criterion/<group>/<benchmark>/new/estimates.json`, and results can be
+//! tracked across releases (of this crate, or of DPDK) using `-- --save-baseline <name>` and `-- --baseline <name>`.
+
+use arrayvec::ArrayVec;
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkGroup, BenchmarkId, Criterion, Throughput};
+use rte::{
+    mbuf::{GlobalAllocator, MBuf, MBufBatch},
+    mempool::MemoryPool,
+};
+
+const PAYLOAD_SIZES: [usize; 2] = [64, 1500];
+
+fn mempool(name: &str) -> MemoryPool {
+    rte::test_utils::init_test_env();
+    MemoryPool::new(name, 4095, 256, 0, ffi::RTE_MBUF_DEFAULT_BUF_SIZE as u16, None).unwrap()
+}
+
+fn bench_lifecycle(c: &mut Criterion) {
+    let mempool = mempool("bench_lifecycle_pool");
+    let payload = [0xab; 1500];
+    let mut group = c.benchmark_group("mbuf_lifecycle");
+    group.throughput(Throughput::Elements(1));
+
+    for size in PAYLOAD_SIZES {
+        group.bench_with_input(BenchmarkId::new("global_allocator", size), &size, |b, &size| {
+            b.iter(|| {
+                let mut mbuf = MBuf::<GlobalAllocator>::new();
+                mbuf.extend_from_slice(&payload[..size]);
+                black_box(mbuf)
+            })
+        });
+        group.bench_with_input(BenchmarkId::new("mempool", size), &size, |b, &size| {
+            b.iter(|| {
+                let mut mbuf = MBuf::new_with_provider(&&mempool);
+                mbuf.extend_from_slice(&payload[..size]);
+                black_box(mbuf)
+            })
+        });
+    }
+
+    group.finish();
+}
+
+fn bench_alloc_burst<const N: usize>(
+    group: &mut BenchmarkGroup<'_, criterion::measurement::WallTime>,
+    mempool: &MemoryPool,
+) {
+    group.throughput(Throughput::Elements(N as u64));
+
+    group.bench_function(BenchmarkId::new("single", N), |b| {
+        let mut mbufs = ArrayVec::<_, N>::new();
+        b.iter(|| {
+            for _ in 0..N {
+                mbufs.push(MBuf::new_with_provider(&mempool));
+            }
+            black_box(&mut mbufs).clear();
+        })
+    });
+    group.bench_function(BenchmarkId::new("bulk", N), |b| {
+        let mut mbufs = MBufBatch::<_, N>::new();
+        b.iter(|| {
+            mempool.alloc_bulk(&mut mbufs).unwrap();
+            black_box(&mut mbufs).free_all();
+        })
+    });
+}
+
+fn bench_alloc(c: &mut Criterion) {
+    let mempool = mempool("bench_alloc_pool");
+    let mut group = c.benchmark_group("mbuf_alloc_free");
+
+    bench_alloc_burst::<1>(&mut group, &mempool);
+    bench_alloc_burst::<8>(&mut group, &mempool);
+    bench_alloc_burst::<32>(&mut group, &mempool);
+    bench_alloc_burst::<64>(&mut group, &mempool);
+    bench_alloc_burst::<256>(&mut group, &mempool);
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_lifecycle, bench_alloc);
+criterion_main!(benches);
@@ -0,0 +1,79 @@
+//! Compares processing bursts of 64-byte packets with and without prefetching.
+//!
+//! The packets are spread over a working set that is much larger than the last-level cache, and the bursts are
+//! processed round-robin, so that (like freshly received packets) neither the mbufs nor their data are cached.
+//!
+//! Run with `cargo bench -p rte --features test-utils --bench prefetch`.
+
+use arrayvec::ArrayVec;
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use rte::mbuf::{GlobalAllocator, MBuf, PrefetchExt};
+
+const BURST_SIZE: usize = 32;
+/// 8192 bursts of 32 mbufs, each with a 256-byte data room, are about 100 MB of mbufs and data
+const NB_BURSTS: usize = 8192;
+
+type Mbuf = MBuf<GlobalAllocator<256>>;
+
+/// An Ethernet + IPv4 + UDP header, padded to the minimal frame size
+fn packet(i: usize) -> [u8; 64] {
+    let mut pkt = [0; 64];
+    pkt[12..14].copy_from_slice(&0x0800u16.to_be_bytes());
+    pkt[14] = 0x45;
+    pkt[23] = 17;
+    pkt[26..30].copy_from_slice(&(i as u32).to_be_bytes());
+    pkt[30..34].copy_from_slice(&(!(i as u32)).to_be_bytes());
+    pkt
+}
+
+/// A minimal per-packet workload: parses the headers and hashes the IPv4 addresses
+#[inline(always)]
+fn classify(pkt: &mut Mbuf) -> u32 {
+    let data = &pkt[..];
+    if data.len() < 34 || data[12..14] != [0x08, 0x00] {
+        return 0;
+    }
+    let src = u32::from_be_bytes(data[26..30].try_into().unwrap());
+    let dst = u32::from_be_bytes(data[30..34].try_into().unwrap());
+    (src ^ dst).wrapping_mul(0x9e37_79b9)
+}
+
+fn bursts() -> Vec<ArrayVec<Mbuf, BURST_SIZE>> {
+    // allocate the bursts interleaved, so that consecutive packets of a burst aren't adjacent in memory
+    let mut bursts = (0..NB_BURSTS).map(|_| ArrayVec::new()).collect::<Vec<_>>();
+    for i in 0..BURST_SIZE * NB_BURSTS {
+        bursts[i % NB_BURSTS].push(Mbuf::new_with_data(packet(i)));
+    }
+    bursts
+}
+
+fn bench_prefetch(c: &mut Criterion) {
+    let mut bursts = bursts();
+    let mut group = c.benchmark_group("burst_64B");
+    group.throughput(Throughput::Elements(BURST_SIZE as u64));
+
+    group.bench_function("no_prefetch", |b| {
+        let mut next = 0;
+        b.iter(|| {
+            let burst = &mut bursts[next];
+            next = (next + 1) % NB_BURSTS;
+            black_box(burst.iter_mut().map(classify).fold(0, u32::wrapping_add))
+        })
+    });
+
+    for distance in [1, 2, 4, 8] {
+        group.bench_with_input(BenchmarkId::new("prefetch", distance), &distance, |b, &distance| {
+            let mut next = 0;
+            b.iter(|| {
+                let burst = &mut bursts[next];
+                next = (next + 1) % NB_BURSTS;
+                black_box(burst.iter_prefetched(distance).map(classify).fold(0, u32::wrapping_add))
+            })
+        });
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_prefetch);
+criterion_main!(benches);
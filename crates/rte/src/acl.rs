@@ -0,0 +1,370 @@
+//! Multi-field packet classification, based on DPDK's
+//! [Packet Classification and Access Control Library](https://doc.dpdk.org/guides-21.08/prog_guide/packet_classif_access_ctrl.html).
+//!
+//! An [`Acl`] is built once from a set of [`AclRule`]s (it can't be modified afterwards), and then classifies whole
+//! bursts of packets at a time using the best classifier supported by the CPU (e.g. AVX2 or AVX-512).
+//! To update the rules, a new [`Acl`] is built off to the side and swapped in atomically, e.g. by storing it in an
+//! [`RcuCell`](crate::rcu::RcuCell), so that the data plane is never stalled by a rebuild.
+//!
+//! ```rust,ignore
+//! let rules = [AclRule::ipv4(1, DENY, &Ipv4Match { src: (Ipv4Addr::new(10, 0, 0, 0), 8), ..Default::default() })];
+//! let acl = Acl::build("deny_list", None, &IPV4_5TUPLE, &rules)?;
+//! acl.classify_burst(&pkts, ETHER_HDR_LEN, &mut verdicts)?;
+//! ```
+
+use std::{
+    fmt,
+    mem::{self, MaybeUninit},
+    net::Ipv4Addr,
+    num::NonZeroU32,
+    ops::RangeInclusive,
+    ptr::{self, NonNull},
+};
+
+use rte_error::{Error, ReturnValue as _};
+
+use crate::{
+    mbuf::{Allocator, MBuf},
+    memory::SocketId,
+    unique_name, Result,
+};
+
+/// The field is matched against a value and a prefix length, e.g. an IP address and prefix.
+pub const FIELD_TYPE_MASK: u8 = 0;
+/// The field is matched against an inclusive range, e.g. a range of ports.
+pub const FIELD_TYPE_RANGE: u8 = 1;
+/// The field is matched against a value, after applying a bit mask, e.g. the IP protocol.
+pub const FIELD_TYPE_BITMASK: u8 = 2;
+
+/// The maximal number of fields of a rule.
+pub const MAX_FIELDS: usize = ffi::RTE_ACL_MAX_FIELDS as usize;
+
+/// The maximal number of bytes (starting at the offset passed to [`Acl::classify_burst`]) covered by the fields.
+pub const MAX_DATA_LEN: usize = 128;
+
+/// The number of packets classified by a single call to `rte_acl_classify`,
+/// larger bursts are classified in chunks of this size.
+const CLASSIFY_BULK_MAX: usize = 32;
+
+/// The definition of a field of the rules, i.e. where it's located in the classified data, and how it's matched.
+///
+/// All fields with the same `input_index` must be adjacent and span 4 bytes (e.g. the source and destination port),
+/// and the first field must be a single byte.
+pub type FieldDef = ffi::rte_acl_field_def;
+
+/// The fields of an IPv4 5-tuple, with offsets relative to the start of the IPv4 header (assuming it has no options),
+/// in the order expected by [`AclRule::ipv4`].
+pub const IPV4_5TUPLE: [FieldDef; 5] = [
+    FieldDef { type_: FIELD_TYPE_BITMASK, size: 1, field_index: 0, input_index: 0, offset: 9 },
+    FieldDef { type_: FIELD_TYPE_MASK, size: 4, field_index: 1, input_index: 1, offset: 12 },
+    FieldDef { type_: FIELD_TYPE_MASK, size: 4, field_index: 2, input_index: 2, offset: 16 },
+    FieldDef { type_: FIELD_TYPE_RANGE, size: 2, field_index: 3, input_index: 3, offset: 20 },
+    FieldDef { type_: FIELD_TYPE_RANGE, size: 2, field_index: 4, input_index: 3, offset: 22 },
+];
+
+/// A type that can be the value of a field of an [`AclRule`].
+pub trait FieldValue: Copy + sealed::Sealed {}
+
+impl FieldValue for u8 {}
+impl FieldValue for u16 {}
+impl FieldValue for u32 {}
+impl FieldValue for u64 {}
+
+mod sealed {
+    pub trait Sealed {}
+
+    impl Sealed for u8 {}
+    impl Sealed for u16 {}
+    impl Sealed for u32 {}
+    impl Sealed for u64 {}
+}
+
+/// A rule with `N` fields, laid out like rules defined by `RTE_ACL_RULE_DEF`.
+///
+/// Every field of a rule must be set (with a value of the size given by its [`FieldDef`]), note that a zeroed
+/// range field only matches zero.
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct AclRule<const N: usize> {
+    data: ffi::rte_acl_rule_data,
+    field: [ffi::rte_acl_field; N],
+}
+
+impl<const N: usize> AclRule<N> {
+    /// Creates a rule, whose fields are zeroed, which classifies the packets it matches as `userdata`.
+    ///
+    /// When several rules match a packet, the one with the highest `priority` wins.
+    #[inline]
+    pub fn new(priority: i32, userdata: NonZeroU32) -> Self {
+        Self {
+            data: ffi::rte_acl_rule_data { category_mask: 1, priority, userdata: userdata.get() },
+            field: [Default::default(); N],
+        }
+    }
+
+    /// Sets field `i` to match a value and a prefix length (for `FIELD_TYPE_MASK`), a range (`FIELD_TYPE_RANGE`),
+    /// or a value and a bit mask (`FIELD_TYPE_BITMASK`), in host byte order.
+    #[inline]
+    pub fn field<T>(mut self, i: usize, value: T, mask_range: T) -> Self
+    where
+        T: FieldValue,
+    {
+        let field = &mut self.field[i];
+        // the values are unions of the field value types
+        unsafe {
+            ptr::write(ptr::addr_of_mut!(field.value) as *mut T, value);
+            ptr::write(ptr::addr_of_mut!(field.mask_range) as *mut T, mask_range);
+        }
+        self
+    }
+
+    #[inline]
+    pub fn priority(&self) -> i32 {
+        self.data.priority
+    }
+
+    #[inline]
+    pub fn userdata(&self) -> NonZeroU32 {
+        // only set by `Self::new`
+        NonZeroU32::new(self.data.userdata).unwrap()
+    }
+}
+
+impl<const N: usize> fmt::Debug for AclRule<N> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("AclRule").field("priority", &self.data.priority).field("userdata", &self.data.userdata).finish()
+    }
+}
+
+/// The fields of an IPv4 5-tuple matched by a rule, see [`AclRule::ipv4`]. The default matches all packets.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct Ipv4Match {
+    /// Any protocol if `None`.
+    pub proto: Option<u8>,
+    /// The source prefix and its length.
+    pub src: (Ipv4Addr, u8),
+    /// The destination prefix and its length.
+    pub dst: (Ipv4Addr, u8),
+    pub src_ports: RangeInclusive<u16>,
+    pub dst_ports: RangeInclusive<u16>,
+}
+
+impl Default for Ipv4Match {
+    fn default() -> Self {
+        Self {
+            proto: None,
+            src: (Ipv4Addr::UNSPECIFIED, 0),
+            dst: (Ipv4Addr::UNSPECIFIED, 0),
+            src_ports: 0..=u16::MAX,
+            dst_ports: 0..=u16::MAX,
+        }
+    }
+}
+
+impl AclRule<5> {
+    /// Creates a rule matching an IPv4 5-tuple, whose fields are defined by [`IPV4_5TUPLE`].
+    #[inline]
+    pub fn ipv4(priority: i32, userdata: NonZeroU32, m: &Ipv4Match) -> Self {
+        Self::new(priority, userdata)
+            .field(0, m.proto.unwrap_or(0), if m.proto.is_some() { u8::MAX } else { 0 })
+            .field(1, u32::from(m.src.0), u32::from(m.src.1))
+            .field(2, u32::from(m.dst.0), u32::from(m.dst.1))
+            .field(3, *m.src_ports.start(), *m.src_ports.end())
+            .field(4, *m.dst_ports.start(), *m.dst_ports.end())
+    }
+}
+
+/// A built set of rules, see the [module documentation](self).
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__acl_8h.html>
+pub struct Acl {
+    ptr: NonNull<ffi::rte_acl_ctx>,
+    /// The number of bytes read by the classifier
+    data_len: usize,
+}
+
+// # Safety
+// A built context is never modified, and `rte_acl_classify` is thread-safe
+unsafe impl Send for Acl {}
+unsafe impl Sync for Acl {}
+
+impl Acl {
+    /// Builds a set of rules, whose fields are defined by `defs`, on the given socket (or on any socket, if `None`).
+    ///
+    /// The context's name (which DPDK requires to be unique) is `name` suffixed with a unique id, so that `name` can be
+    /// reused when rebuilding the rules, and must be short enough for the suffixed name to fit in `RTE_ACL_NAMESIZE`
+    /// bytes.
+    ///
+    /// Fails with `EINVAL` if the rules are invalid (e.g. `defs` reach beyond [`MAX_DATA_LEN`] bytes), and with
+    /// `ENOMEM` if there isn't enough memory for the classifier's tries.
+    pub fn build<const N: usize>(
+        name: &str,
+        socket_id: Option<SocketId>,
+        defs: &[FieldDef; N],
+        rules: &[AclRule<N>],
+    ) -> Result<Self> {
+        let data_len = defs.iter().map(|def| def.offset as usize + mem::size_of::<u32>()).max().unwrap_or(0);
+        if N == 0 || N > MAX_FIELDS || data_len > MAX_DATA_LEN {
+            return Err(Error(libc::EINVAL));
+        }
+
+        let name = unique_name(name);
+        let param = ffi::rte_acl_param {
+            name: name.as_ptr(),
+            socket_id: socket_id.map(|id| id.get() as i32).unwrap_or(-1),
+            rule_size: mem::size_of::<AclRule<N>>() as u32,
+            max_rule_num: rules.len().max(1) as u32,
+        };
+        let ptr = unsafe { ffi::rte_acl_create(&param) }.rte_ok()?;
+        // freed on error
+        let acl = Self { ptr, data_len };
+
+        unsafe { ffi::rte_acl_add_rules(acl.as_ptr(), rules.as_ptr() as *const ffi::rte_acl_rule, rules.len() as u32) }
+            .rte_ok()?;
+
+        let mut config = ffi::rte_acl_config { num_categories: 1, num_fields: N as u32, ..Default::default() };
+        config.defs[..N].copy_from_slice(defs);
+        unsafe { ffi::rte_acl_build(acl.as_ptr(), &config) }.rte_ok()?;
+
+        Ok(acl)
+    }
+
+    #[inline]
+    fn as_ptr(&self) -> *mut ffi::rte_acl_ctx {
+        self.ptr.as_ptr()
+    }
+
+    /// Classifies a burst of packets, whose fields are located at `offset` bytes from the start of their data (e.g. at
+    /// the start of their IPv4 header, for [`IPV4_5TUPLE`]), setting the value at the same index of `verdicts` (which
+    /// must be at least as long as `pkts`) to the userdata of the highest priority rule matching the packet, or to
+    /// `None` if none does.
+    ///
+    /// The bytes beyond the end of a packet's first segment are classified as zeros.
+    ///
+    /// Returns the number of packets that matched a rule, or the error returned by `rte_acl_classify` (e.g. `EINVAL`).
+    #[inline]
+    pub fn classify_burst<A>(
+        &self,
+        pkts: &[MBuf<A>],
+        offset: usize,
+        verdicts: &mut [Option<NonZeroU32>],
+    ) -> Result<usize>
+    where
+        A: Allocator,
+    {
+        assert!(verdicts.len() >= pkts.len());
+
+        let mut found = 0;
+        for (pkts, verdicts) in pkts.chunks(CLASSIFY_BULK_MAX).zip(verdicts.chunks_mut(CLASSIFY_BULK_MAX)) {
+            let mut data = [ptr::null::<u8>(); CLASSIFY_BULK_MAX];
+            // short packets are copied here, zero-padded
+            let mut scratch = [MaybeUninit::<[u8; MAX_DATA_LEN]>::uninit(); CLASSIFY_BULK_MAX];
+            for (i, pkt) in pkts.iter().enumerate() {
+                let pkt_data = pkt.get(offset..).unwrap_or_default();
+                data[i] = if pkt_data.len() >= self.data_len {
+                    pkt_data.as_ptr()
+                } else {
+                    let buf = scratch[i].write([0; MAX_DATA_LEN]);
+                    buf[..pkt_data.len()].copy_from_slice(pkt_data);
+                    buf.as_ptr()
+                };
+            }
+
+            found += self.classify_raw(&mut data[..pkts.len()], verdicts)?;
+        }
+        Ok(found)
+    }
+
+    /// Classifies at most [`CLASSIFY_BULK_MAX`] buffers of at least `self.data_len` bytes.
+    #[inline]
+    fn classify_raw(&self, data: &mut [*const u8], verdicts: &mut [Option<NonZeroU32>]) -> Result<usize> {
+        // `Option<NonZeroU32>` has the same layout as `u32`, and no match is 0
+        unsafe {
+            ffi::rte_acl_classify(
+                self.as_ptr(),
+                data.as_mut_ptr(),
+                verdicts.as_mut_ptr() as *mut u32,
+                data.len() as u32,
+                1,
+            )
+        }
+        .rte_ok()?;
+        Ok(verdicts[..data.len()].iter().filter(|verdict| verdict.is_some()).count())
+    }
+}
+
+impl fmt::Debug for Acl {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Acl").field("ptr", &self.ptr).field("data_len", &self.data_len).finish()
+    }
+}
+
+impl Drop for Acl {
+    #[inline]
+    fn drop(&mut self) {
+        unsafe { ffi::rte_acl_free(self.as_ptr()) }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::sync::Arc;
+
+    use arrayvec::ArrayVec;
+    use rte_test_macros::rte_test;
+
+    use super::*;
+    use crate::{
+        mbuf::{alloc_mbufs, GlobalAllocator},
+        rcu::RcuCell,
+    };
+
+    fn ipv4_udp(src: [u8; 4], dst_port: u16) -> Vec<u8> {
+        let mut pkt = vec![0; 28];
+        pkt[0] = 0x45;
+        pkt[9] = 17;
+        pkt[12..16].copy_from_slice(&src);
+        pkt[22..24].copy_from_slice(&dst_port.to_be_bytes());
+        pkt
+    }
+
+    #[rte_test(mock_lcore)]
+    fn classify_and_swap() {
+        let (allow, deny) = (NonZeroU32::new(1).unwrap(), NonZeroU32::new(2).unwrap());
+        let rules = [
+            AclRule::ipv4(1, deny, &Ipv4Match { src: (Ipv4Addr::new(10, 0, 0, 0), 8), ..Default::default() }),
+            AclRule::ipv4(
+                2,
+                allow,
+                &Ipv4Match {
+                    proto: Some(17),
+                    src: (Ipv4Addr::new(10, 1, 0, 0), 16),
+                    dst_ports: 53..=53,
+                    ..Default::default()
+                },
+            ),
+        ];
+        let acl = Arc::new(RcuCell::new(Acl::build("acl_test", None, &IPV4_5TUPLE, &rules).unwrap()));
+        let mut reader = acl.reader();
+
+        let pkts: ArrayVec<MBuf<GlobalAllocator>, 8> = alloc_mbufs([
+            ipv4_udp([10, 2, 0, 1], 53),
+            ipv4_udp([10, 1, 0, 1], 53),
+            ipv4_udp([10, 1, 0, 1], 80),
+            ipv4_udp([192, 168, 0, 1], 53),
+            // truncated, bytes beyond the end are zeros
+            ipv4_udp([10, 1, 0, 1], 53)[..16].to_vec(),
+        ]);
+        let mut verdicts = [None; 5];
+        assert_eq!(reader.get().classify_burst(&pkts, 0, &mut verdicts).unwrap(), 4);
+        assert_eq!(verdicts, [Some(deny), Some(allow), Some(deny), None, Some(deny)]);
+        // the reader would otherwise have to report a quiescent state from another thread
+        reader.offline();
+
+        // the rules can be rebuilt with the same name while they're in use
+        let rules = [AclRule::ipv4(1, allow, &Ipv4Match::default())];
+        acl.publish(Acl::build("acl_test", None, &IPV4_5TUPLE, &rules).unwrap());
+        assert_eq!(reader.get().classify_burst(&pkts, 0, &mut verdicts).unwrap(), 5);
+        assert_eq!(verdicts, [Some(allow); 5]);
+    }
+}
@@ -0,0 +1,98 @@
+use std::{ffi::CString, mem, os::raw::c_void, ptr::NonNull};
+
+use rte_error::{Error, ReturnValue as _};
+
+use crate::{
+    mbuf::{Allocator, MBuf},
+    Result,
+};
+
+/// An eBPF program that selects the packets to capture, based on DPDK's
+/// [BPF Library](https://doc.dpdk.org/guides-21.08/prog_guide/bpf_lib.html), which runs JIT-compiled when the
+/// platform supports it (and interpreted otherwise).
+///
+/// The program is called with a pointer to each packet's `rte_mbuf` (`RTE_BPF_ARG_PTR_MBUF`), and the packet is
+/// captured if it returns a non-zero value, like a classic BPF filter running in `tcpdump`.
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__bpf_8h.html>
+#[derive(Debug)]
+pub struct BpfFilter {
+    bpf: NonNull<ffi::rte_bpf>,
+    jit: Option<unsafe extern "C" fn(*mut c_void) -> u64>,
+}
+
+// # Safety
+// A loaded program is never modified, and running it only uses the stack of the calling thread
+unsafe impl Send for BpfFilter {}
+unsafe impl Sync for BpfFilter {}
+
+impl BpfFilter {
+    #[inline]
+    fn params(ins: &[ffi::ebpf_insn]) -> ffi::rte_bpf_prm {
+        ffi::rte_bpf_prm {
+            ins: ins.as_ptr(),
+            nb_ins: ins.len() as u32,
+            prog_arg: ffi::rte_bpf_arg {
+                type_: ffi::rte_bpf_arg_type::RTE_BPF_ARG_PTR_MBUF,
+                size: mem::size_of::<ffi::rte_mbuf>(),
+                buf_size: ffi::RTE_MBUF_DEFAULT_BUF_SIZE as usize,
+            },
+            ..Default::default()
+        }
+    }
+
+    #[inline]
+    fn from_raw(bpf: NonNull<ffi::rte_bpf>) -> Self {
+        let mut jit: ffi::rte_bpf_jit = Default::default();
+        let jit = (unsafe { ffi::rte_bpf_get_jit(bpf.as_ptr(), &mut jit) } == 0).then(|| jit.func).flatten();
+        Self { bpf, jit }
+    }
+
+    /// Loads a program from its eBPF instructions.
+    ///
+    /// Fails with `EINVAL` if the program doesn't pass the verifier.
+    pub fn new(ins: &[ffi::ebpf_insn]) -> Result<Self> {
+        let prm = Self::params(ins);
+        let bpf = unsafe { ffi::rte_bpf_load(&prm) }.rte_ok()?;
+        Ok(Self::from_raw(bpf))
+    }
+
+    /// Loads a program from the section `section` of an ELF object file, e.g. compiled with
+    /// `clang -O2 -target bpf -c filter.c`.
+    ///
+    /// Fails with `ENOTSUP` if DPDK was built without `libelf`.
+    pub fn from_elf<P: Into<Vec<u8>>, S: Into<Vec<u8>>>(path: P, section: S) -> Result<Self> {
+        let path = CString::new(path).map_err(|_| Error(libc::EINVAL))?;
+        let section = CString::new(section).map_err(|_| Error(libc::EINVAL))?;
+        let prm = Self::params(&[]);
+        let bpf = unsafe { ffi::rte_bpf_elf_load(&prm, path.as_ptr(), section.as_ptr()) }.rte_ok()?;
+        Ok(Self::from_raw(bpf))
+    }
+
+    /// Returns `true` if the program has been JIT-compiled.
+    #[inline]
+    pub fn is_jit(&self) -> bool {
+        self.jit.is_some()
+    }
+
+    /// Runs the program on `pkt`, returning `true` if the packet should be captured.
+    #[inline]
+    pub fn matches<A>(&self, pkt: &MBuf<A>) -> bool
+    where
+        A: Allocator,
+    {
+        // the program only reads the packet, through the pointer to its `rte_mbuf`
+        let ctx = unsafe { pkt.as_raw() } as *mut c_void;
+        let ret = match self.jit {
+            Some(func) => unsafe { func(ctx) },
+            None => unsafe { ffi::rte_bpf_exec(self.bpf.as_ptr(), ctx) },
+        };
+        ret != 0
+    }
+}
+
+impl Drop for BpfFilter {
+    fn drop(&mut self) {
+        unsafe { ffi::rte_bpf_destroy(self.bpf.as_ptr()) }
+    }
+}
@@ -0,0 +1,337 @@
+//! Capturing packets from the data path into a pcapng file, without stopping it, based on DPDK's
+//! [Packet Capture Next Generation Library](https://doc.dpdk.org/guides-21.08/prog_guide/pcapng_lib.html).
+//!
+//! - Each lcore that receives (or transmits) packets owns a [`CaptureTap`], which it calls with every burst, right
+//!   after [`EthDev::rx_burst`] (or right before [`EthDev::tx_burst`]). While the capture is disabled, a tap costs a
+//!   single (well predicted) branch per burst.
+//! - When the capture is enabled (see [`CaptureControl`]), the tap samples 1 in N packets, filters them with an
+//!   optional [`BpfFilter`], and hands them over to the capture lcore over a ring, as [`SharedMBuf`] clones (i.e.
+//!   without copying their data). When the ring is full, the packets are shed rather than slowing down the data path.
+//! - The capture lcore polls a [`Capture`], which copies the packets to the pcapng format (along with their hardware
+//!   timestamps, if a [`ClockSync`] was provided for their port), writes them, and releases the clones.
+//!
+//! Since the captured packets are clones, the tapped packets must not be modified once they've been tapped, which
+//! [`SharedMBuf`] guarantees; packets which are modified by the data path should be tapped when they're transmitted.
+//! The clones hold on to the tapped packets' mbufs until they're written, so the memory pools of the tapped packets
+//! should have room for the capacity of the rings of their taps.
+//!
+//! [`EthDev::rx_burst`]: crate::ethdev::EthDev::rx_burst
+//! [`EthDev::tx_burst`]: crate::ethdev::EthDev::tx_burst
+
+mod bpf;
+mod pcapng;
+
+use std::{
+    num::NonZeroU32,
+    sync::{
+        atomic::{AtomicBool, AtomicU32, AtomicU64, Ordering},
+        Arc,
+    },
+};
+
+use arrayvec::ArrayVec;
+
+pub use self::{
+    bpf::BpfFilter,
+    pcapng::{mbuf_size, PcapngWriter},
+};
+use crate::{
+    cycles::rdtsc,
+    latency::ClockSync,
+    mbuf::{MBuf, MetadataExt, SharedMBuf},
+    mempool::MemoryPool,
+    ring::{Consumer, Producer, Ring, SyncMode},
+    Result,
+};
+
+/// The number of packets cloned (or written) at once.
+const BURST_SIZE: usize = 32;
+
+type Captured<'mempool> = SharedMBuf<&'mempool MemoryPool>;
+
+/// Whether the packets of a tap are received or transmitted.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Direction {
+    Rx,
+    Tx,
+}
+
+impl Direction {
+    #[inline]
+    fn to_raw(self) -> ffi::rte_pcapng_direction::Type {
+        match self {
+            Direction::Rx => ffi::rte_pcapng_direction::RTE_PCAPNG_DIRECTION_IN,
+            Direction::Tx => ffi::rte_pcapng_direction::RTE_PCAPNG_DIRECTION_OUT,
+        }
+    }
+}
+
+/// The state shared by a capture and its taps.
+#[derive(Debug)]
+struct State {
+    enabled: AtomicBool,
+    sample_rate: AtomicU32,
+    captured: AtomicU64,
+    shed: AtomicU64,
+}
+
+/// The number of packets written by a capture, and shed by its taps (because their ring was full, or because a memory
+/// pool was exhausted) since it was created.
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct CaptureStats {
+    pub captured: u64,
+    pub shed: u64,
+}
+
+/// Enables and disables a capture, e.g. from the control plane, while the taps and the capture are running.
+#[derive(Debug, Clone)]
+pub struct CaptureControl(Arc<State>);
+
+impl CaptureControl {
+    #[inline]
+    pub fn enable(&self) {
+        self.0.enabled.store(true, Ordering::Relaxed);
+    }
+
+    #[inline]
+    pub fn disable(&self) {
+        self.0.enabled.store(false, Ordering::Relaxed);
+    }
+
+    #[inline]
+    pub fn is_enabled(&self) -> bool {
+        self.0.enabled.load(Ordering::Relaxed)
+    }
+
+    /// Captures 1 in `sample_rate` packets of each tap (all of them, by default).
+    #[inline]
+    pub fn set_sample_rate(&self, sample_rate: NonZeroU32) {
+        self.0.sample_rate.store(sample_rate.get(), Ordering::Relaxed);
+    }
+
+    #[inline]
+    pub fn stats(&self) -> CaptureStats {
+        CaptureStats { captured: self.0.captured.load(Ordering::Relaxed), shed: self.0.shed.load(Ordering::Relaxed) }
+    }
+}
+
+/// The data path side of a capture, for a single queue of a port, see [`Capture::add_tap`].
+#[derive(Debug)]
+pub struct CaptureTap<'mempool> {
+    state: Arc<State>,
+    producer: Producer<'mempool, Captured<'mempool>>,
+    filter: Option<Arc<BpfFilter>>,
+    /// The number of packets until the next sampled one
+    countdown: u32,
+}
+
+impl<'mempool> CaptureTap<'mempool> {
+    /// Captures the sampled packets of a burst that match the filter, if the capture is enabled.
+    #[inline]
+    pub fn tap(&mut self, pkts: &[Captured<'mempool>]) {
+        if self.state.enabled.load(Ordering::Relaxed) {
+            self.tap_enabled(pkts);
+        }
+    }
+
+    #[inline(never)]
+    fn tap_enabled(&mut self, pkts: &[Captured<'mempool>]) {
+        let sample_rate = self.state.sample_rate.load(Ordering::Relaxed);
+        self.countdown = self.countdown.min(sample_rate);
+
+        let mut shed = 0;
+        let mut clones = ArrayVec::<_, BURST_SIZE>::new();
+        for chunk in pkts.chunks(BURST_SIZE) {
+            for pkt in chunk {
+                self.countdown -= 1;
+                if self.countdown > 0 {
+                    continue;
+                }
+                self.countdown = sample_rate;
+
+                if self.filter.as_ref().map_or(true, |filter| filter.matches(pkt)) {
+                    match pkt.try_clone() {
+                        Ok(clone) => clones.push(clone),
+                        Err(_) => shed += 1,
+                    }
+                }
+            }
+
+            if !clones.is_empty() {
+                self.producer.enqueue_burst(&mut clones);
+                shed += clones.len();
+                clones.clear();
+            }
+        }
+
+        if shed > 0 {
+            self.state.shed.fetch_add(shed as u64, Ordering::Relaxed);
+        }
+    }
+}
+
+/// The receiving end of a tap.
+#[derive(Debug)]
+struct Source<'mempool> {
+    consumer: Consumer<'mempool, Captured<'mempool>>,
+    port_id: u16,
+    queue_id: u16,
+    direction: Direction,
+}
+
+/// The capture lcore side of a capture, which writes the packets of all its taps to a pcapng file.
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__pcapng_8h.html>
+#[derive(Debug)]
+pub struct Capture<'mempool> {
+    state: Arc<State>,
+    writer: PcapngWriter,
+    mempool: &'mempool MemoryPool,
+    snap_len: u32,
+    sources: Vec<Source<'mempool>>,
+    clocks: Vec<ClockSync>,
+}
+
+impl<'mempool> Capture<'mempool> {
+    /// Creates a (disabled) capture, which truncates packets to `snap_len` bytes, and copies them to `mempool`, whose
+    /// data room size must be at least [`mbuf_size(snap_len)`](mbuf_size).
+    pub fn new(writer: PcapngWriter, mempool: &'mempool MemoryPool, snap_len: u32) -> Self {
+        let state = State {
+            enabled: AtomicBool::new(false),
+            sample_rate: AtomicU32::new(1),
+            captured: AtomicU64::new(0),
+            shed: AtomicU64::new(0),
+        };
+        Self { state: Arc::new(state), writer, mempool, snap_len, sources: Vec::new(), clocks: Vec::new() }
+    }
+
+    #[inline]
+    pub fn control(&self) -> CaptureControl {
+        CaptureControl(self.state.clone())
+    }
+
+    /// Creates a tap for the queue `queue_id` of the port `port_id`, whose ring (named `name`) holds up to `ring_size`
+    /// packets, and which only captures the packets matching `filter`, if any.
+    pub fn add_tap<S: Into<Vec<u8>>>(
+        &mut self,
+        name: S,
+        port_id: u16,
+        queue_id: u16,
+        direction: Direction,
+        ring_size: u32,
+        filter: Option<Arc<BpfFilter>>,
+    ) -> Result<CaptureTap<'mempool>> {
+        let (producer, consumer) = Ring::new(name, ring_size, None, SyncMode::Single, SyncMode::Single)?;
+        self.sources.push(Source { consumer, port_id, queue_id, direction });
+        Ok(CaptureTap { state: self.state.clone(), producer, filter, countdown: 1 })
+    }
+
+    /// Converts the hardware timestamps of the packets received from `clock`'s device, instead of timestamping them
+    /// when they're written.
+    pub fn set_clock(&mut self, clock: ClockSync) {
+        self.clocks.retain(|c| c.dev() != clock.dev());
+        self.clocks.push(clock);
+    }
+
+    /// Writes the packets captured by the taps, and returns their number.
+    ///
+    /// Should be called in a loop by the capture lcore, while the capture is enabled.
+    pub fn poll(&mut self) -> Result<usize> {
+        let mut captured = 0;
+        let mut shed = 0;
+        for source in &mut self.sources {
+            let mut pkts = ArrayVec::<_, BURST_SIZE>::new();
+            if source.consumer.dequeue_burst(&mut pkts) == 0 {
+                continue;
+            }
+
+            let now = rdtsc();
+            let clock = match source.direction {
+                Direction::Rx => self.clocks.iter().find(|c| c.dev().port_id() == source.port_id),
+                Direction::Tx => None,
+            };
+
+            let mut copies = ArrayVec::<MBuf<&MemoryPool>, BURST_SIZE>::new();
+            for pkt in &pkts {
+                let timestamp = clock.and_then(|clock| pkt.rx_timestamp().map(|ts| clock.to_tsc(ts))).unwrap_or(now);
+                let copy = unsafe {
+                    ffi::rte_pcapng_copy(
+                        source.port_id,
+                        source.queue_id.into(),
+                        pkt.as_raw(),
+                        self.mempool.0.as_ptr(),
+                        self.snap_len,
+                        timestamp,
+                        source.direction.to_raw(),
+                    )
+                };
+                if copy.is_null() {
+                    shed += 1;
+                    continue;
+                }
+                unsafe {
+                    // `MBuf` is a transparent wrapper around `NonNull<rte_mbuf>`, see also `EthDev::rx_burst`
+                    (copies.as_mut_ptr().add(copies.len()) as *mut *mut ffi::rte_mbuf).write(copy);
+                    copies.set_len(copies.len() + 1);
+                }
+            }
+            // release the tapped packets as soon as possible
+            drop(pkts);
+
+            self.writer.write_packets(&mut copies)?;
+            captured += copies.len();
+        }
+
+        self.state.captured.fetch_add(captured as u64, Ordering::Relaxed);
+        self.state.shed.fetch_add(shed, Ordering::Relaxed);
+        Ok(captured)
+    }
+
+    /// Returns the pcapng file, e.g. for writing the statistics of the ports.
+    #[inline]
+    pub fn writer(&mut self) -> &mut PcapngWriter {
+        &mut self.writer
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::fs::{self, File};
+
+    use rte_test_macros::rte_test;
+
+    use super::*;
+
+    #[rte_test(mock_lcore)]
+    fn capture_sampled_packets() {
+        let mempool =
+            MemoryPool::new("capture_test_pool", 64, 0, 0, ffi::RTE_MBUF_DEFAULT_BUF_SIZE as u16, None).unwrap();
+        let copies = MemoryPool::new("capture_test_copies", 64, 0, 0, mbuf_size(128) as u16, None).unwrap();
+        let path = std::env::temp_dir().join(format!("capture_test_{}.pcapng", std::process::id()));
+        let writer = PcapngWriter::new(File::create(&path).unwrap(), "rte").unwrap();
+
+        let mut capture = Capture::new(writer, &copies, 128);
+        let control = capture.control();
+        let mut tap = capture.add_tap("capture_test_ring", 0, 0, Direction::Rx, 2, None).unwrap();
+        let pkts =
+            (0..8u8).map(|i| MBuf::new_with_provider_and_data(&&mempool, [i; 60]).into_shared()).collect::<Vec<_>>();
+
+        // disabled by default
+        tap.tap(&pkts);
+        assert_eq!(capture.poll().unwrap(), 0);
+
+        // 4 packets are sampled, but the ring only has room for 2 of them
+        control.set_sample_rate(NonZeroU32::new(2).unwrap());
+        control.enable();
+        tap.tap(&pkts);
+        assert_eq!(capture.poll().unwrap(), 2);
+        assert_eq!(control.stats(), CaptureStats { captured: 2, shed: 2 });
+        assert_eq!((mempool.get_in_use_count(), copies.get_in_use_count()), (8, 0));
+
+        drop((tap, capture));
+        let data = fs::read(&path).unwrap();
+        fs::remove_file(&path).unwrap();
+        // a section header block
+        assert_eq!(data[..4], [0x0a, 0x0d, 0x0d, 0x0a]);
+    }
+}
@@ -0,0 +1,87 @@
+use std::{ffi::CString, fs::File, io, os::unix::io::IntoRawFd, ptr::NonNull};
+
+use arrayvec::ArrayVec;
+use rte_error::Error;
+
+use crate::{mbuf::MBuf, mempool::MemoryPool, Result};
+
+/// Returns the size of the mbufs holding the pcapng copies of packets truncated to `snap_len` bytes,
+/// i.e. the data room size of the memory pool of a [`Capture`](super::Capture).
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__pcapng_8h.html>
+#[inline]
+pub fn mbuf_size(snap_len: u32) -> u32 {
+    unsafe { ffi::rte_pcapng_mbuf_size(snap_len) }
+}
+
+/// Returns the current error of a system call, which the pcapng library doesn't report through `rte_errno`.
+#[inline]
+fn os_error() -> Error {
+    Error(io::Error::last_os_error().raw_os_error().unwrap_or(libc::EIO))
+}
+
+/// A pcapng file, which can be opened by Wireshark or any other tool based on `libpcap`.
+///
+/// The file starts with a description of every ethernet device at the time it's created, so it should be created once
+/// all devices have been probed.
+#[derive(Debug)]
+pub struct PcapngWriter {
+    ptr: NonNull<ffi::rte_pcapng_t>,
+}
+
+// # Safety
+// The writer is only ever accessed mutably, and the file descriptor it owns can be used from any thread
+unsafe impl Send for PcapngWriter {}
+
+impl PcapngWriter {
+    /// Starts writing a pcapng file to `file`, which is closed when the writer is dropped. `app_name` is recorded as
+    /// the name of the application which captured the packets.
+    pub fn new<S: Into<Vec<u8>>>(file: File, app_name: S) -> Result<Self> {
+        let app_name = CString::new(app_name).map_err(|_| Error(libc::EINVAL))?;
+        let fd = file.into_raw_fd();
+        let ptr = unsafe {
+            ffi::rte_pcapng_fdopen(fd, std::ptr::null(), std::ptr::null(), app_name.as_ptr(), std::ptr::null())
+        };
+        NonNull::new(ptr)
+            .ok_or_else(|| {
+                let err = os_error();
+                unsafe { libc::close(fd) };
+                err
+            })
+            .map(|ptr| Self { ptr })
+    }
+
+    /// Writes packets copied with `rte_pcapng_copy`, and returns the number of bytes written.
+    #[inline]
+    pub(super) fn write_packets<const CAP: usize>(
+        &mut self,
+        pkts: &mut ArrayVec<MBuf<&MemoryPool>, CAP>,
+    ) -> Result<usize> {
+        // `MBuf` is a transparent wrapper around `NonNull<rte_mbuf>`
+        let written =
+            unsafe { ffi::rte_pcapng_write_packets(self.ptr.as_ptr(), pkts.as_mut_ptr() as _, pkts.len() as u16) };
+        if written < 0 {
+            return Err(os_error());
+        }
+        Ok(written as usize)
+    }
+
+    /// Writes the statistics of a port, e.g. the number of packets it has received and dropped since the capture
+    /// started, which tools display along with the captured packets.
+    pub fn write_stats(&mut self, port_id: u16, received: u64, dropped: u64) -> Result<()> {
+        // zero start and end times are left out of the statistics block
+        let written = unsafe {
+            ffi::rte_pcapng_write_stats(self.ptr.as_ptr(), port_id, std::ptr::null(), 0, 0, received, dropped)
+        };
+        if written < 0 {
+            return Err(os_error());
+        }
+        Ok(())
+    }
+}
+
+impl Drop for PcapngWriter {
+    fn drop(&mut self) {
+        unsafe { ffi::rte_pcapng_close(self.ptr.as_ptr()) }
+    }
+}
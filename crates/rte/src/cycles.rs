@@ -0,0 +1,39 @@
+//! Access to the CPU's time stamp counter (TSC), the cheapest clock available on the data path.
+//!
+//! See also: <https://doc.dpdk.org/api-21.08/rte__cycles_8h.html>
+
+use std::time::Duration;
+
+/// Reads the current value of the TSC, equivalent to `rte_rdtsc`.
+///
+/// On `x86_64` this compiles down to a single `rdtsc` instruction, other architectures go through a C shim.
+#[inline(always)]
+pub fn rdtsc() -> u64 {
+    #[cfg(target_arch = "x86_64")]
+    unsafe {
+        std::arch::x86_64::_rdtsc()
+    }
+
+    #[cfg(not(target_arch = "x86_64"))]
+    unsafe {
+        ffi::_rte_rdtsc()
+    }
+}
+
+/// Returns the frequency of the TSC, in cycles per second, as measured by the EAL on initialization.
+#[inline]
+pub fn tsc_hz() -> u64 {
+    unsafe { ffi::rte_get_tsc_hz() }
+}
+
+/// Converts a duration into a number of TSC cycles.
+#[inline]
+pub fn duration_to_cycles(duration: Duration) -> u64 {
+    (duration.as_nanos() * u128::from(tsc_hz()) / 1_000_000_000) as u64
+}
+
+/// Converts a number of TSC cycles into a duration.
+#[inline]
+pub fn cycles_to_duration(cycles: u64) -> Duration {
+    Duration::from_nanos((u128::from(cycles) * 1_000_000_000 / u128::from(tsc_hz().max(1))) as u64)
+}
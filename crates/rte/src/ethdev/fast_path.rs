@@ -0,0 +1,78 @@
+//! A Rust port of DPDK's inline `rte_eth_rx_burst`, `rte_eth_tx_burst` and `rte_eth_tx_prepare` functions.
+//!
+//! Calling the C shims exported by `rte-sys` costs an extra (non-inlineable) function call per burst. Instead, the functions
+//! in this module call the PMD's burst functions directly, through the [`rte_eth_fp_ops`](ffi::rte_eth_fp_ops) array, which
+//! is exactly what the inline C implementations do, so that the Rust compiler can inline the whole path up to the driver.
+//!
+//! Enabled with the `fast-path` feature.
+//!
+//! # Implementation notes
+//! - The `RTE_ETHDEV_DEBUG_RX`/`RTE_ETHDEV_DEBUG_TX` port and queue validations are not ported.
+//! - Fast-path trace points (`rte_ethdev_trace_rx_burst`/`rte_ethdev_trace_tx_burst`) are not emitted.
+//! - RX/TX callbacks (enabled by default in DPDK with `RTE_ETHDEV_RXTX_CALLBACKS`) are supported.
+//!
+//! See also: <https://doc.dpdk.org/api-22.11/rte__ethdev_8h_source.html>
+
+use std::{
+    os::raw::c_void,
+    ptr::addr_of,
+    sync::atomic::{AtomicPtr, Ordering},
+};
+
+#[inline(always)]
+unsafe fn fp_ops(port_id: u16) -> *const ffi::rte_eth_fp_ops {
+    (addr_of!(ffi::rte_eth_fp_ops) as *const ffi::rte_eth_fp_ops).add(port_id.into())
+}
+
+#[inline(always)]
+unsafe fn load_callback(clbk: *mut *mut c_void, queue_id: u16) -> *mut c_void {
+    // the callback list head is published by DPDK with `__ATOMIC_RELEASE`, and since there is a data dependency
+    // between it and the callback's fields, a relaxed load is sufficient (same as the C implementation)
+    (*(clbk.add(queue_id.into()) as *const AtomicPtr<c_void>)).load(Ordering::Relaxed)
+}
+
+/// Equivalent to `rte_eth_rx_burst`, see [`ffi::_rte_eth_rx_burst`].
+#[inline(always)]
+pub(super) unsafe fn rx_burst(port_id: u16, queue_id: u16, rx_pkts: *mut *mut ffi::rte_mbuf, nb_pkts: u16) -> u16 {
+    let ops = &*fp_ops(port_id);
+    let queue_data = *ops.rxq.data.add(queue_id.into());
+
+    // DPDK sets dummy burst functions for ports that were not started, so these are never NULL
+    let rx_pkt_burst = ops.rx_pkt_burst.unwrap_unchecked();
+    let nb_rx = rx_pkt_burst(queue_data, rx_pkts, nb_pkts);
+
+    let callback = load_callback(ops.rxq.clbk, queue_id);
+    if !callback.is_null() {
+        return ffi::rte_eth_call_rx_callbacks(port_id, queue_id, rx_pkts, nb_rx, nb_pkts, callback);
+    }
+
+    nb_rx
+}
+
+/// Equivalent to `rte_eth_tx_burst`, see [`ffi::_rte_eth_tx_burst`].
+#[inline(always)]
+pub(super) unsafe fn tx_burst(port_id: u16, queue_id: u16, tx_pkts: *mut *mut ffi::rte_mbuf, mut nb_pkts: u16) -> u16 {
+    let ops = &*fp_ops(port_id);
+    let queue_data = *ops.txq.data.add(queue_id.into());
+
+    let callback = load_callback(ops.txq.clbk, queue_id);
+    if !callback.is_null() {
+        nb_pkts = ffi::rte_eth_call_tx_callbacks(port_id, queue_id, tx_pkts, nb_pkts, callback);
+    }
+
+    let tx_pkt_burst = ops.tx_pkt_burst.unwrap_unchecked();
+    tx_pkt_burst(queue_data, tx_pkts, nb_pkts)
+}
+
+/// Equivalent to `rte_eth_tx_prepare`, see [`ffi::_rte_eth_tx_prepare`].
+#[inline(always)]
+pub(super) unsafe fn tx_prepare(port_id: u16, queue_id: u16, tx_pkts: *mut *mut ffi::rte_mbuf, nb_pkts: u16) -> u16 {
+    let ops = &*fp_ops(port_id);
+    let queue_data = *ops.txq.data.add(queue_id.into());
+
+    // drivers which don't have any TX offload requirements don't set a prepare function
+    match ops.tx_pkt_prepare {
+        Some(tx_pkt_prepare) => tx_pkt_prepare(queue_data, tx_pkts, nb_pkts),
+        None => nb_pkts,
+    }
+}
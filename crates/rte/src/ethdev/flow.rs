@@ -0,0 +1,496 @@
+//! Hardware flow rules, based on DPDK's [Generic Flow API](https://doc.dpdk.org/guides-21.08/prog_guide/rte_flow.html).
+//!
+//! A [`FlowRule`] is built from a pattern (a stack of protocol layers to match, from the outermost inwards)
+//! and a list of actions to apply to matching packets, for example:
+//! ```rust,no_run
+//! # use std::net::Ipv4Addr;
+//! # use rte::ethdev::{EthDev, flow::{FlowRule, Ipv4Match, L4Match}};
+//! # fn example(dev: &EthDev) -> Result<(), rte_error::Error> {
+//! // drop DNS responses from a given subnet, and count them
+//! let flow = FlowRule::ingress()
+//!     .eth(Default::default())
+//!     .ipv4(Ipv4Match { src: Some((Ipv4Addr::new(10, 0, 0, 0), 8)), ..Default::default() })
+//!     .udp(L4Match { src_port: Some(53), ..Default::default() })
+//!     .count()
+//!     .drop_packets()
+//!     .create(dev)?;
+//!
+//! let hits = flow.query_count(false)?.hits;
+//! # Ok(())
+//! # }
+//! ```
+//!
+//! Packets matched by a rule with a [`FlowRule::mark`] action carry the mark's value,
+//! which is available through [`MetadataExt::flow_mark`](crate::mbuf::MetadataExt::flow_mark).
+
+use std::{
+    net::{Ipv4Addr, Ipv6Addr},
+    os::raw::c_void,
+    ptr::{self, NonNull},
+};
+
+use mac_addr::MacAddr;
+use rte_error::ReturnValue as _;
+
+use super::EthDev;
+use crate::{flags::EthRss, Result};
+
+/// Matches an Ethernet header. Fields set to `None` match any value.
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct EthMatch {
+    pub src: Option<MacAddr>,
+    pub dst: Option<MacAddr>,
+    /// The EtherType, in host byte order.
+    pub ether_type: Option<u16>,
+}
+
+/// Matches an IPv4 header. Addresses are matched along with a prefix length, e.g. `(10.0.0.0, 8)`.
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct Ipv4Match {
+    pub src: Option<(Ipv4Addr, u8)>,
+    pub dst: Option<(Ipv4Addr, u8)>,
+    pub proto: Option<u8>,
+}
+
+/// Matches an IPv6 header. Addresses are matched along with a prefix length.
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct Ipv6Match {
+    pub src: Option<(Ipv6Addr, u8)>,
+    pub dst: Option<(Ipv6Addr, u8)>,
+    pub next_header: Option<u8>,
+}
+
+/// Matches the ports of a UDP or a TCP header, in host byte order.
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct L4Match {
+    pub src_port: Option<u16>,
+    pub dst_port: Option<u16>,
+}
+
+/// Matches a VXLAN header.
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct VxlanMatch {
+    /// The 24-bit VXLAN network identifier.
+    pub vni: Option<u32>,
+}
+
+/// The spec and mask of a single item of a pattern.
+///
+/// When no field is matched, both the spec and the mask are passed as null pointers,
+/// so that the item matches any header of its protocol.
+struct Item<T> {
+    spec: T,
+    mask: T,
+    match_any: bool,
+}
+
+impl<T: Default> Default for Item<T> {
+    fn default() -> Self {
+        Self { spec: T::default(), mask: T::default(), match_any: true }
+    }
+}
+
+impl<T> Item<T> {
+    /// Sets a field of the spec, and sets all bits of the same field of the mask.
+    #[inline]
+    fn set<V>(&mut self, field: impl Fn(&mut T) -> &mut V, value: V, mask: V) {
+        *field(&mut self.spec) = value;
+        *field(&mut self.mask) = mask;
+        self.match_any = false;
+    }
+
+    #[inline]
+    fn to_raw(&self, type_: ffi::rte_flow_item_type::Type) -> ffi::rte_flow_item {
+        let (spec, mask) = if self.match_any {
+            (ptr::null(), ptr::null())
+        } else {
+            (&self.spec as *const T as *const c_void, &self.mask as *const T as *const c_void)
+        };
+        ffi::rte_flow_item { type_, spec, last: ptr::null(), mask }
+    }
+}
+
+enum PatternItem {
+    Eth(Item<ffi::rte_flow_item_eth>),
+    Ipv4(Item<ffi::rte_flow_item_ipv4>),
+    Ipv6(Item<ffi::rte_flow_item_ipv6>),
+    Udp(Item<ffi::rte_flow_item_udp>),
+    Tcp(Item<ffi::rte_flow_item_tcp>),
+    Vxlan(Item<ffi::rte_flow_item_vxlan>),
+}
+
+impl PatternItem {
+    #[inline]
+    fn to_raw(&self) -> ffi::rte_flow_item {
+        use ffi::rte_flow_item_type::*;
+
+        match self {
+            PatternItem::Eth(item) => item.to_raw(RTE_FLOW_ITEM_TYPE_ETH),
+            PatternItem::Ipv4(item) => item.to_raw(RTE_FLOW_ITEM_TYPE_IPV4),
+            PatternItem::Ipv6(item) => item.to_raw(RTE_FLOW_ITEM_TYPE_IPV6),
+            PatternItem::Udp(item) => item.to_raw(RTE_FLOW_ITEM_TYPE_UDP),
+            PatternItem::Tcp(item) => item.to_raw(RTE_FLOW_ITEM_TYPE_TCP),
+            PatternItem::Vxlan(item) => item.to_raw(RTE_FLOW_ITEM_TYPE_VXLAN),
+        }
+    }
+}
+
+enum Action {
+    Drop,
+    Queue(ffi::rte_flow_action_queue),
+    Mark(ffi::rte_flow_action_mark),
+    Count(ffi::rte_flow_action_count),
+    // `conf` points into `_queues`, which is heap-allocated, so moving the action doesn't invalidate it
+    Rss { conf: ffi::rte_flow_action_rss, _queues: Box<[u16]> },
+}
+
+impl Action {
+    #[inline]
+    fn to_raw(&self) -> ffi::rte_flow_action {
+        use ffi::rte_flow_action_type::*;
+
+        fn conf<T>(conf: &T) -> *const c_void {
+            conf as *const T as *const c_void
+        }
+
+        let (type_, conf) = match self {
+            Action::Drop => (RTE_FLOW_ACTION_TYPE_DROP, ptr::null()),
+            Action::Queue(queue) => (RTE_FLOW_ACTION_TYPE_QUEUE, conf(queue)),
+            Action::Mark(mark) => (RTE_FLOW_ACTION_TYPE_MARK, conf(mark)),
+            Action::Count(count) => (RTE_FLOW_ACTION_TYPE_COUNT, conf(count)),
+            Action::Rss { conf: rss, .. } => (RTE_FLOW_ACTION_TYPE_RSS, conf(rss)),
+        };
+        ffi::rte_flow_action { type_, conf }
+    }
+}
+
+#[inline]
+fn ipv4_prefix_mask(prefix: u8) -> [u8; 4] {
+    u32::MAX.checked_shl(32 - u32::from(prefix.min(32))).unwrap_or(0).to_be_bytes()
+}
+
+#[inline]
+fn ipv6_prefix_mask(prefix: u8) -> [u8; 16] {
+    u128::MAX.checked_shl(128 - u32::from(prefix.min(128))).unwrap_or(0).to_be_bytes()
+}
+
+/// A builder for a flow rule, consisting of attributes, a pattern and a list of actions.
+///
+/// Pattern items are matched in the order in which they were added (starting from the outermost header),
+/// and actions are applied in the order in which they were added.
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__flow_8h.html>
+pub struct FlowRule {
+    attr: ffi::rte_flow_attr,
+    pattern: Vec<PatternItem>,
+    actions: Vec<Action>,
+}
+
+impl FlowRule {
+    /// Creates a rule that applies to incoming packets.
+    #[inline]
+    pub fn ingress() -> Self {
+        let mut attr = ffi::rte_flow_attr::default();
+        attr.set_ingress(1);
+        Self { attr, pattern: Vec::new(), actions: Vec::new() }
+    }
+
+    /// Creates a rule that applies to outgoing packets.
+    #[inline]
+    pub fn egress() -> Self {
+        let mut attr = ffi::rte_flow_attr::default();
+        attr.set_egress(1);
+        Self { attr, pattern: Vec::new(), actions: Vec::new() }
+    }
+
+    /// Sets the group of the rule (group 0 is the default group, in which all packets are matched first).
+    #[inline]
+    pub fn group(mut self, group: u32) -> Self {
+        self.attr.group = group;
+        self
+    }
+
+    /// Sets the priority of the rule within its group (lower values denote higher priority).
+    #[inline]
+    pub fn priority(mut self, priority: u32) -> Self {
+        self.attr.priority = priority;
+        self
+    }
+
+    #[inline]
+    pub fn eth(mut self, eth: EthMatch) -> Self {
+        let mut item = Item::<ffi::rte_flow_item_eth>::default();
+        if let Some(src) = eth.src {
+            item.set(|eth| &mut eth.src.addr_bytes, *src, [0xff; 6]);
+        }
+        if let Some(dst) = eth.dst {
+            item.set(|eth| &mut eth.dst.addr_bytes, *dst, [0xff; 6]);
+        }
+        if let Some(ether_type) = eth.ether_type {
+            item.set(|eth| &mut eth.type_, ether_type.to_be(), u16::MAX);
+        }
+        self.pattern.push(PatternItem::Eth(item));
+        self
+    }
+
+    #[inline]
+    pub fn ipv4(mut self, ipv4: Ipv4Match) -> Self {
+        let mut item = Item::<ffi::rte_flow_item_ipv4>::default();
+        if let Some((addr, prefix)) = ipv4.src {
+            let mask = u32::from_ne_bytes(ipv4_prefix_mask(prefix));
+            item.set(|ipv4| &mut ipv4.hdr.src_addr, u32::from_ne_bytes(addr.octets()) & mask, mask);
+        }
+        if let Some((addr, prefix)) = ipv4.dst {
+            let mask = u32::from_ne_bytes(ipv4_prefix_mask(prefix));
+            item.set(|ipv4| &mut ipv4.hdr.dst_addr, u32::from_ne_bytes(addr.octets()) & mask, mask);
+        }
+        if let Some(proto) = ipv4.proto {
+            item.set(|ipv4| &mut ipv4.hdr.next_proto_id, proto, u8::MAX);
+        }
+        self.pattern.push(PatternItem::Ipv4(item));
+        self
+    }
+
+    #[inline]
+    pub fn ipv6(mut self, ipv6: Ipv6Match) -> Self {
+        fn masked(addr: Ipv6Addr, mask: [u8; 16]) -> [u8; 16] {
+            let mut addr = addr.octets();
+            addr.iter_mut().zip(mask).for_each(|(byte, mask)| *byte &= mask);
+            addr
+        }
+
+        let mut item = Item::<ffi::rte_flow_item_ipv6>::default();
+        if let Some((addr, prefix)) = ipv6.src {
+            let mask = ipv6_prefix_mask(prefix);
+            item.set(|ipv6| &mut ipv6.hdr.src_addr, masked(addr, mask), mask);
+        }
+        if let Some((addr, prefix)) = ipv6.dst {
+            let mask = ipv6_prefix_mask(prefix);
+            item.set(|ipv6| &mut ipv6.hdr.dst_addr, masked(addr, mask), mask);
+        }
+        if let Some(next_header) = ipv6.next_header {
+            item.set(|ipv6| &mut ipv6.hdr.proto, next_header, u8::MAX);
+        }
+        self.pattern.push(PatternItem::Ipv6(item));
+        self
+    }
+
+    #[inline]
+    pub fn udp(mut self, udp: L4Match) -> Self {
+        let mut item = Item::<ffi::rte_flow_item_udp>::default();
+        if let Some(port) = udp.src_port {
+            item.set(|udp| &mut udp.hdr.src_port, port.to_be(), u16::MAX);
+        }
+        if let Some(port) = udp.dst_port {
+            item.set(|udp| &mut udp.hdr.dst_port, port.to_be(), u16::MAX);
+        }
+        self.pattern.push(PatternItem::Udp(item));
+        self
+    }
+
+    #[inline]
+    pub fn tcp(mut self, tcp: L4Match) -> Self {
+        let mut item = Item::<ffi::rte_flow_item_tcp>::default();
+        if let Some(port) = tcp.src_port {
+            item.set(|tcp| &mut tcp.hdr.src_port, port.to_be(), u16::MAX);
+        }
+        if let Some(port) = tcp.dst_port {
+            item.set(|tcp| &mut tcp.hdr.dst_port, port.to_be(), u16::MAX);
+        }
+        self.pattern.push(PatternItem::Tcp(item));
+        self
+    }
+
+    #[inline]
+    pub fn vxlan(mut self, vxlan: VxlanMatch) -> Self {
+        let mut item = Item::<ffi::rte_flow_item_vxlan>::default();
+        if let Some(vni) = vxlan.vni {
+            let [_, vni @ ..] = vni.to_be_bytes();
+            item.set(|vxlan| &mut vxlan.vni, vni, [0xff; 3]);
+        }
+        self.pattern.push(PatternItem::Vxlan(item));
+        self
+    }
+
+    /// Drops matching packets.
+    #[inline]
+    pub fn drop_packets(mut self) -> Self {
+        self.actions.push(Action::Drop);
+        self
+    }
+
+    /// Steers matching packets to the given RX queue.
+    #[inline]
+    pub fn queue(mut self, index: u16) -> Self {
+        self.actions.push(Action::Queue(ffi::rte_flow_action_queue { index }));
+        self
+    }
+
+    /// Spreads matching packets over the given RX queues, by hashing the given header fields
+    /// using the device's default hash function and key.
+    #[inline]
+    pub fn rss(mut self, types: EthRss, queues: &[u16]) -> Self {
+        let queues: Box<[u16]> = queues.into();
+        let conf = ffi::rte_flow_action_rss {
+            func: ffi::rte_eth_hash_function::RTE_ETH_HASH_FUNCTION_DEFAULT,
+            level: 0,
+            types: types.bits(),
+            key_len: 0,
+            queue_num: queues.len() as u32,
+            key: ptr::null(),
+            queue: queues.as_ptr(),
+        };
+        self.actions.push(Action::Rss { conf, _queues: queues });
+        self
+    }
+
+    /// Marks matching packets with the given value, which can be read using
+    /// [`MetadataExt::flow_mark`](crate::mbuf::MetadataExt::flow_mark).
+    #[inline]
+    pub fn mark(mut self, id: u32) -> Self {
+        self.actions.push(Action::Mark(ffi::rte_flow_action_mark { id }));
+        self
+    }
+
+    /// Counts matching packets (and bytes), see [`Flow::query_count`].
+    #[inline]
+    pub fn count(mut self) -> Self {
+        self.actions.push(Action::Count(ffi::rte_flow_action_count::default()));
+        self
+    }
+
+    /// Calls `f` with the raw END-terminated pattern and actions arrays, which point into `self`.
+    #[inline]
+    fn with_raw<T>(&self, f: impl FnOnce(*const ffi::rte_flow_item, *const ffi::rte_flow_action) -> T) -> T {
+        let pattern = self
+            .pattern
+            .iter()
+            .map(PatternItem::to_raw)
+            .chain([ffi::rte_flow_item {
+                type_: ffi::rte_flow_item_type::RTE_FLOW_ITEM_TYPE_END,
+                ..Default::default()
+            }])
+            .collect::<Vec<_>>();
+        let actions = self
+            .actions
+            .iter()
+            .map(Action::to_raw)
+            .chain([ffi::rte_flow_action {
+                type_: ffi::rte_flow_action_type::RTE_FLOW_ACTION_TYPE_END,
+                ..Default::default()
+            }])
+            .collect::<Vec<_>>();
+
+        f(pattern.as_ptr(), actions.as_ptr())
+    }
+
+    /// Checks whether the rule is supported by the device (and could be created), without creating it.
+    #[inline]
+    pub fn validate(&self, dev: &EthDev) -> Result<()> {
+        let mut error = ffi::rte_flow_error::default();
+        self.with_raw(|pattern, actions| unsafe {
+            ffi::rte_flow_validate(dev.port_id, &self.attr, pattern, actions, &mut error)
+        })
+        .rte_ok()?;
+        Ok(())
+    }
+
+    /// Creates the rule on the given device.
+    #[inline]
+    pub fn create(&self, dev: &EthDev) -> Result<Flow> {
+        let mut error = ffi::rte_flow_error::default();
+        let ptr = self
+            .with_raw(|pattern, actions| unsafe {
+                ffi::rte_flow_create(dev.port_id, &self.attr, pattern, actions, &mut error)
+            })
+            .rte_ok()?;
+        Ok(Flow { port_id: dev.port_id, ptr })
+    }
+}
+
+/// The values of a flow's counter, see [`Flow::query_count`].
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct FlowCount {
+    /// The number of hits, if supported by the device.
+    pub hits: Option<u64>,
+    /// The number of bytes, if supported by the device.
+    pub bytes: Option<u64>,
+}
+
+/// A flow rule that was created on a device, which is destroyed when dropped.
+#[derive(Debug)]
+pub struct Flow {
+    port_id: u16,
+    ptr: NonNull<ffi::rte_flow>,
+}
+
+impl Flow {
+    #[inline]
+    pub fn port_id(&self) -> u16 {
+        self.port_id
+    }
+
+    /// Queries the counter of this flow, which must have been created with a [`FlowRule::count`] action.
+    ///
+    /// If `reset` is `true`, the counter is reset after it has been read.
+    #[inline]
+    pub fn query_count(&self, reset: bool) -> Result<FlowCount> {
+        let action =
+            ffi::rte_flow_action { type_: ffi::rte_flow_action_type::RTE_FLOW_ACTION_TYPE_COUNT, conf: ptr::null() };
+        let mut count = ffi::rte_flow_query_count::default();
+        count.set_reset(reset.into());
+        let mut error = ffi::rte_flow_error::default();
+
+        unsafe {
+            ffi::rte_flow_query(
+                self.port_id,
+                self.ptr.as_ptr(),
+                &action,
+                &mut count as *mut _ as *mut c_void,
+                &mut error,
+            )
+        }
+        .rte_ok()?;
+
+        Ok(FlowCount {
+            hits: (count.hits_set() != 0).then(|| count.hits),
+            bytes: (count.bytes_set() != 0).then(|| count.bytes),
+        })
+    }
+}
+
+impl Drop for Flow {
+    #[inline]
+    fn drop(&mut self) {
+        let mut error = ffi::rte_flow_error::default();
+        unsafe { ffi::rte_flow_destroy(self.port_id, self.ptr.as_ptr(), &mut error) };
+    }
+}
+
+impl EthDev {
+    /// Destroys all flow rules of this device.
+    ///
+    /// # Safety
+    /// Must not be called as long as any [`Flow`] of this device is alive, since dropping it would destroy it again.
+    #[inline]
+    pub unsafe fn flow_flush(&self) -> Result<()> {
+        let mut error = ffi::rte_flow_error::default();
+        ffi::rte_flow_flush(self.port_id, &mut error).rte_ok()?;
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn prefix_masks() {
+        assert_eq!(ipv4_prefix_mask(0), [0; 4]);
+        assert_eq!(ipv4_prefix_mask(12), [0xff, 0xf0, 0, 0]);
+        assert_eq!(ipv4_prefix_mask(32), [0xff; 4]);
+        assert_eq!(ipv6_prefix_mask(0), [0; 16]);
+        assert_eq!(ipv6_prefix_mask(64), [0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0, 0, 0, 0, 0]);
+        assert_eq!(ipv6_prefix_mask(200), [0xff; 16]);
+    }
+}
@@ -0,0 +1,283 @@
+use std::{fmt, hint, mem::MaybeUninit, ptr, time::Duration};
+
+use arrayvec::ArrayVec;
+use rte_error::ReturnValue as _;
+
+use super::EthDev;
+use crate::{cycles, mbuf::MBuf, mempool::MemoryPool, Result};
+
+/// What a poll loop does while a receive queue is quiet, see [`IdlePolicy`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum IdleMode {
+    /// Always keep polling, for the lowest possible latency (and 100% CPU usage).
+    BusyPoll,
+    /// Pause the core for a while between polls, using `rte_power_pause` (`TPAUSE`) where supported,
+    /// or a spin loop of pause instructions otherwise.
+    Pause,
+    /// Wait for the NIC to write the queue's next RX descriptor, using `rte_power_monitor` (`UMONITOR`/`UMWAIT`),
+    /// falling back to [`Self::Pause`] if either the CPU or the driver doesn't support it.
+    Monitor,
+    /// Arm the queue's RX interrupt (`rte_eth_dev_rx_intr_enable`), and sleep until it fires, using `rte_epoll_wait`.
+    ///
+    /// Requires RX interrupts to be enabled in the device's configuration (`intr_conf.rxq`).
+    ///
+    /// Since epoll's timeout has a granularity of milliseconds, the wake-up latency is rounded up to whole
+    /// milliseconds, i.e. a quiet queue is polled again at most every millisecond, however low
+    /// [`IdlePolicy::max_wakeup_latency`] is.
+    Interrupt,
+}
+
+/// A policy for handling quiet receive queues: once `empty_polls` consecutive polls have returned no packets,
+/// the poll loop goes idle according to `mode` for up to `max_wakeup_latency` (after which it polls again),
+/// and it returns to busy polling as soon as packets are received.
+///
+/// `max_wakeup_latency` is rounded up to at least 1 ms in [`IdleMode::Interrupt`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct IdlePolicy {
+    pub mode: IdleMode,
+    pub empty_polls: u32,
+    pub max_wakeup_latency: Duration,
+}
+
+impl Default for IdlePolicy {
+    fn default() -> Self {
+        Self { mode: IdleMode::BusyPoll, empty_polls: 512, max_wakeup_latency: Duration::from_micros(100) }
+    }
+}
+
+/// Polls a receive queue of an Ethernet device, going idle when the queue is quiet according to an [`IdlePolicy`].
+///
+/// A poller must be created (and used) on the lcore that polls the queue, since RX interrupts are registered
+/// with the calling thread's epoll instance.
+///
+/// Dropping the poller unregisters the queue's RX interrupt, if it was registered by [`Self::new`].
+///
+/// See also: <https://doc.dpdk.org/guides-21.08/prog_guide/power_man.html>
+pub struct AdaptivePoller {
+    dev: EthDev,
+    queue_id: u16,
+    mode: IdleMode,
+    empty_polls_threshold: u32,
+    max_idle_cycles: u64,
+    empty_polls: u32,
+    can_tpause: bool,
+}
+
+impl AdaptivePoller {
+    /// Creates a poller for the given receive queue.
+    ///
+    /// If `policy.mode` is [`IdleMode::Interrupt`], registers the queue's RX interrupt with the current thread's epoll
+    /// instance, which fails if RX interrupts aren't enabled for the device.
+    #[inline]
+    pub fn new(dev: EthDev, queue_id: u16, policy: IdlePolicy) -> Result<Self> {
+        let mut intrinsics = ffi::rte_cpu_intrinsics::default();
+        unsafe { ffi::rte_cpu_get_intrinsics_support(&mut intrinsics) };
+
+        let mode = supported_mode(policy.mode, intrinsics.power_monitor() != 0);
+        if mode == IdleMode::Interrupt {
+            unsafe {
+                ffi::rte_eth_dev_rx_intr_ctl_q(
+                    dev.port_id,
+                    queue_id,
+                    ffi::RTE_EPOLL_PER_THREAD,
+                    ffi::RTE_INTR_EVENT_ADD as i32,
+                    ptr::null_mut(),
+                )
+            }
+            .rte_ok()?;
+        }
+
+        Ok(Self {
+            dev,
+            queue_id,
+            mode,
+            empty_polls_threshold: policy.empty_polls,
+            max_idle_cycles: cycles::duration_to_cycles(policy.max_wakeup_latency),
+            empty_polls: 0,
+            can_tpause: intrinsics.power_pause() != 0,
+        })
+    }
+
+    /// Returns the idle mode that is actually used, which may differ from the policy's mode if it isn't supported.
+    #[inline]
+    pub fn mode(&self) -> IdleMode {
+        self.mode
+    }
+
+    /// Receives a burst of packets (see [`EthDev::rx_burst`]), and then calls [`Self::on_poll`].
+    ///
+    /// # Safety
+    /// See [`EthDev::rx_burst`].
+    #[inline]
+    pub unsafe fn rx_burst<'mempool, const CAP: usize>(
+        &mut self,
+        mempool: &'mempool MemoryPool,
+        rx_pkts: &mut ArrayVec<MBuf<&'mempool MemoryPool>, CAP>,
+    ) {
+        let old_len = rx_pkts.len();
+        self.dev.rx_burst(self.queue_id, mempool, rx_pkts);
+        self.on_poll(rx_pkts.len() - old_len);
+    }
+
+    /// Records the result of a poll of the queue, going idle (i.e. blocking) if the queue has been quiet
+    /// for long enough.
+    #[inline]
+    pub fn on_poll(&mut self, received: usize) {
+        if self.should_idle(received) {
+            self.idle();
+        }
+    }
+
+    /// Counts consecutive empty polls, returning `true` once the poller should go idle.
+    #[inline]
+    fn should_idle(&mut self, received: usize) -> bool {
+        if received > 0 {
+            self.empty_polls = 0;
+            return false;
+        }
+
+        self.empty_polls = self.empty_polls.saturating_add(1);
+        self.mode != IdleMode::BusyPoll && self.empty_polls >= self.empty_polls_threshold
+    }
+
+    #[cold]
+    fn idle(&mut self) {
+        let deadline = cycles::rdtsc() + self.max_idle_cycles;
+
+        match self.mode {
+            IdleMode::BusyPoll => {}
+            IdleMode::Pause => self.pause(deadline),
+            IdleMode::Monitor => {
+                let mut pmc = MaybeUninit::<ffi::rte_power_monitor_cond>::zeroed();
+                let monitored = unsafe {
+                    ffi::rte_eth_get_monitor_addr(self.dev.port_id, self.queue_id, pmc.as_mut_ptr()) == 0
+                        && ffi::rte_power_monitor(pmc.as_ptr(), deadline) == 0
+                };
+                if !monitored {
+                    // the driver doesn't support monitoring its descriptors
+                    self.mode = IdleMode::Pause;
+                    self.pause(deadline);
+                }
+            }
+            IdleMode::Interrupt => unsafe {
+                let (port_id, queue_id) = (self.dev.port_id, self.queue_id);
+                if ffi::rte_eth_dev_rx_intr_enable(port_id, queue_id) != 0 {
+                    self.pause(deadline);
+                    return;
+                }
+
+                let timeout_ms = epoll_timeout_ms(cycles::cycles_to_duration(self.max_idle_cycles));
+                let mut event = ffi::rte_epoll_event::default();
+                ffi::rte_epoll_wait(ffi::RTE_EPOLL_PER_THREAD, &mut event, 1, timeout_ms);
+
+                ffi::rte_eth_dev_rx_intr_disable(port_id, queue_id);
+            },
+        }
+    }
+
+    #[inline]
+    fn pause(&self, deadline: u64) {
+        if self.can_tpause && unsafe { ffi::rte_power_pause(deadline) } == 0 {
+            return;
+        }
+
+        while cycles::rdtsc() < deadline {
+            hint::spin_loop();
+        }
+    }
+}
+
+impl Drop for AdaptivePoller {
+    fn drop(&mut self) {
+        if self.mode == IdleMode::Interrupt {
+            unsafe {
+                ffi::rte_eth_dev_rx_intr_disable(self.dev.port_id, self.queue_id);
+                ffi::rte_eth_dev_rx_intr_ctl_q(
+                    self.dev.port_id,
+                    self.queue_id,
+                    ffi::RTE_EPOLL_PER_THREAD,
+                    ffi::RTE_INTR_EVENT_DEL as i32,
+                    ptr::null_mut(),
+                );
+            }
+        }
+    }
+}
+
+impl fmt::Debug for AdaptivePoller {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("AdaptivePoller")
+            .field("port_id", &self.dev.port_id)
+            .field("queue_id", &self.queue_id)
+            .field("mode", &self.mode)
+            .field("empty_polls", &self.empty_polls)
+            .finish()
+    }
+}
+
+/// Returns the idle mode to use instead of `mode`, falling back to [`IdleMode::Pause`] if `mode` is
+/// [`IdleMode::Monitor`] and the CPU can't monitor addresses.
+#[inline]
+fn supported_mode(mode: IdleMode, can_monitor: bool) -> IdleMode {
+    match mode {
+        IdleMode::Monitor if !can_monitor => IdleMode::Pause,
+        mode => mode,
+    }
+}
+
+/// Returns the timeout of `rte_epoll_wait` for a wake-up latency of `latency`, which is rounded up to whole
+/// milliseconds (and at least 1 ms), since epoll's timeout has a granularity of milliseconds.
+#[inline]
+fn epoll_timeout_ms(latency: Duration) -> i32 {
+    let ms = (latency.as_micros() + 999) / 1000;
+    ms.clamp(1, i32::MAX as u128) as i32
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn new_poller(mode: IdleMode, empty_polls: u32) -> AdaptivePoller {
+        AdaptivePoller {
+            dev: EthDev::new(0),
+            queue_id: 0,
+            mode,
+            empty_polls_threshold: empty_polls,
+            max_idle_cycles: 0,
+            empty_polls: 0,
+            can_tpause: false,
+        }
+    }
+
+    #[test]
+    fn mode_selection() {
+        assert_eq!(supported_mode(IdleMode::Monitor, true), IdleMode::Monitor);
+        assert_eq!(supported_mode(IdleMode::Monitor, false), IdleMode::Pause);
+        for mode in [IdleMode::BusyPoll, IdleMode::Pause, IdleMode::Interrupt] {
+            assert_eq!(supported_mode(mode, false), mode);
+        }
+
+        assert_eq!(epoll_timeout_ms(Duration::ZERO), 1);
+        assert_eq!(epoll_timeout_ms(Duration::from_micros(100)), 1);
+        assert_eq!(epoll_timeout_ms(Duration::from_micros(1001)), 2);
+        assert_eq!(epoll_timeout_ms(Duration::from_secs(1)), 1000);
+    }
+
+    #[test]
+    fn back_off() {
+        let mut poller = new_poller(IdleMode::Pause, 3);
+        assert!(!poller.should_idle(0));
+        assert!(!poller.should_idle(0));
+        assert!(poller.should_idle(0));
+        // keeps going idle while the queue is quiet
+        assert!(poller.should_idle(0));
+
+        // and returns to busy polling as soon as packets are received
+        assert!(!poller.should_idle(4));
+        assert!(!poller.should_idle(0));
+        assert_eq!(poller.empty_polls, 1);
+
+        let mut poller = new_poller(IdleMode::BusyPoll, 0);
+        assert!((0..1000).all(|_| !poller.should_idle(0)));
+    }
+}
@@ -1,27 +1,60 @@
+#[cfg(feature = "fast-path")]
+mod fast_path;
+pub mod flow;
+mod idle;
+mod rss;
+mod tx_buffer;
 mod xstats;
 
 use std::{
-    ffi::CStr,
+    ffi::{CStr, CString},
     iter::from_fn,
     mem::{self, MaybeUninit},
+    os::raw::c_char,
     ptr, slice,
 };
 
 use arrayvec::ArrayVec;
 use mac_addr::MacAddr;
-use rte_error::{Error, ReturnValue as _};
+use rte_error::{rte_error, Error, ReturnValue as _};
 
-pub use self::xstats::XStatsDefs;
-use crate::{mbuf::MBuf, memory::SocketId, mempool::MemoryPool, Result};
+#[cfg(feature = "fast-path")]
+use self::fast_path::{rx_burst as eth_rx_burst, tx_burst as eth_tx_burst, tx_prepare as eth_tx_prepare};
+#[cfg(not(feature = "fast-path"))]
+use ffi::{
+    _rte_eth_rx_burst as eth_rx_burst, _rte_eth_tx_burst as eth_tx_burst, _rte_eth_tx_prepare as eth_tx_prepare,
+};
+
+pub use self::{
+    idle::{AdaptivePoller, IdleMode, IdlePolicy},
+    tx_buffer::TxBuffer,
+    xstats::{XStatsDefs, XStatsSelection, XStatsSnapshot},
+};
+use crate::{
+    flags::PacketType,
+    mbuf::{Allocator, MBuf, OwnedMBuf, PrivateData},
+    memory::SocketId,
+    mempool::{MemoryPool, TypedMemoryPool},
+    Result,
+};
 
 pub const MAX_QUEUE: u16 = u16::MAX;
 
+/// The error returned by [`EthDev::tx_prepare`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct TxPrepareError {
+    /// The index of the first packet that is invalid (or isn't supported by the device).
+    /// All packets before it have been prepared successfully.
+    pub index: usize,
+    pub error: Error,
+}
+
 pub type DeviceInfo = ffi::rte_eth_dev_info;
 pub type DeviceStats = ffi::rte_eth_stats;
 pub type Conf = ffi::rte_eth_conf;
 
 /// An ethernet device (port) and associated functionality from [here](https://doc.dpdk.org/api-21.08/rte__ethdev_8h.html)
-#[derive(PartialEq, Eq, Clone)]
+#[derive(Debug, PartialEq, Eq, Clone)]
 pub struct EthDev {
     port_id: u16,
 }
@@ -32,11 +65,32 @@ impl EthDev {
         EthDev { port_id }
     }
 
+    /// Looks up a device by name (e.g. its PCI address, or the name of a virtual device), e.g. to attach to a device
+    /// that was probed (and configured) by the primary process from a secondary process, whose queues can then be
+    /// polled by the secondary once the primary stops polling them.
+    ///
+    /// Fails with `ENODEV` if there is no such device.
+    #[inline]
+    pub fn from_name<S: Into<Vec<u8>>>(name: S) -> Result<Self> {
+        let name = CString::new(name).unwrap();
+        let mut port_id = 0;
+        unsafe { ffi::rte_eth_dev_get_port_by_name(name.as_ptr(), &mut port_id) }.rte_ok()?;
+        Ok(Self::new(port_id))
+    }
+
     #[inline]
     pub fn port_id(&self) -> u16 {
         self.port_id
     }
 
+    /// Returns the device's name, see [`Self::from_name`].
+    #[inline]
+    pub fn name(&self) -> Result<String> {
+        let mut name = [0 as c_char; ffi::RTE_ETH_NAME_MAX_LEN as usize];
+        unsafe { ffi::rte_eth_dev_get_name_by_port(self.port_id, name.as_mut_ptr()) }.rte_ok()?;
+        Ok(unsafe { CStr::from_ptr(name.as_ptr()) }.to_string_lossy().into_owned())
+    }
+
     /// Configure an Ethernet device.
     /// This function must be invoked first before any other function in the Ethernet API. This function can also be re-invoked when a device is in the stopped state.
     #[inline]
@@ -72,8 +126,27 @@ impl EthDev {
         Ok(stats)
     }
 
+    /// Returns the packet types (masked by `ptype_mask`) that the device's driver can recognize and set in the
+    /// [`packet_type`](crate::mbuf::MetadataExt::packet_type) of received mbufs.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__ethdev_8h.html>
+    #[inline]
+    pub fn supported_ptypes(&self, ptype_mask: PacketType) -> Result<Vec<PacketType>> {
+        let mask = ptype_mask.bits();
+        let num = unsafe { ffi::rte_eth_dev_get_supported_ptypes(self.port_id, mask, ptr::null_mut(), 0) }.rte_ok()?;
+
+        let mut ptypes = vec![0; num as usize];
+        let num =
+            unsafe { ffi::rte_eth_dev_get_supported_ptypes(self.port_id, mask, ptypes.as_mut_ptr(), num) }.rte_ok()?;
+        ptypes.truncate(num as usize);
+
+        Ok(ptypes.into_iter().map(PacketType::from_bits_truncate).collect())
+    }
+
+    /// Returns the NUMA socket the device is attached to, which fails if the port ID is invalid,
+    /// or if the socket is unknown (e.g. for virtual devices).
     #[inline]
-    fn socket_id(&self) -> Result<SocketId> {
+    pub fn socket_id(&self) -> Result<SocketId> {
         // -1 is returned if the port_id (self) is out of range
         let ret = unsafe { ffi::rte_eth_dev_socket_id(self.port_id) };
         // cast from i32 to u32 (e.g., -1 == u32::MAX)
@@ -81,6 +154,17 @@ impl EthDev {
         SocketId::new(id).ok_or(Error(ret))
     }
 
+    /// Reads the device's clock, which is the clock of the RX timestamps it sets on packets
+    /// (see [`MetadataExt::rx_timestamp`](crate::mbuf::MetadataExt::rx_timestamp)).
+    ///
+    /// Fails with `ENOTSUP` if the driver doesn't support reading it.
+    #[inline]
+    pub fn read_clock(&self) -> Result<u64> {
+        let mut clock = 0;
+        unsafe { ffi::rte_eth_read_clock(self.port_id, &mut clock) }.rte_ok()?;
+        Ok(clock)
+    }
+
     #[inline]
     pub fn start(&self) -> Result<()> {
         unsafe { ffi::rte_eth_dev_start(self.port_id) }.rte_ok()?;
@@ -101,10 +185,16 @@ impl EthDev {
 
     /// Retrieve a burst of input packets from a receive queue of an Ethernet device.
     ///
+    /// With the `fast-path` feature enabled, the PMD's receive function is called directly from Rust
+    /// instead of through the `rte_eth_rx_burst` C shim.
+    ///
     /// The received packets will be appended to `rx_pkts`. This method uses the array's current capacity
     /// (i.e. `CAP - rx_pkts.len()`) as a buffer for the DPDK library to write the received packets into,
     /// so in order to utilize the array's entire capacity, it should be empty when calling this function.
     ///
+    /// An [`MBufBatch`](crate::mbuf::MBufBatch) can be passed as `rx_pkts` as well, in which case the received packets
+    /// are freed in bulk when the batch is dropped.
+    ///
     /// # Safety
     /// It is up to the caller to guarantee that `mempool` matches the memory pool
     /// used in the call to [`Self::rx_queue_setup`] for this queue.
@@ -115,57 +205,136 @@ impl EthDev {
         _mempool: &'mempool MemoryPool,
         rx_pkts: &mut ArrayVec<MBuf<&'mempool MemoryPool>, CAP>,
     ) {
+        self.rx_burst_into(queue_id, rx_pkts)
+    }
+
+    /// Retrieve a burst of input packets from a receive queue of an Ethernet device, whose mbufs have per-packet
+    /// metadata, see [`Self::rx_burst`] and [`TypedMemoryPool`].
+    ///
+    /// # Safety
+    /// It is up to the caller to guarantee that `mempool` matches the memory pool
+    /// used in the call to [`Self::rx_queue_setup`] for this queue.
+    #[inline]
+    pub unsafe fn rx_burst_typed<'mempool, P, const CAP: usize>(
+        &self,
+        queue_id: u16,
+        _mempool: &'mempool TypedMemoryPool<P>,
+        rx_pkts: &mut ArrayVec<MBuf<&'mempool TypedMemoryPool<P>>, CAP>,
+    ) where
+        P: PrivateData,
+    {
+        self.rx_burst_into(queue_id, rx_pkts)
+    }
+
+    #[inline]
+    unsafe fn rx_burst_into<A, const CAP: usize>(&self, queue_id: u16, rx_pkts: &mut ArrayVec<MBuf<A>, CAP>)
+    where
+        A: Allocator,
+    {
         let old_len = rx_pkts.len();
 
         // this code was adapted from the Vec::spare_capacity_mut method, which ArrayVec unfortunately does not have
         let spare_cap = slice::from_raw_parts_mut(
-            rx_pkts.as_mut_ptr().add(old_len) as *mut MaybeUninit<MBuf<&'mempool MemoryPool>>,
+            rx_pkts.as_mut_ptr().add(old_len) as *mut MaybeUninit<MBuf<A>>,
             rx_pkts.remaining_capacity(),
         );
 
         let received =
-            ffi::_rte_eth_rx_burst(self.port_id, queue_id, spare_cap.as_mut_ptr() as _, spare_cap.len() as u16)
-                as usize;
+            eth_rx_burst(self.port_id, queue_id, spare_cap.as_mut_ptr() as _, spare_cap.len() as u16) as usize;
         rx_pkts.set_len(old_len + received);
+
+        #[cfg(feature = "instrumentation")]
+        crate::instrumentation::record_rx_burst(received);
     }
 
     /// Send a burst of output packets on a transmit queue of an Ethernet device.
     ///
+    /// With the `fast-path` feature enabled, the PMD's transmit function is called directly from Rust
+    /// instead of through the `rte_eth_tx_burst` C shim.
+    ///
     /// Packets that have been successfully sent will be removed from `tx_pkts`, any `MBufs` remaining in the array
     /// after this method has completed are packets that were NOT sent.
     ///
+    /// Passing an [`MBufBatch`](crate::mbuf::MBufBatch) as `tx_pkts` allows freeing the unsent packets in bulk,
+    /// using [`MBufBatch::free_all`](crate::mbuf::MBufBatch::free_all).
+    ///
+    /// `tx_pkts` may hold either [`MBuf`]s or [`SharedMBuf`](crate::mbuf::SharedMBuf)s (e.g. for mirroring a packet
+    /// to multiple ports without copying it).
+    ///
     /// # Safety
     /// It is up to the caller to guarantee that `mempool` matches the memory pool
     /// used in the call to [`Self::tx_queue_setup`] for this queue.
     #[inline]
-    pub unsafe fn tx_burst<'mempool, const CAP: usize>(
+    pub unsafe fn tx_burst<'mempool, M, const CAP: usize>(
         &self,
         queue_id: u16,
         _mempool: &'mempool MemoryPool,
-        tx_pkts: &mut ArrayVec<MBuf<&'mempool MemoryPool>, CAP>,
-    ) {
+        tx_pkts: &mut ArrayVec<M, CAP>,
+    ) where
+        M: OwnedMBuf<Allocator = &'mempool MemoryPool>,
+    {
         let transmitted =
-            ffi::_rte_eth_tx_burst(self.port_id, queue_id, tx_pkts.as_mut_ptr() as _, tx_pkts.len() as u16) as usize;
+            eth_tx_burst(self.port_id, queue_id, tx_pkts.as_mut_ptr() as _, tx_pkts.len() as u16) as usize;
+
+        #[cfg(feature = "instrumentation")]
+        crate::instrumentation::record_tx_burst(tx_pkts.len(), transmitted);
 
         // rte_eth_tx_burst assumes ownership of the mbufs that were successfully transmitted,
         // so we remove them from tx_pkts and use mem::forget to prevent dropping (and freeing) them ourselves
         tx_pkts.drain(..transmitted).for_each(mem::forget);
     }
 
+    /// Prepare a burst of output packets for transmission on a transmit queue of an Ethernet device, using
+    /// `rte_eth_tx_prepare`.
+    ///
+    /// Checks that the packets meet the device's requirements for the TX offloads they request (e.g. number of
+    /// segments, or the TSO segment size), and modifies them if necessary (e.g. sets the pseudo-header checksum
+    /// required for L4 checksum offloading).
+    /// Should be called before [`Self::tx_burst`] for packets that have TX offload flags set,
+    /// see [`MetadataExt`](crate::mbuf::MetadataExt).
+    ///
+    /// Returns the index of the first packet that could not be prepared, along with the reason. It is up to the caller
+    /// to decide what to do with this packet (e.g. drop it, or compute its checksums in software), and to retry
+    /// preparing the packets after it.
+    ///
+    /// With the `fast-path` feature enabled, the PMD's prepare function is called directly from Rust
+    /// instead of through the `rte_eth_tx_prepare` C shim.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__ethdev_8h.html>
+    #[inline]
+    pub fn tx_prepare<A>(&self, queue_id: u16, tx_pkts: &mut [MBuf<A>]) -> std::result::Result<(), TxPrepareError>
+    where
+        A: Allocator,
+    {
+        let nb_pkts = tx_pkts.len().min(u16::MAX.into());
+        let prepared =
+            unsafe { eth_tx_prepare(self.port_id, queue_id, tx_pkts.as_mut_ptr() as _, nb_pkts as u16) } as usize;
+
+        if prepared < nb_pkts {
+            Err(TxPrepareError { index: prepared, error: rte_error() })
+        } else {
+            Ok(())
+        }
+    }
+
+    /// Sets up a receive queue, whose descriptors are allocated on the device's socket (or on any socket, if it's
+    /// unknown, e.g. for virtual devices).
+    ///
+    /// `mempool` should be allocated on the same socket, see [`crate::mempool::MempoolSet::for_port`].
     #[inline]
     pub fn rx_queue_setup(
         &self,
         rx_queue_id: u16,
         nb_rx_desc: u16,
         rx_conf: Option<ffi::rte_eth_rxconf>,
-        mempool: &mut MemoryPool,
+        mempool: &MemoryPool,
     ) -> Result<()> {
         unsafe {
             ffi::rte_eth_rx_queue_setup(
                 self.port_id,
                 rx_queue_id,
                 nb_rx_desc,
-                self.socket_id()?.get(),
+                self.queue_socket_id(),
                 rx_conf.as_ref().map(|conf| conf as *const _).unwrap_or(ptr::null()),
                 mempool.0.as_ptr(),
             )
@@ -174,6 +343,12 @@ impl EthDev {
         Ok(())
     }
 
+    /// Returns the socket of the device, or `SOCKET_ID_ANY` if it's unknown.
+    #[inline]
+    fn queue_socket_id(&self) -> u32 {
+        self.socket_id().map(|id| id.get()).unwrap_or(u32::MAX)
+    }
+
     #[inline]
     pub fn tx_queue_setup(
         &self,
@@ -186,7 +361,7 @@ impl EthDev {
                 self.port_id,
                 tx_queue_id,
                 nb_tx_desc,
-                self.socket_id()?.get(),
+                self.queue_socket_id(),
                 tx_conf.as_ref().map(|conf| conf as *const _).unwrap_or(ptr::null()),
             )
         }
@@ -194,6 +369,55 @@ impl EthDev {
         Ok(())
     }
 
+    /// Returns the device's default receive queue configuration, with `rx_deferred_start` set, so that a queue set up
+    /// with it isn't started along with the device, but only by [`Self::rx_queue_start`].
+    #[inline]
+    pub fn deferred_rx_conf(&self) -> Result<ffi::rte_eth_rxconf> {
+        Ok(ffi::rte_eth_rxconf { rx_deferred_start: 1, ..self.info()?.default_rxconf })
+    }
+
+    /// Returns the device's default transmit queue configuration, with `tx_deferred_start` set,
+    /// see [`Self::deferred_rx_conf`].
+    #[inline]
+    pub fn deferred_tx_conf(&self) -> Result<ffi::rte_eth_txconf> {
+        Ok(ffi::rte_eth_txconf { tx_deferred_start: 1, ..self.info()?.default_txconf })
+    }
+
+    /// Starts a receive queue (that was set up with deferred start, or stopped), while the device is running.
+    ///
+    /// Fails with `ENOTSUP` if the driver doesn't support starting queues individually.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__ethdev_8h.html>
+    #[inline]
+    pub fn rx_queue_start(&self, rx_queue_id: u16) -> Result<()> {
+        unsafe { ffi::rte_eth_dev_rx_queue_start(self.port_id, rx_queue_id) }.rte_ok()?;
+        Ok(())
+    }
+
+    /// Stops a receive queue, while the device (and its other queues) keeps running.
+    ///
+    /// The queue must not be polled while it's stopped, and packets that the device steers to it are dropped,
+    /// so it should first be removed from the redirection table, see [`Self::scale_rx_queues`].
+    #[inline]
+    pub fn rx_queue_stop(&self, rx_queue_id: u16) -> Result<()> {
+        unsafe { ffi::rte_eth_dev_rx_queue_stop(self.port_id, rx_queue_id) }.rte_ok()?;
+        Ok(())
+    }
+
+    /// Starts a transmit queue, see [`Self::rx_queue_start`].
+    #[inline]
+    pub fn tx_queue_start(&self, tx_queue_id: u16) -> Result<()> {
+        unsafe { ffi::rte_eth_dev_tx_queue_start(self.port_id, tx_queue_id) }.rte_ok()?;
+        Ok(())
+    }
+
+    /// Stops a transmit queue, which must not be polled while it's stopped.
+    #[inline]
+    pub fn tx_queue_stop(&self, tx_queue_id: u16) -> Result<()> {
+        unsafe { ffi::rte_eth_dev_tx_queue_stop(self.port_id, tx_queue_id) }.rte_ok()?;
+        Ok(())
+    }
+
     #[inline]
     pub fn promiscuous_enable(&self) -> Result<()> {
         unsafe { ffi::rte_eth_promiscuous_enable(self.port_id) }.rte_ok()?;
@@ -0,0 +1,142 @@
+//! Receive side scaling (RSS): the redirection table (RETA) that maps packets' RSS hashes to receive queues, and the
+//! hash configuration, both of which can be updated while the device is running, e.g. to rebalance flows onto queues
+//! that have just been started.
+
+use std::ptr;
+
+use rte_error::{Error, ReturnValue as _};
+
+use super::EthDev;
+use crate::{flags::EthRss, Result};
+
+/// The number of redirection table entries per `rte_eth_rss_reta_entry64`.
+const RETA_GROUP_SIZE: usize = ffi::RTE_ETH_RETA_GROUP_SIZE as usize;
+
+/// Returns a redirection table of `reta_size` entries, spreading the hashes evenly (round-robin) over `queues`.
+fn spread(reta_size: usize, queues: &[u16]) -> Vec<u16> {
+    queues.iter().copied().cycle().take(reta_size).collect()
+}
+
+/// Splits a redirection table into the groups passed to `rte_eth_dev_rss_reta_update`, with all entries selected.
+fn to_groups(reta: &[u16]) -> Vec<ffi::rte_eth_rss_reta_entry64> {
+    reta.chunks(RETA_GROUP_SIZE)
+        .map(|chunk| {
+            let mut group = ffi::rte_eth_rss_reta_entry64 {
+                mask: if chunk.len() == RETA_GROUP_SIZE { u64::MAX } else { (1 << chunk.len()) - 1 },
+                ..Default::default()
+            };
+            group.reta[..chunk.len()].copy_from_slice(chunk);
+            group
+        })
+        .collect()
+}
+
+impl EthDev {
+    /// Returns the number of entries of the device's redirection table.
+    #[inline]
+    pub fn reta_size(&self) -> Result<u16> {
+        Ok(self.info()?.reta_size)
+    }
+
+    /// Returns the device's redirection table, i.e. the receive queue of each RSS hash bucket.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__ethdev_8h.html>
+    pub fn rss_reta(&self) -> Result<Vec<u16>> {
+        let reta_size = self.reta_size()?;
+        let mut groups = to_groups(&vec![0; reta_size.into()]);
+        unsafe { ffi::rte_eth_dev_rss_reta_query(self.port_id, groups.as_mut_ptr(), reta_size) }.rte_ok()?;
+        Ok(groups.iter().flat_map(|group| group.reta).take(reta_size.into()).collect())
+    }
+
+    /// Replaces the device's redirection table, which must have exactly [`Self::reta_size`] entries,
+    /// while the device is running.
+    ///
+    /// Fails with `ENOTSUP` if the driver doesn't support updating the table, and with `EINVAL` if it has the wrong size
+    /// or if it refers to queues that haven't been set up.
+    pub fn rss_reta_update(&self, reta: &[u16]) -> Result<()> {
+        let reta_size = u16::try_from(reta.len()).map_err(|_| Error(libc::EINVAL))?;
+        let mut groups = to_groups(reta);
+        unsafe { ffi::rte_eth_dev_rss_reta_update(self.port_id, groups.as_mut_ptr(), reta_size) }.rte_ok()?;
+        Ok(())
+    }
+
+    /// Spreads the RSS hashes evenly over `queues`, by updating the redirection table, see [`Self::rss_reta_update`].
+    #[inline]
+    pub fn rss_spread(&self, queues: &[u16]) -> Result<()> {
+        if queues.is_empty() {
+            return Err(Error(libc::EINVAL));
+        }
+        self.rss_reta_update(&spread(self.reta_size()?.into(), queues))
+    }
+
+    /// Changes the packet types that are hashed by RSS, and the hash key, if `key` is `Some`
+    /// (it must be [`DeviceInfo::hash_key_size`](super::DeviceInfo) bytes long).
+    #[inline]
+    pub fn rss_hash_update(&self, types: EthRss, key: Option<&[u8]>) -> Result<()> {
+        let (rss_key, rss_key_len) = match key {
+            // the key isn't modified, the pointer is only mutable because the struct is also used by `conf_get`
+            Some(key) => (key.as_ptr() as *mut u8, u8::try_from(key.len()).map_err(|_| Error(libc::EINVAL))?),
+            None => (ptr::null_mut(), 0),
+        };
+        let mut conf = ffi::rte_eth_rss_conf { rss_key, rss_key_len, rss_hf: types.bits(), ..Default::default() };
+        unsafe { ffi::rte_eth_dev_rss_hash_update(self.port_id, &mut conf) }.rte_ok()?;
+        Ok(())
+    }
+
+    /// Returns the packet types that are hashed by RSS, and the hash key, which is empty if the device doesn't report
+    /// the size of its key (`hash_key_size`).
+    #[inline]
+    pub fn rss_hash_conf(&self) -> Result<(EthRss, Vec<u8>)> {
+        let mut key = vec![0; self.info()?.hash_key_size.into()];
+        // some drivers copy their whole key whenever `rss_key` isn't null, regardless of `rss_key_len`, so the (dangling)
+        // pointer of an empty key must not be passed to them
+        let rss_key = if key.is_empty() { ptr::null_mut() } else { key.as_mut_ptr() };
+        let mut conf = ffi::rte_eth_rss_conf { rss_key, rss_key_len: key.len() as u8, ..Default::default() };
+        unsafe { ffi::rte_eth_dev_rss_hash_conf_get(self.port_id, &mut conf) }.rte_ok()?;
+        key.truncate(conf.rss_key_len.into());
+        Ok((EthRss::from_bits_truncate(conf.rss_hf), key))
+    }
+
+    /// Changes the number of active receive queues (among those that have been set up) while the device is running:
+    /// starts queues `0..nb_active`, spreads the RSS hashes over them, then stops the remaining queues.
+    ///
+    /// When scaling up, the new queues should be polled (e.g. by newly spawned workers) right after this returns.
+    /// When scaling down, the queues beyond `nb_active` must no longer be polled by the time this returns (and
+    /// the packets still in them are dropped), so their workers should keep polling them until the redirection table
+    /// has been updated, e.g. by calling [`Self::rss_spread`] first and stopping the workers before calling this.
+    ///
+    /// Fails with `EINVAL` if `nb_active` is zero or larger than the number of queues that have been set up,
+    /// and with `ENOTSUP` if the driver doesn't support starting and stopping queues or updating the table.
+    pub fn scale_rx_queues(&self, nb_active: u16) -> Result<()> {
+        let nb_rx_queues = self.info()?.nb_rx_queues;
+        if nb_active == 0 || nb_active > nb_rx_queues {
+            return Err(Error(libc::EINVAL));
+        }
+
+        // starting and stopping queues that already are started or stopped is a no-op
+        for queue in 0..nb_active {
+            self.rx_queue_start(queue)?;
+        }
+        self.rss_spread(&(0..nb_active).collect::<Vec<_>>())?;
+        for queue in nb_active..nb_rx_queues {
+            self.rx_queue_stop(queue)?;
+        }
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn reta_groups() {
+        let reta = spread(128 + 5, &[1, 2, 3]);
+        assert_eq!(&reta[..7], &[1, 2, 3, 1, 2, 3, 1]);
+
+        let groups = to_groups(&reta);
+        assert_eq!(groups.len(), 3);
+        assert_eq!(groups.iter().map(|group| group.mask).collect::<Vec<_>>(), [u64::MAX, u64::MAX, 0b11111]);
+        assert!(groups.iter().flat_map(|group| group.reta).take(reta.len()).eq(reta.iter().copied()));
+    }
+}
@@ -0,0 +1,250 @@
+use std::fmt;
+
+use super::EthDev;
+use crate::{
+    cycles,
+    mbuf::{MBuf, MBufBatch},
+    mempool::MemoryPool,
+};
+
+type DropCallback<'mempool, const CAP: usize> = Box<dyn FnMut(&mut MBufBatch<&'mempool MemoryPool, CAP>) + 'mempool>;
+
+/// A buffer of packets waiting to be transmitted on a single transmit queue of an Ethernet device,
+/// which coalesces packets added one at a time into bursts of up to `CAP` packets, modeled on `rte_eth_tx_buffer`.
+///
+/// Sending fewer, fuller bursts saves doorbell writes (and PCIe transactions), which matters when every iteration
+/// of a poll loop produces only a handful of packets per destination queue.
+///
+/// The buffer is flushed (i.e. its packets are passed to [`EthDev::tx_burst`]):
+/// - Automatically by [`Self::push`], once the buffer is full.
+/// - Explicitly by calling [`Self::flush`], or [`Self::flush_expired`] which only flushes the buffer if its oldest
+///   packet has been waiting for longer than the drain timeout (e.g. at the end of every iteration of a poll loop).
+///
+/// Packets that could not be sent when the buffer is flushed are counted (see [`Self::unsent`]), passed to the drop
+/// callback if one has been set (see [`Self::set_drop_callback`]), and then freed in bulk.
+///
+/// A `TxBuffer` is meant to be used by a single lcore, and any packets still in the buffer when it's dropped are freed
+/// rather than sent.
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__ethdev_8h.html>
+pub struct TxBuffer<'mempool, const CAP: usize> {
+    dev: EthDev,
+    queue_id: u16,
+    mempool: &'mempool MemoryPool,
+    pkts: MBufBatch<&'mempool MemoryPool, CAP>,
+    drain_cycles: u64,
+    /// The TSC value when the first packet was added to the (empty) buffer
+    oldest: u64,
+    unsent: u64,
+    on_drop: Option<DropCallback<'mempool, CAP>>,
+}
+
+impl<'mempool, const CAP: usize> TxBuffer<'mempool, CAP> {
+    /// Rejects empty buffers at compile time, since [`Self::push`] relies on there always being room for a packet.
+    const NON_ZERO_CAP: () = assert!(CAP > 0, "a TxBuffer must be able to hold at least one packet");
+
+    /// Creates an empty buffer for the given transmit queue, whose packets are sent by [`Self::flush_expired`]
+    /// once they have been waiting for `drain_cycles` TSC cycles (see [`cycles::duration_to_cycles`]).
+    ///
+    /// # Safety
+    /// It is up to the caller to guarantee that `mempool` matches the memory pool used for this queue,
+    /// see [`EthDev::tx_burst`].
+    #[inline]
+    pub unsafe fn new(dev: EthDev, queue_id: u16, mempool: &'mempool MemoryPool, drain_cycles: u64) -> Self {
+        let () = Self::NON_ZERO_CAP;
+        Self { dev, queue_id, mempool, pkts: MBufBatch::new(), drain_cycles, oldest: 0, unsent: 0, on_drop: None }
+    }
+
+    /// Sets a callback that is called with the packets that were not sent when flushing the buffer
+    /// (instead of just freeing them), e.g. for counting them per-flow, or for re-enqueueing them elsewhere.
+    ///
+    /// Packets that remain in the batch once the callback returns are freed in bulk.
+    #[inline]
+    pub fn set_drop_callback<F>(&mut self, f: F)
+    where
+        F: FnMut(&mut MBufBatch<&'mempool MemoryPool, CAP>) + 'mempool,
+    {
+        self.on_drop = Some(Box::new(f));
+    }
+
+    #[inline]
+    pub fn dev(&self) -> &EthDev {
+        &self.dev
+    }
+
+    #[inline]
+    pub fn queue_id(&self) -> u16 {
+        self.queue_id
+    }
+
+    /// Returns the number of packets in the buffer.
+    #[inline]
+    pub fn len(&self) -> usize {
+        self.pkts.len()
+    }
+
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.pkts.is_empty()
+    }
+
+    /// Returns the total number of packets that could not be sent when flushing the buffer.
+    #[inline]
+    pub fn unsent(&self) -> u64 {
+        self.unsent
+    }
+
+    /// Adds a packet to the buffer, flushing it if it becomes full.
+    ///
+    /// Returns the number of packets that were sent (which is 0 unless the buffer was flushed).
+    #[inline]
+    pub fn push(&mut self, mbuf: MBuf<&'mempool MemoryPool>) -> usize {
+        if self.pkts.is_empty() {
+            self.oldest = cycles::rdtsc();
+        }
+
+        // the buffer is flushed as soon as it becomes full, so there is always room for another packet
+        unsafe { self.pkts.push_unchecked(mbuf) };
+
+        if self.pkts.is_full() {
+            self.flush()
+        } else {
+            0
+        }
+    }
+
+    /// Sends all packets in the buffer, using a single call to [`EthDev::tx_burst`].
+    ///
+    /// Returns the number of packets that were sent, any packets that were not sent are dropped (see [`TxBuffer`]).
+    #[inline]
+    pub fn flush(&mut self) -> usize {
+        let len = self.pkts.len();
+        if len == 0 {
+            return 0;
+        }
+
+        unsafe { self.dev.tx_burst(self.queue_id, self.mempool, &mut self.pkts) };
+
+        let sent = len - self.pkts.len();
+        if !self.pkts.is_empty() {
+            self.unsent += self.pkts.len() as u64;
+            #[cfg(feature = "instrumentation")]
+            crate::instrumentation::record_dropped(self.pkts.len());
+            if let Some(on_drop) = &mut self.on_drop {
+                on_drop(&mut self.pkts);
+            }
+            self.pkts.free_all();
+        }
+
+        sent
+    }
+
+    /// Flushes the buffer if its oldest packet was added more than the drain timeout ago, given the current
+    /// TSC value (see [`cycles::rdtsc`]), which can be read once for all buffers checked in the same iteration.
+    ///
+    /// Returns the number of packets that were sent.
+    #[inline]
+    pub fn flush_expired(&mut self, now: u64) -> usize {
+        if !self.pkts.is_empty() && now.wrapping_sub(self.oldest) >= self.drain_cycles {
+            self.flush()
+        } else {
+            0
+        }
+    }
+}
+
+impl<const CAP: usize> fmt::Debug for TxBuffer<'_, CAP> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("TxBuffer")
+            .field("port_id", &self.dev.port_id())
+            .field("queue_id", &self.queue_id)
+            .field("len", &self.pkts.len())
+            .field("drain_cycles", &self.drain_cycles)
+            .field("unsent", &self.unsent)
+            .finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::{cell::Cell, rc::Rc};
+
+    use rte_error::ReturnValue as _;
+    use rte_test_macros::rte_test;
+
+    use super::*;
+
+    #[rte_test(mock_lcore)]
+    fn flushes() {
+        let mempool =
+            MemoryPool::new("tx_buffer_test_pool", 63, 0, 0, ffi::RTE_MBUF_DEFAULT_BUF_SIZE as u16, None).unwrap();
+
+        // a `net_ring` device whose queues are a (looped back) ring of 6 packets, so that it stops sending once full
+        let ring = unsafe {
+            ffi::rte_ring_create(
+                b"tx_buffer_test_ring\0".as_ptr() as _,
+                6,
+                -1,
+                ffi::RING_F_EXACT_SZ | ffi::RING_F_SP_ENQ | ffi::RING_F_SC_DEQ,
+            )
+        }
+        .rte_ok()
+        .unwrap();
+        let port_id = unsafe { ffi::rte_eth_from_ring(ring.as_ptr()) };
+        assert!(port_id >= 0);
+        let dev = EthDev::new(port_id as u16);
+        dev.configure(1, 1, &Default::default()).unwrap();
+        dev.rx_queue_setup(0, 64, None, &mempool).unwrap();
+        dev.tx_queue_setup(0, 64, None).unwrap();
+        dev.start().unwrap();
+
+        let drain = || {
+            let mut pkts = MBufBatch::<_, 8>::new();
+            unsafe { dev.rx_burst(0, &mempool, &mut pkts) };
+            pkts.len()
+        };
+
+        let mut buf = unsafe { TxBuffer::<4>::new(dev.clone(), 0, &mempool, 1000) };
+        let dropped = Rc::new(Cell::new(0));
+        buf.set_drop_callback({
+            let dropped = dropped.clone();
+            move |pkts| dropped.set(dropped.get() + pkts.len())
+        });
+
+        // the buffer is flushed once it becomes full
+        for _ in 0..3 {
+            assert_eq!(buf.push(MBuf::new_with_provider(&&mempool)), 0);
+        }
+        assert_eq!(buf.len(), 3);
+        assert_eq!(buf.push(MBuf::new_with_provider(&&mempool)), 4);
+        assert!(buf.is_empty());
+
+        // only 2 more packets fit in the ring, the others are passed to the drop callback, and then freed
+        for _ in 0..3 {
+            buf.push(MBuf::new_with_provider(&&mempool));
+        }
+        assert_eq!(buf.push(MBuf::new_with_provider(&&mempool)), 2);
+        assert_eq!(buf.unsent(), 2);
+        assert_eq!(dropped.get(), 2);
+        assert_eq!(mempool.get_in_use_count(), 6);
+        assert_eq!(drain(), 6);
+
+        // the buffer is only flushed once its oldest packet has waited for the drain timeout
+        buf.push(MBuf::new_with_provider(&&mempool));
+        let oldest = buf.oldest;
+        assert_eq!(buf.flush_expired(oldest + 999), 0);
+        assert_eq!(buf.len(), 1);
+        assert_eq!(buf.flush_expired(oldest + 1000), 1);
+        assert!(buf.is_empty());
+        assert_eq!(buf.flush_expired(oldest + 2000), 0);
+        assert_eq!(drain(), 1);
+
+        assert_eq!(buf.unsent(), 2);
+        assert_eq!(mempool.get_in_use_count(), 0);
+
+        drop(buf);
+        dev.stop().unwrap();
+        dev.close().unwrap();
+        unsafe { ffi::rte_ring_free(ring.as_ptr()) };
+    }
+}
@@ -2,9 +2,10 @@ use std::{
     collections::HashMap,
     ffi::CStr,
     ptr::{null, null_mut},
+    time::Instant,
 };
 
-use rte_error::ReturnValue;
+use rte_error::{Error, ReturnValue};
 
 use super::EthDev;
 use crate::Result;
@@ -14,6 +15,144 @@ use crate::Result;
 #[derive(Debug, Clone, PartialEq, Eq)]
 pub struct XStatsDefs(Vec<String>);
 
+impl XStatsDefs {
+    /// Returns the names of all xstats of the device, where the index of each name is the ID of the xstat.
+    #[inline]
+    pub fn names(&self) -> &[String] {
+        &self.0
+    }
+
+    /// Selects the xstats whose names are accepted by `filter`, see [`XStatsSelection`].
+    pub fn select<F>(&self, mut filter: F) -> XStatsSelection
+    where
+        F: FnMut(&str) -> bool,
+    {
+        let (ids, names) = self
+            .0
+            .iter()
+            .enumerate()
+            .filter(|(_, name)| filter(name))
+            .map(|(id, name)| (id as u64, name.clone()))
+            .unzip();
+        XStatsSelection { ids, names }
+    }
+
+    /// Selects the xstats with the given names (in the given order), see [`XStatsSelection`].
+    ///
+    /// Returns `None` if the device doesn't have an xstat with one of the names.
+    pub fn select_names<'n, I>(&self, names: I) -> Option<XStatsSelection>
+    where
+        I: IntoIterator<Item = &'n str>,
+    {
+        let (ids, names) = names
+            .into_iter()
+            .map(|name| Some((self.0.iter().position(|def| def == name)? as u64, name.to_string())))
+            .collect::<Option<Vec<_>>>()?
+            .into_iter()
+            .unzip();
+        Some(XStatsSelection { ids, names })
+    }
+}
+
+/// A subset of the xstats of a device, which should be created once (from [`XStatsDefs`]), and then re-used with
+/// [`EthDev::read_xstats`] for reading only the selected xstats into an [`XStatsSnapshot`].
+///
+/// Reading a selection doesn't allocate, and only fetches the selected counters from the driver.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct XStatsSelection {
+    ids: Vec<u64>,
+    names: Vec<String>,
+}
+
+impl XStatsSelection {
+    /// Returns the number of selected xstats.
+    #[inline]
+    pub fn len(&self) -> usize {
+        self.ids.len()
+    }
+
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.ids.is_empty()
+    }
+
+    /// Returns the IDs of the selected xstats.
+    #[inline]
+    pub fn ids(&self) -> &[u64] {
+        &self.ids
+    }
+
+    /// Returns the names of the selected xstats, in the same order as the values of an [`XStatsSnapshot`].
+    #[inline]
+    pub fn names(&self) -> impl ExactSizeIterator<Item = &str> + '_ {
+        self.names.iter().map(String::as_str)
+    }
+}
+
+/// The values of the xstats of an [`XStatsSelection`], as read at a point in time by [`EthDev::read_xstats`].
+///
+/// A snapshot is meant to be reused: a common pattern is keeping two snapshots, reading into the older one,
+/// computing the [deltas](Self::deltas) (or [rates](Self::rates)) from the newer one, and then swapping them:
+/// ```rust,no_run
+/// # use std::{mem, thread, time::Duration};
+/// # use rte::ethdev::{EthDev, XStatsSnapshot};
+/// # fn example(dev: &EthDev) -> Result<(), rte_error::Error> {
+/// let selection = dev.get_xstats_def()?.select(|name| name.starts_with("rx_"));
+/// let (mut prev, mut curr) = (XStatsSnapshot::new(&selection), XStatsSnapshot::new(&selection));
+/// dev.read_xstats(&selection, &mut prev)?;
+///
+/// loop {
+///     thread::sleep(Duration::from_millis(100));
+///     dev.read_xstats(&selection, &mut curr)?;
+///     for (name, rate) in selection.names().zip(curr.rates(&prev)) {
+///         println!("{name}: {rate:.0}/s");
+///     }
+///     mem::swap(&mut prev, &mut curr);
+/// }
+/// # }
+/// ```
+#[derive(Debug, Clone, PartialEq)]
+pub struct XStatsSnapshot {
+    values: Vec<u64>,
+    taken_at: Instant,
+}
+
+impl XStatsSnapshot {
+    /// Creates an empty (zeroed) snapshot, with room for the values of all xstats in `selection`.
+    #[inline]
+    pub fn new(selection: &XStatsSelection) -> Self {
+        Self { values: vec![0; selection.len()], taken_at: Instant::now() }
+    }
+
+    /// Returns the values of the xstats, in the same order as [`XStatsSelection::names`].
+    #[inline]
+    pub fn values(&self) -> &[u64] {
+        &self.values
+    }
+
+    /// Returns the time at which the snapshot was read.
+    #[inline]
+    pub fn taken_at(&self) -> Instant {
+        self.taken_at
+    }
+
+    /// Returns the difference between the value of each xstat in `self` and its value in the (older) snapshot `prev`.
+    ///
+    /// Counters that have decreased (e.g. since the device's stats have been reset) yield 0.
+    #[inline]
+    pub fn deltas<'s>(&'s self, prev: &'s XStatsSnapshot) -> impl ExactSizeIterator<Item = u64> + 's {
+        debug_assert_eq!(self.values.len(), prev.values.len());
+        self.values.iter().zip(&prev.values).map(|(curr, prev)| curr.saturating_sub(*prev))
+    }
+
+    /// Returns the per-second rate of change of each xstat between the (older) snapshot `prev` and `self`.
+    #[inline]
+    pub fn rates<'s>(&'s self, prev: &'s XStatsSnapshot) -> impl ExactSizeIterator<Item = f64> + 's {
+        let elapsed = self.taken_at.saturating_duration_since(prev.taken_at).as_secs_f64();
+        self.deltas(prev).map(move |delta| if elapsed > 0.0 { delta as f64 / elapsed } else { 0.0 })
+    }
+}
+
 impl EthDev {
     fn get_xstats_count(&self) -> Result<u32> {
         let count = unsafe { ffi::rte_eth_xstats_get_names_by_id(self.port_id, null_mut(), 0, null_mut()) }.rte_ok()?;
@@ -71,4 +210,58 @@ impl EthDev {
 
         Ok(defs.iter().zip(values).map(|(id, value)| (id.as_str(), value)).collect())
     }
+
+    /// Reads the current values of the selected xstats into `snapshot`, without allocating.
+    ///
+    /// Fails with `EINVAL` if the device didn't return a value for every selected xstat (e.g. because the ids
+    /// changed since `selection` was made), in which case the values of `snapshot` are unspecified (but its timestamp
+    /// isn't updated), so it shouldn't be used to compute deltas.
+    ///
+    /// # Panics
+    /// If `snapshot` wasn't created for `selection` (see [`XStatsSnapshot::new`]).
+    pub fn read_xstats(&self, selection: &XStatsSelection, snapshot: &mut XStatsSnapshot) -> Result<()> {
+        assert_eq!(selection.ids.len(), snapshot.values.len(), "snapshot doesn't match the xstats selection");
+
+        let values_written = unsafe {
+            ffi::rte_eth_xstats_get_by_id(
+                self.port_id,
+                selection.ids.as_ptr(),
+                snapshot.values.as_mut_ptr(),
+                selection.ids.len() as u32,
+            )
+        }
+        .rte_ok()?;
+
+        if values_written as usize != selection.ids.len() {
+            return Err(Error(libc::EINVAL));
+        }
+
+        snapshot.taken_at = Instant::now();
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::time::Duration;
+
+    use super::*;
+
+    #[test]
+    fn selection_and_deltas() {
+        let defs = XStatsDefs(["rx_good_packets", "tx_good_packets", "rx_missed_errors"].map(String::from).to_vec());
+        let selection = defs.select(|name| name.starts_with("rx_"));
+        assert_eq!(selection.ids(), [0, 2]);
+        assert_eq!(defs.select_names(["rx_missed_errors", "tx_good_packets"]).unwrap().ids(), [2, 1]);
+        assert!(defs.select_names(["rx_bytes"]).is_none());
+
+        let mut prev = XStatsSnapshot::new(&selection);
+        let mut curr = prev.clone();
+        prev.values.copy_from_slice(&[100, 7]);
+        curr.values.copy_from_slice(&[300, 5]);
+        curr.taken_at = prev.taken_at + Duration::from_millis(500);
+
+        assert_eq!(curr.deltas(&prev).collect::<Vec<_>>(), [200, 0]);
+        assert_eq!(curr.rates(&prev).collect::<Vec<_>>(), [400.0, 0.0]);
+    }
 }
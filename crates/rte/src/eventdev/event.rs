@@ -0,0 +1,138 @@
+use std::{fmt, marker::PhantomData, mem, ptr};
+
+use super::SchedType;
+use crate::mbuf::{Allocator, MBuf};
+
+/// The mask of the bits of a flow id, which is 20 bits wide.
+pub const FLOW_ID_MASK: u32 = (1 << 20) - 1;
+
+/// An event carrying a packet, which is owned by the event until the event is enqueued to an event device, or
+/// converted back to the packet with [`Self::into_mbuf`].
+///
+/// The flow id of an event is used by atomic and ordered queues to keep the events of each flow in order, e.g. the
+/// [`EthRxAdapter`](super::EthRxAdapter) uses the RSS hash of each packet.
+///
+/// See also: <https://doc.dpdk.org/api-21.08/structrte__event.html>
+#[repr(transparent)]
+pub struct Event<A>
+where
+    A: Allocator,
+{
+    raw: ffi::rte_event,
+    _marker: PhantomData<MBuf<A>>,
+}
+
+impl<A> Event<A>
+where
+    A: Allocator,
+{
+    /// Creates a new event (i.e. injected into the device, as opposed to forwarded by a worker), for the queue
+    /// `queue_id`, with normal priority. Only the lower 20 bits of `flow_id` are used, see [`FLOW_ID_MASK`].
+    #[inline]
+    pub fn new(mbuf: MBuf<A>, queue_id: u8, sched_type: SchedType, flow_id: u32) -> Self {
+        let mut raw: ffi::rte_event = Default::default();
+        unsafe {
+            let fields = &mut raw.__bindgen_anon_1.__bindgen_anon_1;
+            fields.set_flow_id(flow_id & FLOW_ID_MASK);
+            fields.set_event_type(ffi::RTE_EVENT_TYPE_CPU);
+            fields.set_op(ffi::RTE_EVENT_OP_NEW as u8);
+            fields.set_sched_type(sched_type as u8);
+            fields.queue_id = queue_id;
+            fields.priority = ffi::RTE_EVENT_DEV_PRIORITY_NORMAL as u8;
+            raw.__bindgen_anon_2.mbuf = mbuf.as_raw();
+        }
+        mem::forget(mbuf);
+        Self { raw, _marker: PhantomData }
+    }
+
+    #[inline]
+    pub fn flow_id(&self) -> u32 {
+        unsafe { self.raw.__bindgen_anon_1.__bindgen_anon_1.flow_id() }
+    }
+
+    /// Returns the queue the event was scheduled from (or is enqueued to).
+    #[inline]
+    pub fn queue_id(&self) -> u8 {
+        unsafe { self.raw.__bindgen_anon_1.__bindgen_anon_1.queue_id }
+    }
+
+    #[inline]
+    pub fn sched_type(&self) -> SchedType {
+        SchedType::from_raw(unsafe { self.raw.__bindgen_anon_1.__bindgen_anon_1.sched_type() })
+    }
+
+    /// Makes the event a forwarded event, for the queue `queue_id` (i.e. the next stage of the pipeline), see
+    /// [`EventDev::forward_burst`](super::EventDev::forward_burst). The flow id and the priority are kept.
+    #[inline]
+    pub fn forward_to(&mut self, queue_id: u8, sched_type: SchedType) {
+        unsafe {
+            let fields = &mut self.raw.__bindgen_anon_1.__bindgen_anon_1;
+            fields.set_op(ffi::RTE_EVENT_OP_FORWARD as u8);
+            fields.set_sched_type(sched_type as u8);
+            fields.queue_id = queue_id;
+        }
+    }
+
+    #[inline]
+    pub fn mbuf(&self) -> &MBuf<A> {
+        // `MBuf` is a transparent wrapper around `NonNull<rte_mbuf>`, and the event always carries an mbuf
+        unsafe { &*(&self.raw.__bindgen_anon_2.mbuf as *const *mut ffi::rte_mbuf as *const MBuf<A>) }
+    }
+
+    #[inline]
+    pub fn mbuf_mut(&mut self) -> &mut MBuf<A> {
+        unsafe { &mut *(&mut self.raw.__bindgen_anon_2.mbuf as *mut *mut ffi::rte_mbuf as *mut MBuf<A>) }
+    }
+
+    /// Returns the packet carried by the event, e.g. for transmitting it at the last stage of the pipeline.
+    #[inline]
+    pub fn into_mbuf(self) -> MBuf<A> {
+        let mbuf = unsafe { ptr::read(self.mbuf()) };
+        mem::forget(self);
+        mbuf
+    }
+}
+
+impl<A> Drop for Event<A>
+where
+    A: Allocator,
+{
+    #[inline]
+    fn drop(&mut self) {
+        unsafe { ptr::drop_in_place(self.mbuf_mut()) }
+    }
+}
+
+impl<A> fmt::Debug for Event<A>
+where
+    A: Allocator,
+{
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Event")
+            .field("queue_id", &self.queue_id())
+            .field("sched_type", &self.sched_type())
+            .field("flow_id", &self.flow_id())
+            .finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::mbuf::GlobalAllocator;
+
+    #[test]
+    fn event_fields() {
+        let mbuf = MBuf::<GlobalAllocator>::new_with_data(b"payload");
+        let mut event = Event::new(mbuf, 3, SchedType::Atomic, 0xabc_def01);
+        assert_eq!((event.queue_id(), event.sched_type(), event.flow_id()), (3, SchedType::Atomic, 0xdef01));
+        assert_eq!(unsafe { event.raw.__bindgen_anon_1.__bindgen_anon_1.op() }, ffi::RTE_EVENT_OP_NEW as u8);
+
+        event.forward_to(5, SchedType::Ordered);
+        assert_eq!((event.queue_id(), event.sched_type(), event.flow_id()), (5, SchedType::Ordered, 0xdef01));
+        assert_eq!(unsafe { event.raw.__bindgen_anon_1.__bindgen_anon_1.op() }, ffi::RTE_EVENT_OP_FORWARD as u8);
+
+        event.mbuf_mut().extend_from_slice(b"!");
+        assert_eq!(&event.into_mbuf()[..], b"payload!");
+    }
+}
@@ -0,0 +1,360 @@
+//! Event devices, which schedule events (each carrying a packet) from event queues to the event ports of worker
+//! lcores, based on DPDK's [Event Device Library](https://doc.dpdk.org/guides-21.08/prog_guide/eventdev.html).
+//!
+//! Unlike RSS (where a single heavy flow pins a single queue, and so a single lcore), an event device balances the
+//! load dynamically, while keeping the packets of each flow in order, depending on the [`SchedType`] of each queue:
+//! - [`SchedType::Atomic`] queues schedule each flow to a single port at a time (i.e. the flow's packets are processed
+//!   one at a time, in order), e.g. for stateful processing.
+//! - [`SchedType::Ordered`] queues schedule the packets of a flow to any ports (i.e. in parallel), and restore their
+//!   original order when they're forwarded to the next queue.
+//!
+//! Packets are injected into the device by an [`EthRxAdapter`], or by enqueueing [`Event::new`] events, each pipeline
+//! stage is a queue, and workers dequeue events from the queues linked to their port, process them, and forward them
+//! to the next stage's queue, see [`EventDev::forward_burst`].
+//!
+//! Software event devices (e.g. `event_sw`), as well as adapters without an internal port, are run by DPDK services,
+//! which must be mapped to a service lcore (or run by the application), see [`Service`].
+
+mod event;
+mod rx_adapter;
+
+use std::{ffi::CString, mem, time::Duration};
+
+use arrayvec::ArrayVec;
+use rte_error::{rte_error, Error, ReturnValue as _};
+
+pub use self::{
+    event::{Event, FLOW_ID_MASK},
+    rx_adapter::EthRxAdapter,
+};
+use crate::{lcore, mempool::MemoryPool, Result};
+
+pub type EventDevInfo = ffi::rte_event_dev_info;
+pub type EventDevConfig = ffi::rte_event_dev_config;
+pub type QueueConf = ffi::rte_event_queue_conf;
+pub type PortConf = ffi::rte_event_port_conf;
+
+/// How the events of a queue are scheduled to the ports linked to it.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(u8)]
+pub enum SchedType {
+    /// Events of the same flow may be processed in parallel, and are put back in order when they're forwarded.
+    Ordered = ffi::RTE_SCHED_TYPE_ORDERED as u8,
+    /// Events of the same flow are processed by a single port at a time.
+    Atomic = ffi::RTE_SCHED_TYPE_ATOMIC as u8,
+    /// Events are processed in parallel, without any ordering.
+    Parallel = ffi::RTE_SCHED_TYPE_PARALLEL as u8,
+}
+
+impl SchedType {
+    #[inline]
+    fn from_raw(sched_type: u8) -> Self {
+        match sched_type as u32 {
+            ffi::RTE_SCHED_TYPE_ORDERED => Self::Ordered,
+            ffi::RTE_SCHED_TYPE_ATOMIC => Self::Atomic,
+            _ => Self::Parallel,
+        }
+    }
+}
+
+/// A DPDK service, which runs the scheduling of a software event device, or an adapter.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Service(u32);
+
+impl Service {
+    #[inline]
+    pub fn id(&self) -> u32 {
+        self.0
+    }
+
+    /// Enables (or disables) running the service.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__service_8h.html>
+    #[inline]
+    pub fn set_running(&self, running: bool) -> Result<()> {
+        unsafe { ffi::rte_service_runstate_set(self.0, running.into()) }.rte_ok()?;
+        Ok(())
+    }
+
+    /// Runs the service on the given lcore, which becomes a service lcore (i.e. it must not be used for anything else),
+    /// and enables running the service.
+    pub fn map_lcore(&self, lcore: lcore::Id) -> Result<()> {
+        let lcore_id = lcore.get();
+        unsafe {
+            match ffi::rte_service_lcore_add(lcore_id) {
+                ret if ret == 0 || ret == -libc::EALREADY => {}
+                ret => return Err(Error(-ret)),
+            }
+            ffi::rte_service_map_lcore_set(self.0, lcore_id, 1).rte_ok()?;
+            match ffi::rte_service_lcore_start(lcore_id) {
+                ret if ret == 0 || ret == -libc::EALREADY => {}
+                ret => return Err(Error(-ret)),
+            }
+        }
+        self.set_running(true)
+    }
+
+    /// Runs a single iteration of the service on the current lcore, e.g. from the main loop of a worker, instead of
+    /// dedicating a service lcore to it. The service must be [running](Self::set_running).
+    ///
+    /// Fails with `EBUSY` if another lcore is running the service at the same time.
+    #[inline]
+    pub fn run_iter(&self) -> Result<()> {
+        unsafe { ffi::rte_service_run_iter_on_app_lcore(self.0, 1) }.rte_ok()?;
+        Ok(())
+    }
+}
+
+/// An event device.
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__eventdev_8h.html>
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct EventDev {
+    dev_id: u8,
+}
+
+impl EventDev {
+    #[inline]
+    pub fn new(dev_id: u8) -> Self {
+        EventDev { dev_id }
+    }
+
+    /// Looks up a device by name, e.g. `event_sw0` for a software event device created with `--vdev=event_sw0`.
+    ///
+    /// Fails with `ENODEV` if there is no such device.
+    #[inline]
+    pub fn from_name<S: Into<Vec<u8>>>(name: S) -> Result<Self> {
+        let name = CString::new(name).unwrap();
+        match unsafe { ffi::rte_event_dev_get_dev_id(name.as_ptr()) } {
+            dev_id if dev_id >= 0 => Ok(Self::new(dev_id as u8)),
+            _ => Err(Error(libc::ENODEV)),
+        }
+    }
+
+    /// Returns the number of event devices.
+    #[inline]
+    pub fn count() -> u8 {
+        unsafe { ffi::rte_event_dev_count() }
+    }
+
+    #[inline]
+    pub fn dev_id(&self) -> u8 {
+        self.dev_id
+    }
+
+    #[inline]
+    pub fn info(&self) -> Result<EventDevInfo> {
+        let mut info: EventDevInfo = Default::default();
+        unsafe { ffi::rte_event_dev_info_get(self.dev_id, &mut info) }.rte_ok()?;
+        Ok(info)
+    }
+
+    /// Returns a configuration of `nb_queues` queues and `nb_ports` ports, with the largest number of events, flows and
+    /// enqueue/dequeue depths supported by the device, and its smallest dequeue timeout.
+    #[inline]
+    pub fn default_config(&self, nb_queues: u8, nb_ports: u8) -> Result<EventDevConfig> {
+        let info = self.info()?;
+        Ok(EventDevConfig {
+            dequeue_timeout_ns: info.min_dequeue_timeout_ns,
+            nb_events_limit: info.max_num_events,
+            nb_event_queues: nb_queues,
+            nb_event_ports: nb_ports,
+            nb_event_queue_flows: info.max_event_queue_flows,
+            nb_event_port_dequeue_depth: info.max_event_port_dequeue_depth,
+            nb_event_port_enqueue_depth: info.max_event_port_enqueue_depth,
+            ..Default::default()
+        })
+    }
+
+    /// Configures the device, which must be done before setting up its queues and ports, see [`Self::default_config`].
+    #[inline]
+    pub fn configure(&self, conf: &EventDevConfig) -> Result<()> {
+        unsafe { ffi::rte_event_dev_configure(self.dev_id, conf) }.rte_ok()?;
+        Ok(())
+    }
+
+    /// Sets up a queue with the device's default configuration, and the given scheduling type.
+    #[inline]
+    pub fn queue_setup(&self, queue_id: u8, sched_type: SchedType) -> Result<()> {
+        let mut conf: QueueConf = Default::default();
+        unsafe { ffi::rte_event_queue_default_conf_get(self.dev_id, queue_id, &mut conf) }.rte_ok()?;
+        conf.schedule_type = sched_type as u8;
+        self.queue_setup_with_conf(queue_id, &conf)
+    }
+
+    #[inline]
+    pub fn queue_setup_with_conf(&self, queue_id: u8, conf: &QueueConf) -> Result<()> {
+        unsafe { ffi::rte_event_queue_setup(self.dev_id, queue_id, conf) }.rte_ok()?;
+        Ok(())
+    }
+
+    #[inline]
+    pub fn port_default_conf(&self, port_id: u8) -> Result<PortConf> {
+        let mut conf: PortConf = Default::default();
+        unsafe { ffi::rte_event_port_default_conf_get(self.dev_id, port_id, &mut conf) }.rte_ok()?;
+        Ok(conf)
+    }
+
+    /// Sets up a port with the device's default configuration, see [`Self::port_default_conf`].
+    #[inline]
+    pub fn port_setup(&self, port_id: u8) -> Result<()> {
+        self.port_setup_with_conf(port_id, &self.port_default_conf(port_id)?)
+    }
+
+    #[inline]
+    pub fn port_setup_with_conf(&self, port_id: u8, conf: &PortConf) -> Result<()> {
+        unsafe { ffi::rte_event_port_setup(self.dev_id, port_id, conf) }.rte_ok()?;
+        Ok(())
+    }
+
+    /// Links a port to the given queues (with normal priority), so that the events of these queues are scheduled to
+    /// the port, or to all queues if `queues` is empty.
+    #[inline]
+    pub fn port_link(&self, port_id: u8, queues: &[u8]) -> Result<()> {
+        let (ptr, len) = if queues.is_empty() { (std::ptr::null(), 0) } else { (queues.as_ptr(), queues.len()) };
+        let linked = unsafe { ffi::rte_event_port_link(self.dev_id, port_id, ptr, std::ptr::null(), len as u16) };
+        if linked < 0 || (!queues.is_empty() && linked as usize != queues.len()) {
+            return Err(rte_error());
+        }
+        Ok(())
+    }
+
+    /// Unlinks a port from the given queues, or from all queues if `queues` is empty.
+    ///
+    /// Events of these queues may still be scheduled to the port until the unlink completes in the device.
+    #[inline]
+    pub fn port_unlink(&self, port_id: u8, queues: &[u8]) -> Result<()> {
+        let (ptr, len) = if queues.is_empty() { (std::ptr::null_mut(), 0) } else { (queues.as_ptr(), queues.len()) };
+        let unlinked = unsafe { ffi::rte_event_port_unlink(self.dev_id, port_id, ptr as _, len as u16) };
+        if unlinked < 0 || (!queues.is_empty() && unlinked as usize != queues.len()) {
+            return Err(rte_error());
+        }
+        Ok(())
+    }
+
+    /// Returns the service that runs the device's scheduler, if it's a software device.
+    #[inline]
+    pub fn service(&self) -> Option<Service> {
+        let mut service_id = 0;
+        (unsafe { ffi::rte_event_dev_service_id_get(self.dev_id, &mut service_id) } == 0).then(|| Service(service_id))
+    }
+
+    /// Converts a dequeue timeout to the device's ticks, see [`Self::dequeue_burst`].
+    #[inline]
+    pub fn dequeue_timeout_ticks(&self, timeout: Duration) -> Result<u64> {
+        let mut ticks = 0;
+        unsafe { ffi::rte_event_dequeue_timeout_ticks(self.dev_id, timeout.as_nanos() as u64, &mut ticks) }.rte_ok()?;
+        Ok(ticks)
+    }
+
+    #[inline]
+    pub fn start(&self) -> Result<()> {
+        unsafe { ffi::rte_event_dev_start(self.dev_id) }.rte_ok()?;
+        Ok(())
+    }
+
+    #[inline]
+    pub fn stop(&self) {
+        unsafe { ffi::rte_event_dev_stop(self.dev_id) }
+    }
+
+    #[inline]
+    pub fn close(&self) -> Result<()> {
+        unsafe { ffi::rte_event_dev_close(self.dev_id) }.rte_ok()?;
+        Ok(())
+    }
+
+    /// Dequeues a burst of events from the queues linked to a port, waiting for up to `timeout_ticks` (see
+    /// [`Self::dequeue_timeout_ticks`]) if there are none. The events are appended to `events`, see
+    /// [`EthDev::rx_burst`](crate::ethdev::EthDev::rx_burst).
+    ///
+    /// Dequeuing implicitly releases the events of the previous dequeue (unless the port was set up with
+    /// `RTE_EVENT_PORT_CFG_DISABLE_IMPL_REL`), i.e. their flows can then be scheduled to other ports, so they should
+    /// have been forwarded (or dropped) by then.
+    ///
+    /// A port must only be used by a single lcore at a time.
+    ///
+    /// # Safety
+    /// It is up to the caller to guarantee that all the events enqueued to the device (including by adapters)
+    /// carry an mbuf allocated from `mempool`.
+    #[inline]
+    pub unsafe fn dequeue_burst<'mempool, const CAP: usize>(
+        &self,
+        port_id: u8,
+        _mempool: &'mempool MemoryPool,
+        events: &mut ArrayVec<Event<&'mempool MemoryPool>, CAP>,
+        timeout_ticks: u64,
+    ) -> usize {
+        let old_len = events.len();
+        // `Event` is a transparent wrapper around `rte_event`
+        let dequeued = ffi::_rte_event_dequeue_burst(
+            self.dev_id,
+            port_id,
+            events.as_mut_ptr().add(old_len) as _,
+            events.remaining_capacity() as u16,
+            timeout_ticks,
+        ) as usize;
+        events.set_len(old_len + dequeued);
+        dequeued
+    }
+
+    /// Enqueues a burst of events (whose operations may differ) to a port. The events that have been enqueued are
+    /// removed from `events`, the remaining ones (e.g. because of back pressure) can be retried.
+    ///
+    /// # Safety
+    /// See [`Self::dequeue_burst`].
+    #[inline]
+    pub unsafe fn enqueue_burst<'mempool, const CAP: usize>(
+        &self,
+        port_id: u8,
+        _mempool: &'mempool MemoryPool,
+        events: &mut ArrayVec<Event<&'mempool MemoryPool>, CAP>,
+    ) -> usize {
+        let enqueued =
+            ffi::_rte_event_enqueue_burst(self.dev_id, port_id, events.as_ptr() as _, events.len() as u16) as usize;
+        events.drain(..enqueued).for_each(mem::forget);
+        enqueued
+    }
+
+    /// Enqueues a burst of new events (see [`Event::new`]) to a port, which is faster than [`Self::enqueue_burst`]
+    /// on some devices.
+    ///
+    /// # Safety
+    /// See [`Self::dequeue_burst`].
+    #[inline]
+    pub unsafe fn enqueue_new_burst<'mempool, const CAP: usize>(
+        &self,
+        port_id: u8,
+        _mempool: &'mempool MemoryPool,
+        events: &mut ArrayVec<Event<&'mempool MemoryPool>, CAP>,
+    ) -> usize {
+        let enqueued =
+            ffi::_rte_event_enqueue_new_burst(self.dev_id, port_id, events.as_ptr() as _, events.len() as u16) as usize;
+        events.drain(..enqueued).for_each(mem::forget);
+        enqueued
+    }
+
+    /// Forwards a burst of dequeued events to the next stage, i.e. to the queue `queue_id`, where they're scheduled
+    /// with `sched_type` (see [`Event::forward_to`]). The events that have been enqueued are removed from `events`.
+    ///
+    /// # Safety
+    /// See [`Self::dequeue_burst`].
+    #[inline]
+    pub unsafe fn forward_burst<'mempool, const CAP: usize>(
+        &self,
+        port_id: u8,
+        _mempool: &'mempool MemoryPool,
+        events: &mut ArrayVec<Event<&'mempool MemoryPool>, CAP>,
+        queue_id: u8,
+        sched_type: SchedType,
+    ) -> usize {
+        for event in events.iter_mut() {
+            event.forward_to(queue_id, sched_type);
+        }
+        let enqueued =
+            ffi::_rte_event_enqueue_forward_burst(self.dev_id, port_id, events.as_ptr() as _, events.len() as u16)
+                as usize;
+        events.drain(..enqueued).for_each(mem::forget);
+        enqueued
+    }
+}
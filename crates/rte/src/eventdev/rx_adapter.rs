@@ -0,0 +1,113 @@
+use rte_error::ReturnValue as _;
+
+use super::{EventDev, PortConf, SchedType, Service};
+use crate::{ethdev::EthDev, Result};
+
+/// An adapter that receives packets from the receive queues of an ethernet device, and enqueues them to an event
+/// device as new events, whose flow id is the RSS hash of each packet (computed in software if the device doesn't
+/// provide it), so that atomic and ordered queues keep the packets of each flow in order.
+///
+/// Unless the devices have an internal port (see [`Self::caps`]), the adapter is run by a [`Service`].
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__event__eth__rx__adapter_8h.html>
+#[derive(Debug)]
+pub struct EthRxAdapter {
+    id: u8,
+    // the ethernet devices whose queues were added, which must be removed before the adapter is freed
+    ports: Vec<u16>,
+}
+
+impl EthRxAdapter {
+    /// Creates an adapter for the event device `dev`, which enqueues events using its own event port, configured
+    /// with `port_conf` (e.g. [`EventDev::port_default_conf`]).
+    #[inline]
+    pub fn new(id: u8, dev: &EventDev, port_conf: &PortConf) -> Result<Self> {
+        let mut port_conf = *port_conf;
+        unsafe { ffi::rte_event_eth_rx_adapter_create(id, dev.dev_id(), &mut port_conf) }.rte_ok()?;
+        Ok(Self { id, ports: Vec::new() })
+    }
+
+    /// Returns the capabilities of an adapter between `dev` and `eth`, i.e. a set of
+    /// `RTE_EVENT_ETH_RX_ADAPTER_CAP_*` flags.
+    #[inline]
+    pub fn caps(dev: &EventDev, eth: &EthDev) -> Result<u32> {
+        let mut caps = 0;
+        unsafe { ffi::rte_event_eth_rx_adapter_caps_get(dev.dev_id(), eth.port_id(), &mut caps) }.rte_ok()?;
+        Ok(caps)
+    }
+
+    #[inline]
+    pub fn id(&self) -> u8 {
+        self.id
+    }
+
+    /// Enqueues the packets received from the receive queue `rx_queue_id` of `eth` (or from all its receive queues,
+    /// if `None`) to the event queue `queue_id`, where they're scheduled with `sched_type`.
+    #[inline]
+    pub fn add_queue(
+        &mut self,
+        eth: &EthDev,
+        rx_queue_id: Option<u16>,
+        queue_id: u8,
+        sched_type: SchedType,
+    ) -> Result<()> {
+        let mut conf = ffi::rte_event_eth_rx_adapter_queue_conf { servicing_weight: 1, ..Default::default() };
+        unsafe {
+            let fields = &mut conf.ev.__bindgen_anon_1.__bindgen_anon_1;
+            fields.set_sched_type(sched_type as u8);
+            fields.queue_id = queue_id;
+            fields.priority = ffi::RTE_EVENT_DEV_PRIORITY_NORMAL as u8;
+        }
+        let rx_queue_id = rx_queue_id.map(i32::from).unwrap_or(-1);
+        unsafe { ffi::rte_event_eth_rx_adapter_queue_add(self.id, eth.port_id(), rx_queue_id, &conf) }.rte_ok()?;
+        if !self.ports.contains(&eth.port_id()) {
+            self.ports.push(eth.port_id());
+        }
+        Ok(())
+    }
+
+    /// Stops receiving packets from the receive queue `rx_queue_id` of `eth` (or from all its receive queues, if
+    /// `None`).
+    #[inline]
+    pub fn remove_queue(&mut self, eth: &EthDev, rx_queue_id: Option<u16>) -> Result<()> {
+        let rx_queue_id = rx_queue_id.map(i32::from).unwrap_or(-1);
+        unsafe { ffi::rte_event_eth_rx_adapter_queue_del(self.id, eth.port_id(), rx_queue_id) }.rte_ok()?;
+        if rx_queue_id < 0 {
+            self.ports.retain(|&port_id| port_id != eth.port_id());
+        }
+        Ok(())
+    }
+
+    /// Returns the service that runs the adapter, unless the devices have an internal port.
+    #[inline]
+    pub fn service(&self) -> Option<Service> {
+        let mut service_id = 0;
+        (unsafe { ffi::rte_event_eth_rx_adapter_service_id_get(self.id, &mut service_id) } == 0)
+            .then(|| Service(service_id))
+    }
+
+    #[inline]
+    pub fn start(&self) -> Result<()> {
+        unsafe { ffi::rte_event_eth_rx_adapter_start(self.id) }.rte_ok()?;
+        Ok(())
+    }
+
+    #[inline]
+    pub fn stop(&self) -> Result<()> {
+        unsafe { ffi::rte_event_eth_rx_adapter_stop(self.id) }.rte_ok()?;
+        Ok(())
+    }
+}
+
+impl Drop for EthRxAdapter {
+    fn drop(&mut self) {
+        // the adapter can only be freed once it's stopped, and once all its queues are removed
+        unsafe {
+            ffi::rte_event_eth_rx_adapter_stop(self.id);
+            for &port_id in &self.ports {
+                ffi::rte_event_eth_rx_adapter_queue_del(self.id, port_id, -1);
+            }
+            ffi::rte_event_eth_rx_adapter_free(self.id);
+        }
+    }
+}
@@ -88,6 +88,187 @@ bitflags! {
     }
 }
 
+bitflags! {
+    /// RX offload flags, set by the driver in the `ol_flags` field of received mbufs.
+    ///
+    /// Some of the flags are only meaningful in combination with each other (e.g. [`Self::IP_CKSUM_MASK`]),
+    /// see [`ChecksumStatus`](crate::mbuf::ChecksumStatus) and the getters of [`MetadataExt`](crate::mbuf::MetadataExt).
+    pub struct PktRxOffload: u64 {
+        const VLAN                  = ffi::_RTE_MBUF_F_RX_VLAN;
+        const RSS_HASH              = ffi::_RTE_MBUF_F_RX_RSS_HASH;
+        const FDIR                  = ffi::_RTE_MBUF_F_RX_FDIR;
+        const L4_CKSUM_BAD          = ffi::_RTE_MBUF_F_RX_L4_CKSUM_BAD;
+        const IP_CKSUM_BAD          = ffi::_RTE_MBUF_F_RX_IP_CKSUM_BAD;
+        const OUTER_IP_CKSUM_BAD    = ffi::_RTE_MBUF_F_RX_OUTER_IP_CKSUM_BAD;
+        const VLAN_STRIPPED         = ffi::_RTE_MBUF_F_RX_VLAN_STRIPPED;
+        const IP_CKSUM_GOOD         = ffi::_RTE_MBUF_F_RX_IP_CKSUM_GOOD;
+        const L4_CKSUM_GOOD         = ffi::_RTE_MBUF_F_RX_L4_CKSUM_GOOD;
+        const IEEE1588_PTP          = ffi::_RTE_MBUF_F_RX_IEEE1588_PTP;
+        const IEEE1588_TMST         = ffi::_RTE_MBUF_F_RX_IEEE1588_TMST;
+        const FDIR_ID               = ffi::_RTE_MBUF_F_RX_FDIR_ID;
+        const FDIR_FLX              = ffi::_RTE_MBUF_F_RX_FDIR_FLX;
+        const QINQ_STRIPPED         = ffi::_RTE_MBUF_F_RX_QINQ_STRIPPED;
+        const LRO                   = ffi::_RTE_MBUF_F_RX_LRO;
+        const SEC_OFFLOAD           = ffi::_RTE_MBUF_F_RX_SEC_OFFLOAD;
+        const SEC_OFFLOAD_FAILED    = ffi::_RTE_MBUF_F_RX_SEC_OFFLOAD_FAILED;
+        const QINQ                  = ffi::_RTE_MBUF_F_RX_QINQ;
+        const OUTER_L4_CKSUM_BAD    = ffi::_RTE_MBUF_F_RX_OUTER_L4_CKSUM_BAD;
+        const OUTER_L4_CKSUM_GOOD   = ffi::_RTE_MBUF_F_RX_OUTER_L4_CKSUM_GOOD;
+
+        const IP_CKSUM_MASK         = Self::IP_CKSUM_BAD.bits | Self::IP_CKSUM_GOOD.bits;
+        const L4_CKSUM_MASK         = Self::L4_CKSUM_BAD.bits | Self::L4_CKSUM_GOOD.bits;
+        const OUTER_L4_CKSUM_MASK   = Self::OUTER_L4_CKSUM_BAD.bits | Self::OUTER_L4_CKSUM_GOOD.bits;
+    }
+}
+
+bitflags! {
+    /// The packet type of a received mbuf, as recognized by the NIC (see also: [`MetadataExt::packet_type`]).
+    ///
+    /// An empty packet type means the type of the packet is unknown (`RTE_PTYPE_UNKNOWN`).
+    ///
+    /// A packet type consists of several layers (L2, L3, L4, tunnel and inner L2, L3 and L4), each of which is a 4-bit
+    /// value rather than a set of independent flags. Thus, a layer should be compared for *equality* after extracting it
+    /// using the corresponding getter (e.g. [`Self::l4`]), rather than using [`Self::contains`]:
+    /// ```rust
+    /// # use rte::flags::PacketType;
+    /// let ptype = PacketType::L2_ETHER | PacketType::L3_IPV4_EXT_UNKNOWN | PacketType::L4_UDP;
+    /// assert_eq!(ptype.l4(), PacketType::L4_UDP);
+    /// assert!(ptype.is_ipv4());
+    /// ```
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__mbuf__ptype_8h.html>
+    ///
+    /// [`MetadataExt::packet_type`]: crate::mbuf::MetadataExt::packet_type
+    #[derive(Default)]
+    pub struct PacketType: u32 {
+        const L2_ETHER                      = ffi::RTE_PTYPE_L2_ETHER;
+        const L2_ETHER_TIMESYNC             = ffi::RTE_PTYPE_L2_ETHER_TIMESYNC;
+        const L2_ETHER_ARP                  = ffi::RTE_PTYPE_L2_ETHER_ARP;
+        const L2_ETHER_LLDP                 = ffi::RTE_PTYPE_L2_ETHER_LLDP;
+        const L2_ETHER_NSH                  = ffi::RTE_PTYPE_L2_ETHER_NSH;
+        const L2_ETHER_VLAN                 = ffi::RTE_PTYPE_L2_ETHER_VLAN;
+        const L2_ETHER_QINQ                 = ffi::RTE_PTYPE_L2_ETHER_QINQ;
+        const L2_ETHER_PPPOE                = ffi::RTE_PTYPE_L2_ETHER_PPPOE;
+        const L2_ETHER_FCOE                 = ffi::RTE_PTYPE_L2_ETHER_FCOE;
+        const L2_ETHER_MPLS                 = ffi::RTE_PTYPE_L2_ETHER_MPLS;
+        const L2_MASK                       = ffi::RTE_PTYPE_L2_MASK;
+
+        const L3_IPV4                       = ffi::RTE_PTYPE_L3_IPV4;
+        const L3_IPV4_EXT                   = ffi::RTE_PTYPE_L3_IPV4_EXT;
+        const L3_IPV6                       = ffi::RTE_PTYPE_L3_IPV6;
+        const L3_IPV4_EXT_UNKNOWN           = ffi::RTE_PTYPE_L3_IPV4_EXT_UNKNOWN;
+        const L3_IPV6_EXT                   = ffi::RTE_PTYPE_L3_IPV6_EXT;
+        const L3_IPV6_EXT_UNKNOWN           = ffi::RTE_PTYPE_L3_IPV6_EXT_UNKNOWN;
+        const L3_MASK                       = ffi::RTE_PTYPE_L3_MASK;
+
+        const L4_TCP                        = ffi::RTE_PTYPE_L4_TCP;
+        const L4_UDP                        = ffi::RTE_PTYPE_L4_UDP;
+        const L4_FRAG                       = ffi::RTE_PTYPE_L4_FRAG;
+        const L4_SCTP                       = ffi::RTE_PTYPE_L4_SCTP;
+        const L4_ICMP                       = ffi::RTE_PTYPE_L4_ICMP;
+        const L4_NONFRAG                    = ffi::RTE_PTYPE_L4_NONFRAG;
+        const L4_IGMP                       = ffi::RTE_PTYPE_L4_IGMP;
+        const L4_MASK                       = ffi::RTE_PTYPE_L4_MASK;
+
+        const TUNNEL_IP                     = ffi::RTE_PTYPE_TUNNEL_IP;
+        const TUNNEL_GRE                    = ffi::RTE_PTYPE_TUNNEL_GRE;
+        const TUNNEL_VXLAN                  = ffi::RTE_PTYPE_TUNNEL_VXLAN;
+        const TUNNEL_NVGRE                  = ffi::RTE_PTYPE_TUNNEL_NVGRE;
+        const TUNNEL_GENEVE                 = ffi::RTE_PTYPE_TUNNEL_GENEVE;
+        const TUNNEL_GRENAT                 = ffi::RTE_PTYPE_TUNNEL_GRENAT;
+        const TUNNEL_GTPC                   = ffi::RTE_PTYPE_TUNNEL_GTPC;
+        const TUNNEL_GTPU                   = ffi::RTE_PTYPE_TUNNEL_GTPU;
+        const TUNNEL_ESP                    = ffi::RTE_PTYPE_TUNNEL_ESP;
+        const TUNNEL_L2TP                   = ffi::RTE_PTYPE_TUNNEL_L2TP;
+        const TUNNEL_VXLAN_GPE              = ffi::RTE_PTYPE_TUNNEL_VXLAN_GPE;
+        const TUNNEL_MPLS_IN_GRE            = ffi::RTE_PTYPE_TUNNEL_MPLS_IN_GRE;
+        const TUNNEL_MPLS_IN_UDP            = ffi::RTE_PTYPE_TUNNEL_MPLS_IN_UDP;
+        const TUNNEL_MASK                   = ffi::RTE_PTYPE_TUNNEL_MASK;
+
+        const INNER_L2_ETHER                = ffi::RTE_PTYPE_INNER_L2_ETHER;
+        const INNER_L2_ETHER_VLAN           = ffi::RTE_PTYPE_INNER_L2_ETHER_VLAN;
+        const INNER_L2_ETHER_QINQ           = ffi::RTE_PTYPE_INNER_L2_ETHER_QINQ;
+        const INNER_L2_MASK                 = ffi::RTE_PTYPE_INNER_L2_MASK;
+
+        const INNER_L3_IPV4                 = ffi::RTE_PTYPE_INNER_L3_IPV4;
+        const INNER_L3_IPV4_EXT             = ffi::RTE_PTYPE_INNER_L3_IPV4_EXT;
+        const INNER_L3_IPV6                 = ffi::RTE_PTYPE_INNER_L3_IPV6;
+        const INNER_L3_IPV4_EXT_UNKNOWN     = ffi::RTE_PTYPE_INNER_L3_IPV4_EXT_UNKNOWN;
+        const INNER_L3_IPV6_EXT             = ffi::RTE_PTYPE_INNER_L3_IPV6_EXT;
+        const INNER_L3_IPV6_EXT_UNKNOWN     = ffi::RTE_PTYPE_INNER_L3_IPV6_EXT_UNKNOWN;
+        const INNER_L3_MASK                 = ffi::RTE_PTYPE_INNER_L3_MASK;
+
+        const INNER_L4_TCP                  = ffi::RTE_PTYPE_INNER_L4_TCP;
+        const INNER_L4_UDP                  = ffi::RTE_PTYPE_INNER_L4_UDP;
+        const INNER_L4_FRAG                 = ffi::RTE_PTYPE_INNER_L4_FRAG;
+        const INNER_L4_SCTP                 = ffi::RTE_PTYPE_INNER_L4_SCTP;
+        const INNER_L4_ICMP                 = ffi::RTE_PTYPE_INNER_L4_ICMP;
+        const INNER_L4_NONFRAG              = ffi::RTE_PTYPE_INNER_L4_NONFRAG;
+        const INNER_L4_MASK                 = ffi::RTE_PTYPE_INNER_L4_MASK;
+    }
+}
+
+impl PacketType {
+    #[inline]
+    pub fn l2(self) -> Self {
+        self & Self::L2_MASK
+    }
+
+    #[inline]
+    pub fn l3(self) -> Self {
+        self & Self::L3_MASK
+    }
+
+    #[inline]
+    pub fn l4(self) -> Self {
+        self & Self::L4_MASK
+    }
+
+    #[inline]
+    pub fn tunnel(self) -> Self {
+        self & Self::TUNNEL_MASK
+    }
+
+    #[inline]
+    pub fn inner_l2(self) -> Self {
+        self & Self::INNER_L2_MASK
+    }
+
+    #[inline]
+    pub fn inner_l3(self) -> Self {
+        self & Self::INNER_L3_MASK
+    }
+
+    #[inline]
+    pub fn inner_l4(self) -> Self {
+        self & Self::INNER_L4_MASK
+    }
+
+    /// Returns `true` if the (outer) L3 header is an IPv4 header, with or without options.
+    ///
+    /// Equivalent to `RTE_ETH_IS_IPV4_HDR`.
+    #[inline]
+    pub fn is_ipv4(self) -> bool {
+        self.intersects(Self::L3_IPV4)
+    }
+
+    /// Returns `true` if the (outer) L3 header is an IPv6 header, with or without extension headers.
+    ///
+    /// Equivalent to `RTE_ETH_IS_IPV6_HDR`.
+    #[inline]
+    pub fn is_ipv6(self) -> bool {
+        self.intersects(Self::L3_IPV6)
+    }
+
+    /// Returns `true` if the packet is encapsulated in a tunnel recognized by the NIC.
+    ///
+    /// Equivalent to `RTE_ETH_IS_TUNNEL_PKT`.
+    #[inline]
+    pub fn is_tunnel(self) -> bool {
+        !self.tunnel().is_empty()
+    }
+}
+
 bitflags! {
     #[derive(Default)]
     pub struct EthRss: u64 {
@@ -125,6 +306,16 @@ bitflags! {
     }
 }
 
+bitflags! {
+    /// The types of packets merged by software GRO, see [`crate::gro`].
+    pub struct GroTypes: u64 {
+        const TCP_IPV4              = ffi::_RTE_GRO_TCP_IPV4;
+        const IPV4_VXLAN_TCP_IPV4   = ffi::_RTE_GRO_IPV4_VXLAN_TCP_IPV4;
+        const UDP_IPV4              = ffi::_RTE_GRO_UDP_IPV4;
+        const IPV4_VXLAN_UDP_IPV4   = ffi::_RTE_GRO_IPV4_VXLAN_UDP_IPV4;
+    }
+}
+
 bitflags! {
     /// Device supported speeds bitmap flags
     pub struct EthLinkSpeed: u32 {
@@ -0,0 +1,281 @@
+//! Generic receive offload (GRO) in software, based on DPDK's
+//! [GRO Library](https://doc.dpdk.org/guides-21.08/prog_guide/generic_receive_offload_lib.html), for devices that
+//! don't support `RTE_ETH_RX_OFFLOAD_TCP_LRO`: consecutive packets of the same TCP (or UDP fragmented) flow are merged
+//! into a single (segmented) packet right after they're received, so that the rest of the pipeline processes fewer,
+//! larger packets. See also [`crate::gso`], which does the opposite before packets are transmitted.
+//!
+//! GRO relies on the packet type and on the `l2_len`, `l3_len` and `l4_len` fields of each packet (see
+//! [`MetadataExt`](crate::mbuf::MetadataExt)), which must have been set by the NIC or by the application.
+//!
+//! Packets can either be merged within each burst, see [`reassemble_burst`], or across bursts, by keeping them in a
+//! [`GroContext`] until they're flushed.
+
+use std::{marker::PhantomData, mem::MaybeUninit, os::raw::c_void, ptr::NonNull, slice, time::Duration};
+
+use arrayvec::ArrayVec;
+use rte_error::Error;
+
+use crate::{
+    cycles,
+    flags::GroTypes,
+    lcore,
+    mbuf::{Allocator, MBuf},
+    memory::SocketId,
+    Result,
+};
+
+/// The largest number of packets (i.e. `max_flows * max_items_per_flow`) that can be merged by [`reassemble_burst`].
+pub const MAX_BURST_ITEMS: usize = ffi::RTE_GRO_MAX_BURST_ITEM_NUM as usize;
+
+/// The types of packets that are merged, and the size of the tables used to merge them.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct GroConfig {
+    pub types: GroTypes,
+    /// The largest number of flows whose packets are merged at the same time.
+    pub max_flows: u16,
+    /// The largest number of packets of each flow that are kept while waiting to be merged.
+    pub max_items_per_flow: u16,
+}
+
+impl Default for GroConfig {
+    fn default() -> Self {
+        Self { types: GroTypes::TCP_IPV4, max_flows: 4, max_items_per_flow: 32 }
+    }
+}
+
+impl GroConfig {
+    #[inline]
+    fn to_param(self, socket_id: u16) -> ffi::rte_gro_param {
+        ffi::rte_gro_param {
+            gro_types: self.types.bits(),
+            max_flow_num: self.max_flows,
+            max_item_per_flow: self.max_items_per_flow,
+            socket_id,
+        }
+    }
+}
+
+/// Merges the packets of a burst in place, e.g. right after [`EthDev::rx_burst`](crate::ethdev::EthDev::rx_burst):
+/// the packets merged into another one (as its segments) are removed from `pkts`, and the others are kept in order.
+///
+/// Merging is limited to [`MAX_BURST_ITEMS`] packets per burst, packets beyond that are left untouched.
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__gro_8h.html>
+#[inline]
+pub fn reassemble_burst<A, const CAP: usize>(pkts: &mut ArrayVec<MBuf<A>, CAP>, config: &GroConfig)
+where
+    A: Allocator,
+{
+    let param = config.to_param(0);
+    unsafe {
+        // `MBuf` is a transparent wrapper around `NonNull<rte_mbuf>`, see also `EthDev::rx_burst`
+        let remaining = ffi::rte_gro_reassemble_burst(pkts.as_mut_ptr() as _, pkts.len() as u16, &param);
+        pkts.set_len(remaining.into());
+    }
+}
+
+/// Merges packets across bursts, by keeping them in tables until they've been held for longer than the flush timeout,
+/// which bounds the latency added by GRO.
+///
+/// A context isn't thread-safe (and packets shouldn't be moved between lcores anyway), so each lcore that receives
+/// packets creates its own context, e.g. when its worker starts.
+pub struct GroContext<A>
+where
+    A: Allocator,
+{
+    ctx: NonNull<c_void>,
+    types: GroTypes,
+    flush_timeout: u64,
+    // the context owns the packets kept in its tables
+    _marker: PhantomData<MBuf<A>>,
+}
+
+impl<A> GroContext<A>
+where
+    A: Allocator,
+{
+    /// Creates a context on the given socket (or on the socket of the current lcore, if `None`), which keeps packets
+    /// for up to `flush_timeout`, see [`Self::process`].
+    ///
+    /// Fails with `EINVAL` if `config` has no packet types or empty tables.
+    pub fn new(config: &GroConfig, flush_timeout: Duration, socket_id: Option<SocketId>) -> Result<Self> {
+        if config.types.is_empty() || config.max_flows == 0 || config.max_items_per_flow == 0 {
+            return Err(Error(libc::EINVAL));
+        }
+
+        // unlike most of DPDK, the GRO library doesn't accept SOCKET_ID_ANY
+        let socket_id = socket_id.or_else(lcore::socket_id).map(|id| id.get()).unwrap_or(0);
+        let param = config.to_param(socket_id as u16);
+        let ctx = NonNull::new(unsafe { ffi::rte_gro_ctx_create(&param) }).ok_or(Error(libc::ENOMEM))?;
+        Ok(Self {
+            ctx,
+            types: config.types,
+            flush_timeout: cycles::duration_to_cycles(flush_timeout),
+            _marker: PhantomData,
+        })
+    }
+
+    /// Returns the number of packets kept in the context's tables.
+    #[inline]
+    pub fn len(&self) -> usize {
+        unsafe { ffi::rte_gro_get_pkt_count(self.ctx.as_ptr()) as usize }
+    }
+
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Moves the packets of `pkts` that can be merged into the context's tables (merging them with the packets already
+    /// kept there), leaving the other packets in `pkts` in order.
+    #[inline]
+    pub fn reassemble<const CAP: usize>(&mut self, pkts: &mut ArrayVec<MBuf<A>, CAP>) {
+        unsafe {
+            let remaining = ffi::rte_gro_reassemble(pkts.as_mut_ptr() as _, pkts.len() as u16, self.ctx.as_ptr());
+            pkts.set_len(remaining.into());
+        }
+    }
+
+    /// Appends the packets that have been kept for longer than `timeout` to `pkts` (up to its remaining capacity),
+    /// and returns their number.
+    #[inline]
+    pub fn flush<const CAP: usize>(&mut self, timeout: Duration, pkts: &mut ArrayVec<MBuf<A>, CAP>) -> usize {
+        self.flush_cycles(cycles::duration_to_cycles(timeout), pkts)
+    }
+
+    fn flush_cycles<const CAP: usize>(&mut self, timeout_cycles: u64, pkts: &mut ArrayVec<MBuf<A>, CAP>) -> usize {
+        let old_len = pkts.len();
+        unsafe {
+            let spare_cap = slice::from_raw_parts_mut(
+                pkts.as_mut_ptr().add(old_len) as *mut MaybeUninit<MBuf<A>>,
+                pkts.remaining_capacity(),
+            );
+            let flushed = ffi::rte_gro_timeout_flush(
+                self.ctx.as_ptr(),
+                timeout_cycles,
+                self.types.bits(),
+                spare_cap.as_mut_ptr() as _,
+                spare_cap.len() as u16,
+            ) as usize;
+            pkts.set_len(old_len + flushed);
+            flushed
+        }
+    }
+
+    /// The GRO stage of a receive loop: merges the packets of a burst with those kept from previous bursts (see
+    /// [`Self::reassemble`]), then appends the packets that have been kept for longer than the flush timeout to `pkts`.
+    ///
+    /// Should be called for every burst, even empty ones, so that kept packets are flushed in time.
+    #[inline]
+    pub fn process<const CAP: usize>(&mut self, pkts: &mut ArrayVec<MBuf<A>, CAP>) {
+        if !pkts.is_empty() {
+            self.reassemble(pkts);
+        }
+        if !self.is_empty() {
+            self.flush_cycles(self.flush_timeout, pkts);
+        }
+    }
+}
+
+impl<A> Drop for GroContext<A>
+where
+    A: Allocator,
+{
+    fn drop(&mut self) {
+        // destroying the context doesn't free the packets kept in its tables
+        let mut pkts = ArrayVec::<MBuf<A>, 32>::new();
+        while self.flush_cycles(0, &mut pkts) > 0 {
+            pkts.clear();
+        }
+        unsafe { ffi::rte_gro_ctx_destroy(self.ctx.as_ptr()) };
+    }
+}
+
+#[cfg(test)]
+pub(crate) mod tests {
+    use rte_test_macros::rte_test;
+
+    use super::*;
+    use crate::{flags::PacketType, mbuf::MetadataExt, mempool::MemoryPool};
+
+    /// Returns a TCP/IPv4 packet of the given flow, with its metadata set as GRO requires.
+    pub(crate) fn tcp_packet<'a>(
+        mempool: &'a MemoryPool,
+        src_port: u16,
+        seq: u32,
+        payload: &[u8],
+    ) -> MBuf<&'a MemoryPool> {
+        let mut data = vec![0; 14 + 20 + 20];
+        data[12..14].copy_from_slice(&0x0800u16.to_be_bytes());
+
+        let ip = &mut data[14..34];
+        ip[0] = 0x45;
+        ip[2..4].copy_from_slice(&((20 + 20 + payload.len()) as u16).to_be_bytes());
+        // don't fragment, so that the IP ids don't have to be consecutive
+        ip[6] = 0x40;
+        ip[8] = 64;
+        ip[9] = libc::IPPROTO_TCP as u8;
+        ip[12..16].copy_from_slice(&[10, 0, 0, 1]);
+        ip[16..20].copy_from_slice(&[10, 0, 0, 2]);
+
+        let tcp = &mut data[34..54];
+        tcp[0..2].copy_from_slice(&src_port.to_be_bytes());
+        tcp[2..4].copy_from_slice(&80u16.to_be_bytes());
+        tcp[4..8].copy_from_slice(&seq.to_be_bytes());
+        tcp[12] = 5 << 4;
+        // ACK
+        tcp[13] = 0x10;
+        tcp[14..16].copy_from_slice(&u16::MAX.to_be_bytes());
+
+        data.extend_from_slice(payload);
+        let mut pkt = MBuf::new_with_provider_and_data(&mempool, data);
+        pkt.set_packet_type(PacketType::L2_ETHER | PacketType::L3_IPV4 | PacketType::L4_TCP);
+        pkt.set_l2_len(14);
+        pkt.set_l3_len(20);
+        pkt.set_l4_len(20);
+        pkt
+    }
+
+    fn payload(pkt: &MBuf<&MemoryPool>) -> Vec<u8> {
+        pkt.segments().flatten().copied().skip(54).collect()
+    }
+
+    #[rte_test(mock_lcore)]
+    fn merge_tcp_segments() {
+        let mempool = MemoryPool::new("gro_test_pool", 64, 0, 0, ffi::RTE_MBUF_DEFAULT_BUF_SIZE as u16, None).unwrap();
+        let config = GroConfig::default();
+
+        let mut pkts = ArrayVec::<_, 8>::new();
+        pkts.push(tcp_packet(&mempool, 1000, 1, b"abc"));
+        pkts.push(tcp_packet(&mempool, 2000, 1, b"xyz"));
+        pkts.push(tcp_packet(&mempool, 1000, 4, b"def"));
+        reassemble_burst(&mut pkts, &config);
+        assert_eq!(pkts.len(), 2);
+        assert_eq!((pkts[0].nb_segs(), pkts[0].pkt_len()), (2, 54 + 6));
+        assert_eq!(payload(&pkts[0]), b"abcdef");
+        assert_eq!(payload(&pkts[1]), b"xyz");
+
+        // packets of successive bursts are kept until they're flushed
+        let mut ctx = GroContext::new(&config, Duration::from_secs(3600), None).unwrap();
+        pkts.clear();
+        pkts.push(tcp_packet(&mempool, 1000, 1, b"abc"));
+        ctx.process(&mut pkts);
+        assert!(pkts.is_empty());
+        pkts.push(tcp_packet(&mempool, 1000, 4, b"def"));
+        ctx.process(&mut pkts);
+        assert!(pkts.is_empty());
+        assert_eq!(ctx.len(), 1);
+
+        assert_eq!(ctx.flush(Duration::ZERO, &mut pkts), 1);
+        assert_eq!(payload(&pkts[0]), b"abcdef");
+        assert!(ctx.is_empty());
+
+        // packets still kept when the context is dropped are freed
+        pkts.clear();
+        pkts.push(tcp_packet(&mempool, 1000, 7, b"ghi"));
+        ctx.reassemble(&mut pkts);
+        assert_eq!(ctx.len(), 1);
+        drop((pkts, ctx));
+        assert_eq!(mempool.get_in_use_count(), 0);
+    }
+}
@@ -0,0 +1,208 @@
+//! Generic segmentation offload (GSO) in software, based on DPDK's
+//! [GSO Library](https://doc.dpdk.org/guides-21.08/prog_guide/generic_segmentation_offload_lib.html), for devices that
+//! don't support TSO: packets larger than the MTU (e.g. merged by [GRO](crate::gro)) are split into MTU-sized segments
+//! right before they're transmitted, see [`GsoContext::segment_burst`].
+//!
+//! Packets are only segmented if they request it, with the [`PktTxOffload::TCP_SEG`] or [`PktTxOffload::UDP_SEG`] flag
+//! (along with [`PktTxOffload::IPV4`]), and they must have their `l2_len`, `l3_len` and `l4_len` fields set, see
+//! [`MetadataExt`](crate::mbuf::MetadataExt). Each segment shares the payload of the original packet (using indirect
+//! mbufs), and only its headers are copied.
+//!
+//! The checksums of the segments aren't computed, so checksum offloads (e.g. [`PktTxOffload::IP_CKSUM`] and
+//! [`PktTxOffload::TCP_CKSUM`]) should be requested on the original packet, whose flags are copied to its segments.
+//!
+//! [`PktTxOffload::TCP_SEG`]: crate::flags::PktTxOffload::TCP_SEG
+//! [`PktTxOffload::UDP_SEG`]: crate::flags::PktTxOffload::UDP_SEG
+//! [`PktTxOffload::IPV4`]: crate::flags::PktTxOffload::IPV4
+//! [`PktTxOffload::IP_CKSUM`]: crate::flags::PktTxOffload::IP_CKSUM
+//! [`PktTxOffload::TCP_CKSUM`]: crate::flags::PktTxOffload::TCP_CKSUM
+
+use std::{marker::PhantomData, mem::MaybeUninit, slice};
+
+use arrayvec::ArrayVec;
+use rte_error::Error;
+
+use crate::{flags::DevTxOffload, mbuf::MBuf, mempool::MemoryPool, Result};
+
+/// The types of packets that can be segmented, see [`GsoContext::new`].
+pub const SUPPORTED_TYPES: DevTxOffload = DevTxOffload::from_bits_truncate(
+    DevTxOffload::TCP_TSO.bits()
+        | DevTxOffload::UDP_TSO.bits()
+        | DevTxOffload::VXLAN_TNL_TSO.bits()
+        | DevTxOffload::GRE_TNL_TSO.bits(),
+);
+
+/// The configuration of GSO: the types of packets that are segmented, the size of the segments, and the memory pools
+/// the segments are allocated from.
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__gso_8h.html>
+pub struct GsoContext<'mempool> {
+    ctx: ffi::rte_gso_ctx,
+    _marker: PhantomData<&'mempool MemoryPool>,
+}
+
+// # Safety
+// The context is never modified, and memory pools are thread-safe
+unsafe impl Send for GsoContext<'_> {}
+unsafe impl Sync for GsoContext<'_> {}
+
+impl<'mempool> GsoContext<'mempool> {
+    /// Creates a context that segments the given `types` of packets (a subset of [`SUPPORTED_TYPES`]) into segments of
+    /// up to `segment_size` bytes (including their headers, e.g. the MTU plus the size of the Ethernet header).
+    ///
+    /// The headers of the segments are allocated from `direct_pool`, and the (indirect) mbufs referring to the payload
+    /// of the original packet from `indirect_pool`, which doesn't need any data room.
+    ///
+    /// By default, the IP ids of the segments of a packet are incremented, see [`Self::with_fixed_ip_id`].
+    ///
+    /// Fails with `EINVAL` if `types` isn't a non-empty subset of [`SUPPORTED_TYPES`], or if `segment_size` is zero.
+    pub fn new(
+        direct_pool: &'mempool MemoryPool,
+        indirect_pool: &'mempool MemoryPool,
+        types: DevTxOffload,
+        segment_size: u16,
+    ) -> Result<Self> {
+        if types.is_empty() || !SUPPORTED_TYPES.contains(types) || segment_size == 0 {
+            return Err(Error(libc::EINVAL));
+        }
+
+        let ctx = ffi::rte_gso_ctx {
+            direct_pool: direct_pool.0.as_ptr(),
+            indirect_pool: indirect_pool.0.as_ptr(),
+            flag: 0,
+            gso_types: types.bits() as u32,
+            gso_size: segment_size,
+        };
+        Ok(Self { ctx, _marker: PhantomData })
+    }
+
+    /// Gives all the segments of a packet the same IP id as the original packet, instead of incrementing it.
+    #[inline]
+    pub fn with_fixed_ip_id(mut self) -> Self {
+        self.ctx.flag |= ffi::RTE_GSO_FLAG_IPID_FIXED as u64;
+        self
+    }
+
+    #[inline]
+    pub fn segment_size(&self) -> u16 {
+        self.ctx.gso_size
+    }
+
+    /// Appends the segments of `pkt` to `out`, or `pkt` itself if it doesn't need to be segmented
+    /// (i.e. if it doesn't request segmentation, or if it's already small enough).
+    ///
+    /// Fails if the segments don't fit in the remaining capacity of `out`, or if the memory pools are exhausted,
+    /// in which case `pkt` is returned unchanged.
+    #[inline]
+    pub fn segment<const CAP: usize>(
+        &self,
+        pkt: MBuf<&'mempool MemoryPool>,
+        out: &mut ArrayVec<MBuf<&'mempool MemoryPool>, CAP>,
+    ) -> Result<(), MBuf<&'mempool MemoryPool>> {
+        if out.is_full() {
+            return Err(pkt);
+        }
+
+        let old_len = out.len();
+        let nb_segments = unsafe {
+            // `MBuf` is a transparent wrapper around `NonNull<rte_mbuf>`, see also `EthDev::rx_burst`
+            let spare_cap = slice::from_raw_parts_mut(
+                out.as_mut_ptr().add(old_len) as *mut MaybeUninit<MBuf<&MemoryPool>>,
+                out.remaining_capacity(),
+            );
+            ffi::rte_gso_segment(pkt.as_raw(), &self.ctx, spare_cap.as_mut_ptr() as _, spare_cap.len() as u16)
+        };
+
+        match nb_segments {
+            0 => out.push(pkt),
+            // the segments hold references to the payload of `pkt`, which is freed (i.e. dereferenced) here
+            n if n > 0 => unsafe { out.set_len(old_len + n as usize) },
+            _ => return Err(pkt),
+        }
+        Ok(())
+    }
+
+    /// The GSO stage of a transmit loop, e.g. right before [`EthDev::tx_burst`](crate::ethdev::EthDev::tx_burst):
+    /// moves the packets at the front of `pkts` to `out`, segmenting them if needed (see [`Self::segment`]),
+    /// until the segments of a packet don't fit in `out`, in which case that packet and the following ones are left
+    /// in `pkts`, e.g. to be segmented once `out` has been transmitted.
+    ///
+    /// Packets that can't be segmented at all (even when `out` is empty) are dropped, and their number is returned.
+    ///
+    /// `out` must be able to hold at least one segment, i.e. `CAP_OUT` must not be 0 (which fails to compile),
+    /// since every packet would be dropped otherwise.
+    pub fn segment_burst<const CAP_IN: usize, const CAP_OUT: usize>(
+        &self,
+        pkts: &mut ArrayVec<MBuf<&'mempool MemoryPool>, CAP_IN>,
+        out: &mut ArrayVec<MBuf<&'mempool MemoryPool>, CAP_OUT>,
+    ) -> usize {
+        let () = NonZeroCapacity::<CAP_OUT>::ASSERT;
+
+        let mut dropped = 0;
+        let mut remaining = ArrayVec::new();
+        {
+            let mut pkts = pkts.drain(..);
+            while let Some(pkt) = pkts.next() {
+                match self.segment(pkt, out) {
+                    Ok(()) => {}
+                    Err(_) if out.is_empty() => dropped += 1,
+                    Err(pkt) => {
+                        remaining.push(pkt);
+                        remaining.extend(pkts.by_ref());
+                        break;
+                    }
+                }
+            }
+        }
+        *pkts = remaining;
+        dropped
+    }
+}
+
+/// Rejects zero capacities at compile time, when `ASSERT` is evaluated (i.e. when a function using it is instantiated).
+struct NonZeroCapacity<const CAP: usize>;
+
+impl<const CAP: usize> NonZeroCapacity<CAP> {
+    const ASSERT: () = assert!(CAP > 0, "the output of segment_burst must be able to hold at least one segment");
+}
+
+#[cfg(test)]
+mod tests {
+    use rte_test_macros::rte_test;
+
+    use super::*;
+    use crate::{flags::PktTxOffload, gro::tests::tcp_packet, mbuf::MetadataExt};
+
+    #[rte_test(mock_lcore)]
+    fn segment_tcp_packet() {
+        let direct = MemoryPool::new("gso_test_direct", 64, 0, 0, ffi::RTE_MBUF_DEFAULT_BUF_SIZE as u16, None).unwrap();
+        let indirect = MemoryPool::new("gso_test_indirect", 64, 0, 0, 0, None).unwrap();
+        let ctx = GsoContext::new(&direct, &indirect, DevTxOffload::TCP_TSO, 54 + 400).unwrap();
+        assert!(GsoContext::new(&direct, &indirect, DevTxOffload::VLAN_INSERT, 1514).is_err());
+
+        let payload = (0..1000).map(|i| i as u8).collect::<Vec<_>>();
+        let mut pkts = ArrayVec::<_, 4>::new();
+        let mut pkt = tcp_packet(&direct, 1000, 1, &payload);
+        pkt.enable_ol_flags(PktTxOffload::TCP_SEG | PktTxOffload::IPV4);
+        pkts.push(pkt);
+        // small enough to be transmitted as is
+        pkts.push(tcp_packet(&direct, 1000, 1001, b"abc"));
+
+        // the second packet doesn't fit
+        let mut out = ArrayVec::<_, 3>::new();
+        assert_eq!(ctx.segment_burst(&mut pkts, &mut out), 0);
+        assert_eq!((out.len(), pkts.len()), (3, 1));
+
+        let segments = out.iter().map(|seg| seg.segments().flatten().copied().collect::<Vec<_>>()).collect::<Vec<_>>();
+        for (i, seg) in segments.iter().enumerate() {
+            assert_eq!(u16::from_be_bytes([seg[16], seg[17]]) as usize, seg.len() - 14);
+            assert_eq!(u32::from_be_bytes(seg[38..42].try_into().unwrap()), 1 + 400 * i as u32);
+        }
+        assert!(segments.iter().flat_map(|seg| &seg[54..]).eq(&payload));
+
+        out.clear();
+        assert_eq!(ctx.segment_burst(&mut pkts, &mut out), 0);
+        assert!(pkts.is_empty());
+        assert_eq!(&out[0][54..], b"abc");
+    }
+}
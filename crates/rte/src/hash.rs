@@ -0,0 +1,453 @@
+//! Hash tables shared between lcores, based on DPDK's [Hash Library](https://doc.dpdk.org/guides-21.08/prog_guide/hash_lib.html).
+//!
+//! A [`HashTable`] is created along with a [`HashWriter`] and a [`HashReader`] handle. The table is created with
+//! `RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF`, so any number of lcores can look keys up (using clones of the reader)
+//! without taking any locks, while a single writer (e.g. the control plane) adds and removes keys concurrently.
+//!
+//! Lookups are meant to be done a whole burst at a time, see [`HashReader::lookup_bulk`], and can skip hashing the keys
+//! by using precomputed signatures, e.g. the NIC's RSS hash (see [`HashReader::lookup_burst_by_rss`]).
+
+use std::{
+    ffi::CString,
+    fmt,
+    marker::PhantomData,
+    mem::{self, MaybeUninit},
+    os::raw::c_void,
+    ptr::{self, NonNull},
+    sync::Arc,
+};
+
+use rte_error::ReturnValue as _;
+
+use crate::{
+    mbuf::{Allocator, MBuf, MetadataExt},
+    memory::SocketId,
+    Result,
+};
+
+/// The maximum number of keys looked up by a single call to `rte_hash_lookup_bulk_data`,
+/// larger bulks are looked up in chunks of this size.
+pub const LOOKUP_BULK_MAX: usize = ffi::RTE_HASH_LOOKUP_BULK_MAX as usize;
+
+/// A type that can be used as the key of a [`HashTable`].
+///
+/// # Safety
+/// The key's bytes are hashed and compared as they are, so the type must not have any padding bytes
+/// (i.e. it should be `#[repr(C)]` with explicit padding fields, which are always zeroed), nor any pointers.
+pub unsafe trait HashKey: Copy + Send + Sync + 'static {}
+
+macro_rules! impl_hash_key {
+    ($($ty:ty),*) => {
+        $(unsafe impl HashKey for $ty {})*
+    };
+}
+
+impl_hash_key!(u8, u16, u32, u64, u128, i8, i16, i32, i64, i128);
+
+unsafe impl<K: HashKey, const N: usize> HashKey for [K; N] {}
+
+/// An IPv4 5-tuple, in network byte order, which can be used as the key of a flow table.
+#[repr(C)]
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct Ipv4FiveTuple {
+    pub src_addr: u32,
+    pub dst_addr: u32,
+    pub src_port: u16,
+    pub dst_port: u16,
+    pub proto: u8,
+    /// Must be zeroed.
+    pub _pad: [u8; 3],
+}
+
+unsafe impl HashKey for Ipv4FiveTuple {}
+
+/// A hash table, mapping keys of type `K` to values of type `V`, see the [module documentation](self).
+///
+/// Values are stored in the table's data pointers, so they must fit in a pointer (for larger values, store an index
+/// into another table instead), and updating the value of an existing key is atomic with respect to readers.
+///
+/// The table is freed once both its writer and all of its readers have been dropped.
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__hash_8h.html>
+pub struct HashTable<K, V> {
+    ptr: NonNull<ffi::rte_hash>,
+    _marker: PhantomData<(K, V)>,
+}
+
+// # Safety
+// The table is created with `RW_CONCURRENCY_LF`, so lookups are thread-safe, and the writer isn't `Clone`
+unsafe impl<K: Send, V: Send> Send for HashTable<K, V> {}
+unsafe impl<K: Sync, V: Sync> Sync for HashTable<K, V> {}
+
+/// A key that has been removed from a [`HashTable`], whose slot hasn't been reclaimed yet, see [`HashWriter::remove`].
+#[derive(Debug, PartialEq, Eq)]
+#[must_use = "the key's slot is leaked unless it is reclaimed"]
+pub struct RemovedKey(i32);
+
+impl<K, V> HashTable<K, V>
+where
+    K: HashKey,
+    V: Copy,
+{
+    const VALUE_FITS_IN_POINTER: () =
+        assert!(mem::size_of::<V>() <= mem::size_of::<usize>() && mem::align_of::<V>() <= mem::align_of::<usize>());
+
+    /// Creates a new hash table with room for `entries` keys, on the given socket (or on any socket, if `None`).
+    ///
+    /// Uses DPDK's default hash function (CRC32 where supported, jhash otherwise) to compute the keys' signatures.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__hash_8h.html>
+    pub fn new<S: Into<Vec<u8>>>(
+        name: S,
+        entries: u32,
+        socket_id: Option<SocketId>,
+    ) -> Result<(HashWriter<K, V>, HashReader<K, V>)> {
+        #[allow(clippy::let_unit_value)]
+        let () = Self::VALUE_FITS_IN_POINTER;
+
+        let name = CString::new(name).unwrap();
+        let params = ffi::rte_hash_parameters {
+            name: name.as_ptr(),
+            entries,
+            key_len: mem::size_of::<K>() as u32,
+            socket_id: socket_id.map(|id| id.get() as i32).unwrap_or(-1),
+            extra_flag: (ffi::RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF | ffi::RTE_HASH_EXTRA_FLAGS_EXT_TABLE) as u8,
+            ..Default::default()
+        };
+
+        let ptr = unsafe { ffi::rte_hash_create(&params) }.rte_ok()?;
+        let table = Arc::new(HashTable { ptr, _marker: PhantomData });
+
+        Ok((HashWriter { table: table.clone() }, HashReader { table }))
+    }
+
+    #[inline]
+    fn as_ptr(&self) -> *const ffi::rte_hash {
+        self.ptr.as_ptr()
+    }
+
+    /// Returns the number of keys in the table.
+    #[inline]
+    pub fn len(&self) -> usize {
+        unsafe { ffi::rte_hash_count(self.as_ptr()) }.max(0) as usize
+    }
+
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Returns the signature of `key`, which can be passed to the `*_with_hash` methods.
+    #[inline]
+    pub fn hash(&self, key: &K) -> u32 {
+        unsafe { ffi::rte_hash_hash(self.as_ptr(), key as *const K as *const c_void) }
+    }
+
+    #[inline(always)]
+    fn to_data(value: V) -> *mut c_void {
+        let mut data = ptr::null_mut::<c_void>();
+        unsafe { ptr::write(&mut data as *mut *mut c_void as *mut V, value) };
+        data
+    }
+
+    #[inline(always)]
+    fn from_data(data: *mut c_void) -> V {
+        // `V: Copy`, and (only) values of type `V` are stored in the table
+        unsafe { ptr::read(&data as *const *mut c_void as *const V) }
+    }
+}
+
+impl<K, V> fmt::Debug for HashTable<K, V> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        let count = unsafe { ffi::rte_hash_count(self.ptr.as_ptr()) };
+        f.debug_struct("HashTable").field("ptr", &self.ptr).field("len", &count).finish()
+    }
+}
+
+impl<K, V> Drop for HashTable<K, V> {
+    #[inline]
+    fn drop(&mut self) {
+        unsafe { ffi::rte_hash_free(self.ptr.as_ptr()) }
+    }
+}
+
+/// The writing side of a [`HashTable`], of which there is only one.
+#[derive(Debug)]
+pub struct HashWriter<K, V> {
+    table: Arc<HashTable<K, V>>,
+}
+
+impl<K, V> HashWriter<K, V>
+where
+    K: HashKey,
+    V: Copy,
+{
+    #[inline]
+    pub fn table(&self) -> &HashTable<K, V> {
+        &self.table
+    }
+
+    /// Inserts a key (or updates the value of an existing key), failing with `ENOSPC` if the table is full.
+    #[inline]
+    pub fn insert(&mut self, key: &K, value: V) -> Result<()> {
+        let data = HashTable::<K, V>::to_data(value);
+        unsafe { ffi::rte_hash_add_key_data(self.table.as_ptr(), key as *const K as *const c_void, data) }.rte_ok()?;
+        Ok(())
+    }
+
+    /// Inserts a key, using a precomputed signature, which must be computed the same way for all lookups of the key
+    /// (see [`HashReader::lookup_burst_by_rss`]).
+    #[inline]
+    pub fn insert_with_hash(&mut self, key: &K, sig: u32, value: V) -> Result<()> {
+        let data = HashTable::<K, V>::to_data(value);
+        unsafe {
+            ffi::rte_hash_add_key_with_hash_data(self.table.as_ptr(), key as *const K as *const c_void, sig, data)
+        }
+        .rte_ok()?;
+        Ok(())
+    }
+
+    /// Removes a key, returning `None` if it wasn't in the table.
+    ///
+    /// Readers may still be looking up the key concurrently, so (in lock-free mode) its slot isn't freed right away,
+    /// and should be reclaimed with [`Self::reclaim`], once no reader can still be using it.
+    #[inline]
+    pub fn remove(&mut self, key: &K) -> Option<RemovedKey> {
+        let pos = unsafe { ffi::rte_hash_del_key(self.table.as_ptr(), key as *const K as *const c_void) };
+        (pos >= 0).then(|| RemovedKey(pos))
+    }
+
+    /// Removes a key, using a precomputed signature, see [`Self::remove`].
+    #[inline]
+    pub fn remove_with_hash(&mut self, key: &K, sig: u32) -> Option<RemovedKey> {
+        let pos =
+            unsafe { ffi::rte_hash_del_key_with_hash(self.table.as_ptr(), key as *const K as *const c_void, sig) };
+        (pos >= 0).then(|| RemovedKey(pos))
+    }
+
+    /// Frees the slot of a removed key, so that it can be reused by another key.
+    ///
+    /// # Safety
+    /// The caller must guarantee that all lookups that started before the key was removed have completed
+    /// (e.g. that every reader lcore has gone through an iteration of its poll loop since then).
+    #[inline]
+    pub unsafe fn reclaim(&mut self, key: RemovedKey) {
+        ffi::rte_hash_free_key_with_position(self.table.as_ptr(), key.0);
+    }
+}
+
+/// A reading side of a [`HashTable`], which can be cloned and used by any number of lcores concurrently.
+#[derive(Debug)]
+pub struct HashReader<K, V> {
+    table: Arc<HashTable<K, V>>,
+}
+
+impl<K, V> Clone for HashReader<K, V> {
+    #[inline]
+    fn clone(&self) -> Self {
+        Self { table: self.table.clone() }
+    }
+}
+
+impl<K, V> HashReader<K, V>
+where
+    K: HashKey,
+    V: Copy,
+{
+    #[inline]
+    pub fn table(&self) -> &HashTable<K, V> {
+        &self.table
+    }
+
+    #[inline]
+    pub fn get(&self, key: &K) -> Option<V> {
+        let mut data = ptr::null_mut();
+        let ret =
+            unsafe { ffi::rte_hash_lookup_data(self.table.as_ptr(), key as *const K as *const c_void, &mut data) };
+        (ret >= 0).then(|| HashTable::<K, V>::from_data(data))
+    }
+
+    /// Looks a key up, using a precomputed signature.
+    #[inline]
+    pub fn get_with_hash(&self, key: &K, sig: u32) -> Option<V> {
+        let mut data = ptr::null_mut();
+        let ret = unsafe {
+            ffi::rte_hash_lookup_with_hash_data(self.table.as_ptr(), key as *const K as *const c_void, sig, &mut data)
+        };
+        (ret >= 0).then(|| HashTable::<K, V>::from_data(data))
+    }
+
+    /// Looks up all of `keys` at once, setting the value at the same index of `values` (which must be at least as long
+    /// as `keys`) to the key's value, or to `None` if the key isn't in the table.
+    ///
+    /// This uses `rte_hash_lookup_bulk_data`, which pipelines the lookups (including prefetching the buckets),
+    /// and is several times faster than looking the keys up one at a time.
+    ///
+    /// Returns the number of keys that were found.
+    #[inline]
+    pub fn lookup_bulk(&self, keys: &[K], values: &mut [Option<V>]) -> usize {
+        self.lookup_bulk_impl(keys, None, values)
+    }
+
+    /// Looks up all of `keys` at once, using their precomputed signatures, see [`Self::lookup_bulk`].
+    #[inline]
+    pub fn lookup_bulk_with_hash(&self, keys: &[K], sigs: &[u32], values: &mut [Option<V>]) -> usize {
+        assert!(sigs.len() >= keys.len());
+        self.lookup_bulk_impl(keys, Some(sigs), values)
+    }
+
+    /// Looks up the key of each packet of a burst, using the packet's RSS hash as the key's signature, falling back
+    /// to [`HashTable::hash`] for packets without an RSS hash.
+    ///
+    /// For the lookups to find the keys, the keys must have been inserted with the same signatures
+    /// (see [`HashWriter::insert_with_hash`]), e.g. by the data path when handling a flow's first packet,
+    /// or by using a symmetric RSS key and computing the hash in software (`rte_softrss`).
+    ///
+    /// Returns the number of keys that were found.
+    #[inline]
+    pub fn lookup_burst_by_rss<A, F>(&self, pkts: &[MBuf<A>], mut key_of: F, values: &mut [Option<V>]) -> usize
+    where
+        A: Allocator,
+        F: FnMut(&MBuf<A>) -> K,
+    {
+        assert!(values.len() >= pkts.len());
+
+        let mut found = 0;
+        for (pkts, values) in pkts.chunks(LOOKUP_BULK_MAX).zip(values.chunks_mut(LOOKUP_BULK_MAX)) {
+            let mut keys = [MaybeUninit::<K>::uninit(); LOOKUP_BULK_MAX];
+            let mut sigs = [0; LOOKUP_BULK_MAX];
+            for (i, pkt) in pkts.iter().enumerate() {
+                let key = key_of(pkt);
+                sigs[i] = pkt.rss_hash().unwrap_or_else(|| self.table.hash(&key));
+                keys[i].write(key);
+            }
+
+            // SAFETY: the first `pkts.len()` keys have been initialized
+            let keys = unsafe { &*(&keys[..pkts.len()] as *const [MaybeUninit<K>] as *const [K]) };
+            found += self.lookup_bulk_impl(keys, Some(&sigs), values);
+        }
+        found
+    }
+
+    fn lookup_bulk_impl(&self, keys: &[K], sigs: Option<&[u32]>, values: &mut [Option<V>]) -> usize {
+        assert!(values.len() >= keys.len());
+
+        let mut found = 0;
+        for (chunk_idx, keys) in keys.chunks(LOOKUP_BULK_MAX).enumerate() {
+            let offset = chunk_idx * LOOKUP_BULK_MAX;
+            let mut key_ptrs = [ptr::null::<c_void>(); LOOKUP_BULK_MAX];
+            for (key_ptr, key) in key_ptrs.iter_mut().zip(keys) {
+                *key_ptr = key as *const K as *const c_void;
+            }
+            let mut data = [ptr::null_mut::<c_void>(); LOOKUP_BULK_MAX];
+            let mut hit_mask = 0u64;
+
+            unsafe {
+                match sigs {
+                    Some(sigs) => ffi::rte_hash_lookup_with_hash_bulk_data(
+                        self.table.as_ptr(),
+                        key_ptrs.as_mut_ptr(),
+                        sigs[offset..].as_ptr() as *mut u32,
+                        keys.len() as u32,
+                        &mut hit_mask,
+                        data.as_mut_ptr(),
+                    ),
+                    None => ffi::rte_hash_lookup_bulk_data(
+                        self.table.as_ptr(),
+                        key_ptrs.as_mut_ptr(),
+                        keys.len() as u32,
+                        &mut hit_mask,
+                        data.as_mut_ptr(),
+                    ),
+                }
+            };
+
+            for (i, value) in values[offset..offset + keys.len()].iter_mut().enumerate() {
+                *value = (hit_mask & (1 << i) != 0).then(|| HashTable::<K, V>::from_data(data[i]));
+            }
+            found += hit_mask.count_ones() as usize;
+        }
+        found
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use rte_test_macros::rte_test;
+
+    use super::*;
+    use crate::{flags::PktRxOffload, mbuf::GlobalAllocator};
+
+    fn flow(i: u32) -> Ipv4FiveTuple {
+        Ipv4FiveTuple { src_addr: i, dst_addr: !i, src_port: 1000, dst_port: 53, proto: 17, _pad: [0; 3] }
+    }
+
+    #[rte_test(mock_lcore)]
+    fn bulk_lookup() {
+        let (mut writer, reader) = HashTable::<Ipv4FiveTuple, u32>::new("hash_test", 1024, None).unwrap();
+        for i in (0..200).step_by(2) {
+            writer.insert(&flow(i), i * 10).unwrap();
+        }
+        assert_eq!(reader.table().len(), 100);
+        assert_eq!(reader.get(&flow(4)), Some(40));
+        assert_eq!(reader.get(&flow(5)), None);
+
+        // more keys than a single bulk
+        let keys = (0..100).map(flow).collect::<Vec<_>>();
+        let mut values = vec![None; keys.len()];
+        assert_eq!(reader.lookup_bulk(&keys, &mut values), 50);
+        assert!(values.iter().enumerate().all(|(i, v)| *v == (i % 2 == 0).then(|| i as u32 * 10)));
+
+        let sigs = keys.iter().map(|key| reader.table().hash(key)).collect::<Vec<_>>();
+        let mut with_hash = vec![None; keys.len()];
+        assert_eq!(reader.lookup_bulk_with_hash(&keys, &sigs, &mut with_hash), 50);
+        assert_eq!(values, with_hash);
+
+        let removed = writer.remove(&flow(4)).unwrap();
+        assert_eq!(reader.get(&flow(4)), None);
+        unsafe { writer.reclaim(removed) };
+        assert!(writer.remove(&flow(4)).is_none());
+    }
+
+    #[rte_test(mock_lcore)]
+    fn lookup_by_rss_hash() {
+        let (mut writer, reader) = HashTable::<Ipv4FiveTuple, u32>::new("hash_rss_test", 1024, None).unwrap();
+        for i in (0..200).step_by(2) {
+            writer.insert(&flow(i), i * 10).unwrap();
+        }
+        // a key that can only be found by the signature it was inserted with, rather than by its software hash
+        let sig = reader.table().hash(&flow(1000)) ^ 0x5a5a_5a5a;
+        writer.insert_with_hash(&flow(1000), sig, 1).unwrap();
+
+        // more packets than a single bulk, whose data is the index of their key
+        let mut keys = (0..100).map(flow).collect::<Vec<_>>();
+        keys.push(flow(1000));
+        let pkts = (0..keys.len())
+            .map(|i| {
+                let mut pkt = MBuf::<GlobalAllocator>::new_with_data((i as u32).to_le_bytes());
+                // the odd packets don't have an RSS hash, and fall back to the software hash
+                let rss = match i {
+                    100 => Some(sig),
+                    i if i % 2 == 0 => Some(reader.table().hash(&keys[i])),
+                    _ => None,
+                };
+                if let Some(rss) = rss {
+                    unsafe {
+                        (*pkt.as_raw()).ol_flags |= PktRxOffload::RSS_HASH.bits();
+                        (*pkt.as_raw()).__bindgen_anon_2.hash.rss = rss;
+                    }
+                }
+                pkt
+            })
+            .collect::<Vec<_>>();
+        let key_of = |pkt: &MBuf<GlobalAllocator>| keys[u32::from_le_bytes(pkt[..4].try_into().unwrap()) as usize];
+
+        let mut by_rss = vec![None; pkts.len()];
+        assert_eq!(reader.lookup_burst_by_rss(&pkts, key_of, &mut by_rss), 51);
+        assert_eq!(by_rss[100], Some(1));
+
+        let mut values = vec![None; 100];
+        assert_eq!(reader.lookup_bulk(&keys[..100], &mut values), 50);
+        assert_eq!(by_rss[..100], values[..]);
+    }
+}
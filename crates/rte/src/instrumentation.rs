@@ -0,0 +1,254 @@
+//! Per-lcore poll-loop instrumentation, enabled with the `instrumentation` feature.
+//!
+//! When enabled, [`EthDev::rx_burst`] and [`EthDev::tx_burst`] record the following counters for the calling lcore:
+//! - The number of polls (`rx_burst` calls), how many of them were empty, and a histogram of the burst sizes.
+//! - Busy and idle TSC cycles: the cycles between two consecutive polls are considered busy if the first poll returned
+//!   packets (i.e. they were spent processing the packets), and idle otherwise.
+//! - The number of TX bursts, how many of them were only partially sent, and the number of packets that were not sent.
+//!
+//! Packets dropped by the application can be recorded with [`record_dropped`] (which [`TxBuffer`] does for packets it
+//! could not send).
+//!
+//! The counters of each lcore are kept in their own cache lines, and are only ever written by the lcore itself,
+//! so recording them doesn't involve any atomic read-modify-write operations, and they can be read by any other lcore
+//! (e.g. the main lcore) without locking, using [`lcore_stats`].
+//! Calls made from non-EAL threads are not recorded.
+//!
+//! When the feature is disabled, none of this code (or its data) exists, so there is no overhead at all.
+//!
+//! [`EthDev::rx_burst`]: crate::ethdev::EthDev::rx_burst
+//! [`EthDev::tx_burst`]: crate::ethdev::EthDev::tx_burst
+//! [`TxBuffer`]: crate::ethdev::TxBuffer
+
+use std::{
+    array,
+    sync::atomic::{AtomicBool, AtomicU64, Ordering},
+};
+
+use crate::{cycles, lcore};
+
+/// The number of buckets in the burst size histogram: bucket 0 counts empty polls, and bucket `i > 0` counts bursts
+/// of `2^(i-1)..2^i` packets, with the last bucket counting all larger bursts.
+pub const BURST_SIZE_BUCKETS: usize = 9;
+
+/// The counters of a single lcore, see the [module documentation](self).
+#[repr(align(64))]
+#[derive(Debug)]
+pub struct LcoreStats {
+    polls: AtomicU64,
+    empty_polls: AtomicU64,
+    rx_packets: AtomicU64,
+    busy_cycles: AtomicU64,
+    idle_cycles: AtomicU64,
+    tx_bursts: AtomicU64,
+    tx_packets: AtomicU64,
+    tx_partial_bursts: AtomicU64,
+    tx_unsent: AtomicU64,
+    dropped: AtomicU64,
+    burst_sizes: [AtomicU64; BURST_SIZE_BUCKETS],
+    // the state of the last poll, only used by the lcore itself
+    last_poll_tsc: AtomicU64,
+    last_poll_busy: AtomicBool,
+}
+
+#[allow(clippy::declare_interior_mutable_const)]
+const ZERO: AtomicU64 = AtomicU64::new(0);
+
+#[allow(clippy::declare_interior_mutable_const)]
+const EMPTY: LcoreStats = LcoreStats {
+    polls: ZERO,
+    empty_polls: ZERO,
+    rx_packets: ZERO,
+    busy_cycles: ZERO,
+    idle_cycles: ZERO,
+    tx_bursts: ZERO,
+    tx_packets: ZERO,
+    tx_partial_bursts: ZERO,
+    tx_unsent: ZERO,
+    dropped: ZERO,
+    burst_sizes: [ZERO; BURST_SIZE_BUCKETS],
+    last_poll_tsc: ZERO,
+    last_poll_busy: AtomicBool::new(false),
+};
+
+static STATS: [LcoreStats; ffi::RTE_MAX_LCORE as usize] = [EMPTY; ffi::RTE_MAX_LCORE as usize];
+
+/// Adds `n` to a counter that is only ever written by the current lcore, which doesn't require an atomic RMW.
+#[inline(always)]
+fn add(counter: &AtomicU64, n: u64) {
+    counter.store(counter.load(Ordering::Relaxed).wrapping_add(n), Ordering::Relaxed);
+}
+
+#[inline(always)]
+fn burst_size_bucket(size: usize) -> usize {
+    match size {
+        0 => 0,
+        size => (usize::BITS - size.leading_zeros()).min(BURST_SIZE_BUCKETS as u32 - 1) as usize,
+    }
+}
+
+#[inline(always)]
+fn current() -> Option<&'static LcoreStats> {
+    STATS.get(unsafe { ffi::_rte_lcore_id() } as usize)
+}
+
+#[inline]
+pub(crate) fn record_rx_burst(received: usize) {
+    let stats = match current() {
+        Some(stats) => stats,
+        None => return,
+    };
+
+    let now = cycles::rdtsc();
+    let last = stats.last_poll_tsc.load(Ordering::Relaxed);
+    if last != 0 {
+        let elapsed = now.wrapping_sub(last);
+        if stats.last_poll_busy.load(Ordering::Relaxed) {
+            add(&stats.busy_cycles, elapsed);
+        } else {
+            add(&stats.idle_cycles, elapsed);
+        }
+    }
+    stats.last_poll_tsc.store(now, Ordering::Relaxed);
+    stats.last_poll_busy.store(received > 0, Ordering::Relaxed);
+
+    add(&stats.polls, 1);
+    if received == 0 {
+        add(&stats.empty_polls, 1);
+    }
+    add(&stats.rx_packets, received as u64);
+    add(&stats.burst_sizes[burst_size_bucket(received)], 1);
+}
+
+#[inline]
+pub(crate) fn record_tx_burst(requested: usize, transmitted: usize) {
+    let stats = match current() {
+        Some(stats) => stats,
+        None => return,
+    };
+
+    add(&stats.tx_bursts, 1);
+    add(&stats.tx_packets, transmitted as u64);
+    if transmitted < requested {
+        add(&stats.tx_partial_bursts, 1);
+        add(&stats.tx_unsent, (requested - transmitted) as u64);
+    }
+}
+
+/// Records that `count` packets were dropped by the current lcore.
+#[inline]
+pub fn record_dropped(count: usize) {
+    if let Some(stats) = current() {
+        add(&stats.dropped, count as u64);
+    }
+}
+
+/// Returns the counters of the given lcore, or `None` if the lcore ID is out of range.
+#[inline]
+pub fn lcore_stats(id: lcore::Id) -> Option<&'static LcoreStats> {
+    STATS.get(id.get() as usize)
+}
+
+impl LcoreStats {
+    /// Reads the current values of the counters.
+    ///
+    /// The counters are read one by one, since the lcore may keep updating them concurrently.
+    #[inline]
+    pub fn snapshot(&self) -> LcoreStatsSnapshot {
+        let load = |counter: &AtomicU64| counter.load(Ordering::Relaxed);
+
+        LcoreStatsSnapshot {
+            polls: load(&self.polls),
+            empty_polls: load(&self.empty_polls),
+            rx_packets: load(&self.rx_packets),
+            busy_cycles: load(&self.busy_cycles),
+            idle_cycles: load(&self.idle_cycles),
+            tx_bursts: load(&self.tx_bursts),
+            tx_packets: load(&self.tx_packets),
+            tx_partial_bursts: load(&self.tx_partial_bursts),
+            tx_unsent: load(&self.tx_unsent),
+            dropped: load(&self.dropped),
+            burst_sizes: array::from_fn(|i| load(&self.burst_sizes[i])),
+        }
+    }
+}
+
+/// The values of an lcore's counters at a point in time, see [`LcoreStats::snapshot`].
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct LcoreStatsSnapshot {
+    pub polls: u64,
+    pub empty_polls: u64,
+    pub rx_packets: u64,
+    pub busy_cycles: u64,
+    pub idle_cycles: u64,
+    pub tx_bursts: u64,
+    pub tx_packets: u64,
+    pub tx_partial_bursts: u64,
+    pub tx_unsent: u64,
+    pub dropped: u64,
+    /// See [`BURST_SIZE_BUCKETS`].
+    pub burst_sizes: [u64; BURST_SIZE_BUCKETS],
+}
+
+impl LcoreStatsSnapshot {
+    /// Returns the difference between the counters of `self` and the (older) snapshot `prev`.
+    #[inline]
+    pub fn delta(&self, prev: &Self) -> Self {
+        let mut burst_sizes = self.burst_sizes;
+        burst_sizes.iter_mut().zip(prev.burst_sizes).for_each(|(curr, prev)| *curr = curr.wrapping_sub(prev));
+
+        Self {
+            polls: self.polls.wrapping_sub(prev.polls),
+            empty_polls: self.empty_polls.wrapping_sub(prev.empty_polls),
+            rx_packets: self.rx_packets.wrapping_sub(prev.rx_packets),
+            busy_cycles: self.busy_cycles.wrapping_sub(prev.busy_cycles),
+            idle_cycles: self.idle_cycles.wrapping_sub(prev.idle_cycles),
+            tx_bursts: self.tx_bursts.wrapping_sub(prev.tx_bursts),
+            tx_packets: self.tx_packets.wrapping_sub(prev.tx_packets),
+            tx_partial_bursts: self.tx_partial_bursts.wrapping_sub(prev.tx_partial_bursts),
+            tx_unsent: self.tx_unsent.wrapping_sub(prev.tx_unsent),
+            dropped: self.dropped.wrapping_sub(prev.dropped),
+            burst_sizes,
+        }
+    }
+
+    /// Returns the fraction of polls that returned no packets.
+    #[inline]
+    pub fn empty_poll_ratio(&self) -> f64 {
+        if self.polls == 0 {
+            0.0
+        } else {
+            self.empty_polls as f64 / self.polls as f64
+        }
+    }
+
+    /// Returns the fraction of (measured) cycles that were spent processing packets.
+    #[inline]
+    pub fn busy_ratio(&self) -> f64 {
+        let total = self.busy_cycles + self.idle_cycles;
+        if total == 0 {
+            0.0
+        } else {
+            self.busy_cycles as f64 / total as f64
+        }
+    }
+}
+
+impl lcore::Id {
+    /// Returns the instrumentation counters of this lcore, see [`lcore_stats`].
+    #[inline]
+    pub fn stats(self) -> Option<&'static LcoreStats> {
+        lcore_stats(self)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn burst_size_buckets() {
+        let buckets = [0, 1, 2, 3, 4, 7, 8, 32, 64, 128, 1024].map(burst_size_bucket);
+        assert_eq!(buckets, [0, 1, 2, 2, 3, 3, 4, 6, 7, 8, 8]);
+    }
+}
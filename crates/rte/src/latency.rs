@@ -0,0 +1,365 @@
+//! Measuring per-packet latency on the data path, e.g. from the time a packet was received by the NIC
+//! (see [`MetadataExt::rx_timestamp`]) until a verdict has been reached for it.
+//!
+//! - [`ClockSync`] converts a device's timestamps into TSC cycles, so that they can be compared with [`rdtsc`].
+//! - [`LatencyHistogram`] records latencies in log-linear buckets (like an HDR histogram), cheaply enough to record
+//!   every packet. Each lcore records into its own histogram (see [`PerLcoreHistograms`]), and the control plane
+//!   merges [snapshots](HistogramSnapshot) of them to export percentiles.
+//!
+//! ```rust,ignore
+//! let hist = histograms.for_current_lcore().unwrap();
+//! for pkt in &pkts {
+//!     if let Some(ts) = pkt.rx_timestamp() {
+//!         hist.record(now.saturating_sub(clock.to_tsc(ts)));
+//!     }
+//! }
+//! ```
+//!
+//! [`MetadataExt::rx_timestamp`]: crate::mbuf::MetadataExt::rx_timestamp
+
+use std::{
+    fmt,
+    sync::atomic::{AtomicU64, Ordering},
+    thread,
+    time::Duration,
+};
+
+use once_cell::sync::OnceCell;
+
+use crate::{cycles::rdtsc, ethdev::EthDev, lcore, Result};
+
+/// Samples the device's clock along with the TSC, returning the TSC at the midpoint of reading the device's clock.
+fn sample(dev: &EthDev) -> Result<(u64, u64)> {
+    let before = rdtsc();
+    let clock = dev.read_clock()?;
+    let after = rdtsc();
+    Ok((clock, before + (after - before) / 2))
+}
+
+/// Converts the timestamps of a device's clock (see [`EthDev::read_clock`]) into TSC cycles.
+///
+/// The clocks drift apart over time, so the conversion should be [resynchronized](Self::resync) periodically
+/// (e.g. once per second, by the control plane).
+#[derive(Debug, Clone)]
+pub struct ClockSync {
+    dev: EthDev,
+    clock_base: u64,
+    tsc_base: u64,
+    /// The number of TSC cycles per tick of the device's clock
+    ratio: f64,
+}
+
+impl ClockSync {
+    /// Measures the frequency of the device's clock against the TSC, over `duration` (e.g. 100 ms).
+    ///
+    /// Fails with `ENOTSUP` if the driver doesn't support reading the device's clock.
+    pub fn calibrate(dev: &EthDev, duration: Duration) -> Result<Self> {
+        let (clock_base, tsc_base) = sample(dev)?;
+        thread::sleep(duration);
+        let mut sync = Self { dev: dev.clone(), clock_base, tsc_base, ratio: 1.0 };
+        sync.resync()?;
+        Ok(sync)
+    }
+
+    /// Measures the frequency of the device's clock again, since the last synchronization.
+    pub fn resync(&mut self) -> Result<()> {
+        let (clock, tsc) = sample(&self.dev)?;
+        let ticks = clock.wrapping_sub(self.clock_base);
+        if ticks > 0 {
+            self.ratio = tsc.wrapping_sub(self.tsc_base) as f64 / ticks as f64;
+        }
+        self.clock_base = clock;
+        self.tsc_base = tsc;
+        Ok(())
+    }
+
+    /// Returns the device whose clock is converted.
+    #[inline]
+    pub fn dev(&self) -> &EthDev {
+        &self.dev
+    }
+
+    /// Returns the number of TSC cycles per tick of the device's clock.
+    #[inline]
+    pub fn ratio(&self) -> f64 {
+        self.ratio
+    }
+
+    /// Converts a timestamp of the device's clock into the value the TSC had at that time.
+    #[inline(always)]
+    pub fn to_tsc(&self, timestamp: u64) -> u64 {
+        // timestamps may be slightly older than the last synchronization
+        let ticks = timestamp.wrapping_sub(self.clock_base) as i64;
+        self.tsc_base.wrapping_add((ticks as f64 * self.ratio) as i64 as u64)
+    }
+}
+
+/// The number of bits of precision of the values recorded by a [`LatencyHistogram`],
+/// i.e. values are recorded with a relative error of at most 2^-(`PRECISION_BITS` - 1) (about 3%).
+pub const PRECISION_BITS: u32 = 6;
+
+const SUB_BUCKETS: usize = 1 << (PRECISION_BITS - 1);
+const NB_BUCKETS: usize = bucket_index(u64::MAX) + 1;
+
+/// Returns the index of the bucket `value` is counted in: values smaller than `2 * SUB_BUCKETS` each have their own
+/// bucket, and each larger power of two is split into `SUB_BUCKETS` buckets.
+#[inline(always)]
+const fn bucket_index(value: u64) -> usize {
+    if value < 2 * SUB_BUCKETS as u64 {
+        return value as usize;
+    }
+    let shift = 63 - value.leading_zeros() - (PRECISION_BITS - 1);
+    shift as usize * SUB_BUCKETS + (value >> shift) as usize
+}
+
+/// Returns the range of values counted in the bucket at `index`, see [`bucket_index`].
+#[inline]
+fn bucket_range(index: usize) -> (u64, u64) {
+    if index < 2 * SUB_BUCKETS {
+        return (index as u64, index as u64);
+    }
+    let shift = index / SUB_BUCKETS - 1;
+    let top = (index % SUB_BUCKETS + SUB_BUCKETS) as u64;
+    (top << shift, ((top + 1) << shift).wrapping_sub(1))
+}
+
+/// A histogram of latencies (in any unit, e.g. TSC cycles), which is recorded into by a single lcore,
+/// and can be read concurrently by other threads, see [`Self::snapshot`].
+pub struct LatencyHistogram {
+    counts: Box<[AtomicU64]>,
+    min: AtomicU64,
+    max: AtomicU64,
+    sum: AtomicU64,
+}
+
+impl LatencyHistogram {
+    #[inline]
+    pub fn new() -> Self {
+        Self {
+            counts: (0..NB_BUCKETS).map(|_| AtomicU64::new(0)).collect(),
+            min: AtomicU64::new(u64::MAX),
+            max: AtomicU64::new(0),
+            sum: AtomicU64::new(0),
+        }
+    }
+
+    /// Records a value.
+    ///
+    /// This doesn't use atomic read-modify-write operations (it only costs a few plain loads and stores), so values
+    /// recorded by several threads concurrently may be lost; each lcore should record into its own histogram.
+    #[inline(always)]
+    pub fn record(&self, value: u64) {
+        let count = &self.counts[bucket_index(value)];
+        count.store(count.load(Ordering::Relaxed) + 1, Ordering::Relaxed);
+        if value < self.min.load(Ordering::Relaxed) {
+            self.min.store(value, Ordering::Relaxed);
+        }
+        if value > self.max.load(Ordering::Relaxed) {
+            self.max.store(value, Ordering::Relaxed);
+        }
+        self.sum.store(self.sum.load(Ordering::Relaxed).wrapping_add(value), Ordering::Relaxed);
+    }
+
+    /// Returns a copy of the histogram's current counts.
+    pub fn snapshot(&self) -> HistogramSnapshot {
+        let counts = self.counts.iter().map(|count| count.load(Ordering::Relaxed)).collect::<Box<[_]>>();
+        HistogramSnapshot {
+            total: counts.iter().sum(),
+            counts,
+            min: self.min.load(Ordering::Relaxed),
+            max: self.max.load(Ordering::Relaxed),
+            sum: self.sum.load(Ordering::Relaxed),
+        }
+    }
+
+    /// Resets all counts, which must not be done concurrently with [`Self::record`].
+    pub fn reset(&self) {
+        self.counts.iter().for_each(|count| count.store(0, Ordering::Relaxed));
+        self.min.store(u64::MAX, Ordering::Relaxed);
+        self.max.store(0, Ordering::Relaxed);
+        self.sum.store(0, Ordering::Relaxed);
+    }
+}
+
+impl Default for LatencyHistogram {
+    #[inline]
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl fmt::Debug for LatencyHistogram {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("LatencyHistogram")
+            .field("min", &self.min.load(Ordering::Relaxed))
+            .field("max", &self.max.load(Ordering::Relaxed))
+            .finish_non_exhaustive()
+    }
+}
+
+/// A copy of the counts of one or more (merged) [`LatencyHistogram`]s.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct HistogramSnapshot {
+    counts: Box<[u64]>,
+    total: u64,
+    min: u64,
+    max: u64,
+    sum: u64,
+}
+
+impl HistogramSnapshot {
+    /// Returns an empty snapshot, e.g. for merging snapshots into.
+    #[inline]
+    pub fn empty() -> Self {
+        Self { counts: vec![0; NB_BUCKETS].into(), total: 0, min: u64::MAX, max: 0, sum: 0 }
+    }
+
+    /// Adds the counts of `other` to this snapshot.
+    pub fn merge(&mut self, other: &Self) {
+        self.counts.iter_mut().zip(other.counts.iter()).for_each(|(count, other)| *count += other);
+        self.total += other.total;
+        self.min = self.min.min(other.min);
+        self.max = self.max.max(other.max);
+        self.sum = self.sum.wrapping_add(other.sum);
+    }
+
+    /// Returns the number of recorded values.
+    #[inline]
+    pub fn count(&self) -> u64 {
+        self.total
+    }
+
+    #[inline]
+    pub fn min(&self) -> Option<u64> {
+        (self.total > 0).then(|| self.min)
+    }
+
+    #[inline]
+    pub fn max(&self) -> Option<u64> {
+        (self.total > 0).then(|| self.max)
+    }
+
+    #[inline]
+    pub fn mean(&self) -> Option<f64> {
+        (self.total > 0).then(|| self.sum as f64 / self.total as f64)
+    }
+
+    /// Returns the value below which (at least) the fraction `quantile` (between 0 and 1) of the recorded values are,
+    /// e.g. `0.99` for the 99th percentile, within the histogram's precision (see [`PRECISION_BITS`]).
+    pub fn value_at_quantile(&self, quantile: f64) -> Option<u64> {
+        if self.total == 0 {
+            return None;
+        }
+        let rank = ((quantile.clamp(0.0, 1.0) * self.total as f64).ceil() as u64).max(1);
+        let mut seen = 0;
+        let index = self.counts.iter().position(|&count| {
+            seen += count;
+            seen >= rank
+        })?;
+        Some(bucket_range(index).1.clamp(self.min, self.max))
+    }
+
+    /// Returns an iterator over the non-empty buckets, as their (inclusive) range of values, and their count.
+    #[inline]
+    pub fn buckets(&self) -> impl Iterator<Item = (u64, u64, u64)> + '_ {
+        self.counts.iter().enumerate().filter(|(_, &count)| count > 0).map(|(index, &count)| {
+            let (low, high) = bucket_range(index);
+            (low, high, count)
+        })
+    }
+}
+
+/// A [`LatencyHistogram`] for each lcore, which are allocated on first use.
+pub struct PerLcoreHistograms {
+    histograms: Box<[OnceCell<LatencyHistogram>]>,
+}
+
+impl PerLcoreHistograms {
+    #[inline]
+    pub fn new() -> Self {
+        Self { histograms: (0..ffi::RTE_MAX_LCORE).map(|_| OnceCell::new()).collect() }
+    }
+
+    /// Returns the histogram of the given lcore, or `None` if the lcore ID is out of range (e.g. `LCORE_ID_ANY`).
+    #[inline]
+    pub fn for_lcore(&self, lcore: lcore::Id) -> Option<&LatencyHistogram> {
+        self.histograms.get(lcore.get() as usize).map(|histogram| histogram.get_or_init(LatencyHistogram::new))
+    }
+
+    /// Returns the histogram of the current lcore, see [`Self::for_lcore`].
+    #[inline]
+    pub fn for_current_lcore(&self) -> Option<&LatencyHistogram> {
+        self.for_lcore(lcore::current())
+    }
+
+    /// Returns the snapshots of all the histograms (that have been used), merged.
+    pub fn merged(&self) -> HistogramSnapshot {
+        let mut merged = HistogramSnapshot::empty();
+        for histogram in self.histograms.iter().filter_map(OnceCell::get) {
+            merged.merge(&histogram.snapshot());
+        }
+        merged
+    }
+
+    /// Resets all the histograms, see [`LatencyHistogram::reset`].
+    pub fn reset(&self) {
+        self.histograms.iter().filter_map(OnceCell::get).for_each(LatencyHistogram::reset);
+    }
+}
+
+impl Default for PerLcoreHistograms {
+    #[inline]
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl fmt::Debug for PerLcoreHistograms {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        let used = self.histograms.iter().filter(|histogram| histogram.get().is_some()).count();
+        f.debug_struct("PerLcoreHistograms").field("used", &used).finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn buckets_cover_all_values() {
+        assert_eq!(NB_BUCKETS, 1920);
+        for index in 0..NB_BUCKETS {
+            let (low, high) = bucket_range(index);
+            assert_eq!(bucket_index(low), index);
+            assert_eq!(bucket_index(high), index);
+            if index + 1 < NB_BUCKETS {
+                assert_eq!(bucket_range(index + 1).0, high + 1);
+            }
+            // the relative error is bounded
+            assert!((high - low) as f64 <= low as f64 / SUB_BUCKETS as f64);
+        }
+    }
+
+    #[test]
+    fn merged_quantiles() {
+        let (a, b) = (LatencyHistogram::new(), LatencyHistogram::new());
+        (1..=900).for_each(|value| a.record(value));
+        (901..=1000).for_each(|value| b.record(value * 10));
+
+        let mut merged = a.snapshot();
+        merged.merge(&b.snapshot());
+        assert_eq!(merged.count(), 1000);
+        assert_eq!(merged.min(), Some(1));
+        assert_eq!(merged.max(), Some(10_000));
+        assert_eq!(merged.value_at_quantile(0.0), Some(1));
+        assert_eq!(merged.value_at_quantile(1.0), Some(10_000));
+
+        let p50 = merged.value_at_quantile(0.5).unwrap();
+        assert!((500..=500 + 500 / SUB_BUCKETS as u64).contains(&p50));
+        let p99 = merged.value_at_quantile(0.99).unwrap();
+        assert!((9_900..=9_900 + 9_900 / SUB_BUCKETS as u64).contains(&p99));
+
+        assert_eq!(merged.buckets().map(|(_, _, count)| count).sum::<u64>(), 1000);
+        assert_eq!(HistogramSnapshot::empty().value_at_quantile(0.5), None);
+    }
+}
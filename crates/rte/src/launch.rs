@@ -4,6 +4,7 @@ use std::{
     os::raw::{c_int, c_void},
     panic::{catch_unwind, AssertUnwindSafe},
     process,
+    sync::{Arc, Mutex},
 };
 
 use rte_error::ReturnValue as _;
@@ -54,7 +55,85 @@ unsafe extern "C" fn lcore_stub<T: Send + 'static>(arg: *mut c_void) -> c_int {
     }
 }
 
+type Closure = Box<dyn FnOnce() + Send>;
+
+unsafe extern "C" fn lcore_closure_stub(arg: *mut c_void) -> c_int {
+    let f = *Box::from_raw(arg as *mut Closure);
+
+    // see `lcore_stub`
+    match catch_unwind(AssertUnwindSafe(f)) {
+        Ok(()) => 0,
+        Err(_) => process::abort(),
+    }
+}
+
+/// A handle for waiting on a closure launched with [`lcore::Id::spawn`], and retrieving its return value.
+#[derive(Debug)]
+pub struct JoinHandle<R> {
+    lcore: lcore::Id,
+    result: Arc<Mutex<Option<R>>>,
+}
+
+impl<R> JoinHandle<R> {
+    /// Returns the lcore that runs the closure.
+    #[inline]
+    pub fn lcore(&self) -> lcore::Id {
+        self.lcore
+    }
+
+    /// Returns `true` if the closure has returned.
+    #[inline]
+    pub fn is_finished(&self) -> bool {
+        self.result.lock().unwrap().is_some()
+    }
+
+    /// Waits for the closure to return (using `rte_eal_wait_lcore`), and returns its return value.
+    ///
+    /// **NOTE:** should be executed on main lcore only. Will `panic` otherwise, if debug assertions are enabled.
+    #[inline]
+    pub fn join(self) -> R {
+        debug_assert!(lcore::current().is_main());
+        unsafe { ffi::rte_eal_wait_lcore(self.lcore.get()) };
+        // panics inside the closure abort the process, so once the lcore is back in the WAIT state
+        // the closure must have returned
+        let result = self.result.lock().unwrap().take();
+        result.expect("lcore returned without running its closure")
+    }
+}
+
 impl lcore::Id {
+    /// Runs a closure on this (worker) lcore, like [`thread::spawn`](std::thread::spawn) does for OS threads.
+    ///
+    /// Unlike [`Self::launch`], the closure can capture its environment, and its return value can be retrieved
+    /// using the returned [`JoinHandle`].
+    /// Fails with `EBUSY` if the lcore is already running something.
+    ///
+    /// **NOTE:** should be executed on main lcore only. Will `panic` otherwise, if debug assertions are enabled.
+    #[inline]
+    pub fn spawn<F, R>(self, f: F) -> Result<JoinHandle<R>>
+    where
+        F: FnOnce() -> R + Send + 'static,
+        R: Send + 'static,
+    {
+        debug_assert!(lcore::current().is_main());
+        let result = Arc::new(Mutex::new(None));
+        let slot = result.clone();
+        let closure: Closure = Box::new(move || {
+            let ret = f();
+            *slot.lock().unwrap() = Some(ret);
+        });
+
+        // Safety: memory is released in `lcore_closure_stub` (success) or in the `Err` match arm (failure)
+        let ctxt = Box::into_raw(Box::new(closure)) as *mut c_void;
+        match unsafe { ffi::rte_eal_remote_launch(Some(lcore_closure_stub), ctxt, self.get()) }.rte_ok() {
+            Ok(_) => Ok(JoinHandle { lcore: self, result }),
+            Err(err) => {
+                let _ = unsafe { Box::from_raw(ctxt as *mut Closure) };
+                Err(err)
+            }
+        }
+    }
+
     /// **NOTE:** should be executed on main lcore only. Will `panic` otherwise, if debug assertions are enabled.
     ///
     /// See docs for [`thread::spawn`](std::thread::spawn) for an explanation of the constraints on `T`.
@@ -38,6 +38,14 @@ impl Id {
         self == main()
     }
 
+    /// Returns the NUMA socket of this lcore, or `None` if it's unknown (or the lcore ID is out of range).
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__lcore_8h.html>
+    #[inline]
+    pub fn socket_id(self) -> Option<SocketId> {
+        SocketId::new(unsafe { ffi::rte_lcore_to_socket_id(self.0) })
+    }
+
     /// See also: <https://doc.dpdk.org/api-21.08/rte__lcore_8h.html#acab656f5b00c29090db4500efabedd98>
     fn get_next(self, skip_main: bool, wrap: bool) -> Id {
         Id::new(unsafe { ffi::rte_get_next_lcore(self.0, skip_main.into(), wrap.into()) })
@@ -1,15 +1,42 @@
 #[cfg(test)]
 extern crate self as rte;
 
+pub mod acl;
+pub mod capture;
+pub mod cycles;
 pub mod ethdev;
+pub mod eventdev;
 pub mod flags;
+pub mod gro;
+pub mod gso;
+pub mod hash;
+#[cfg(feature = "instrumentation")]
+pub mod instrumentation;
+pub mod latency;
 pub mod launch;
 pub mod lcore;
+pub mod lpm;
 pub mod mbuf;
 pub mod memory;
 pub mod mempool;
+pub mod rcu;
+pub mod ring;
+pub mod runtime;
 
 #[cfg(any(test, feature = "test-utils"))]
 pub mod test_utils;
 
+use std::{
+    ffi::CString,
+    sync::atomic::{AtomicU64, Ordering},
+};
+
 type Result<T, E = rte_error::Error> = std::result::Result<T, E>;
+
+/// Returns `name` suffixed with a (process-wide) unique id, for DPDK objects which are looked up by name, and thus
+/// must have unique names, allowing a new version of an object to be built (with the same name) while the previous
+/// one is still in use.
+pub(crate) fn unique_name(name: &str) -> CString {
+    static NEXT_ID: AtomicU64 = AtomicU64::new(0);
+    CString::new(format!("{}_{}", name, NEXT_ID.fetch_add(1, Ordering::Relaxed))).unwrap()
+}
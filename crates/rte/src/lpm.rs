@@ -0,0 +1,353 @@
+//! Longest prefix match (LPM) tables of IPv4 and IPv6 prefixes, based on DPDK's
+//! [LPM Library](https://doc.dpdk.org/guides-21.08/prog_guide/lpm_lib.html).
+//!
+//! Each prefix is mapped to a next hop, an arbitrary (small) integer which can be used as a verdict (e.g. allow/deny)
+//! or as an index into another table. Lookups are meant to be done a whole burst at a time,
+//! see [`Lpm::lookup_burst`].
+//!
+//! Modifying a table requires `&mut`, so tables shared with the data plane are rebuilt off to the side and swapped in
+//! atomically, e.g. by storing them in an [`RcuCell`](crate::rcu::RcuCell).
+
+use std::{
+    fmt,
+    net::{Ipv4Addr, Ipv6Addr},
+    ptr::NonNull,
+};
+
+use rte_error::{Error, ReturnValue as _};
+
+use crate::{
+    mbuf::{Allocator, MBuf},
+    memory::SocketId,
+    unique_name, Result,
+};
+
+/// The largest next hop of an IPv4 prefix (next hops are 24 bits).
+pub const MAX_NEXT_HOP: u32 = (1 << 24) - 1;
+/// The largest next hop of an IPv6 prefix (next hops are 21 bits).
+pub const MAX_NEXT_HOP6: u32 = (1 << 21) - 1;
+
+/// The number of addresses looked up by a single call to the bulk lookup functions,
+/// larger bulks are looked up in chunks of this size.
+const LOOKUP_BULK_MAX: usize = 64;
+
+/// A table of IPv4 prefixes.
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__lpm_8h.html>
+pub struct Lpm {
+    ptr: NonNull<ffi::rte_lpm>,
+}
+
+// # Safety
+// Lookups don't modify the table, and modifications require `&mut self`
+unsafe impl Send for Lpm {}
+unsafe impl Sync for Lpm {}
+
+impl Lpm {
+    /// Creates an empty table, with room for `max_rules` prefixes, of which up to `number_tbl8s` can be longer than
+    /// 24 bits, on the given socket (or on any socket, if `None`).
+    ///
+    /// The table's name (which DPDK requires to be unique) is `name` suffixed with a unique id, so that `name` can
+    /// be reused when rebuilding the table. `name` must be short enough for the suffixed name to fit in
+    /// `RTE_LPM_NAMESIZE` bytes.
+    pub fn new(name: &str, socket_id: Option<SocketId>, max_rules: u32, number_tbl8s: u32) -> Result<Self> {
+        let name = unique_name(name);
+        let config = ffi::rte_lpm_config { max_rules, number_tbl8s, ..Default::default() };
+        let socket_id = socket_id.map(|id| id.get() as i32).unwrap_or(-1);
+        let ptr = unsafe { ffi::rte_lpm_create(name.as_ptr(), socket_id, &config) }.rte_ok()?;
+        Ok(Self { ptr })
+    }
+
+    #[inline]
+    fn as_ptr(&self) -> *mut ffi::rte_lpm {
+        self.ptr.as_ptr()
+    }
+
+    /// Adds a prefix of `depth` bits (1 to 32), replacing the next hop of the prefix if it's already in the table.
+    ///
+    /// Fails with `EINVAL` if `next_hop` is larger than [`MAX_NEXT_HOP`], and with `ENOSPC` if the table is full.
+    #[inline]
+    pub fn add(&mut self, ip: Ipv4Addr, depth: u8, next_hop: u32) -> Result<()> {
+        if next_hop > MAX_NEXT_HOP {
+            return Err(Error(libc::EINVAL));
+        }
+        unsafe { ffi::rte_lpm_add(self.as_ptr(), ip.into(), depth, next_hop) }.rte_ok()?;
+        Ok(())
+    }
+
+    /// Removes a prefix, failing with `ENOENT` if it isn't in the table.
+    #[inline]
+    pub fn delete(&mut self, ip: Ipv4Addr, depth: u8) -> Result<()> {
+        unsafe { ffi::rte_lpm_delete(self.as_ptr(), ip.into(), depth) }.rte_ok()?;
+        Ok(())
+    }
+
+    /// Removes all prefixes.
+    #[inline]
+    pub fn clear(&mut self) {
+        unsafe { ffi::rte_lpm_delete_all(self.as_ptr()) }
+    }
+
+    /// Returns the next hop of the longest prefix matching `ip`.
+    #[inline]
+    pub fn lookup(&self, ip: Ipv4Addr) -> Option<u32> {
+        let mut next_hop = 0;
+        let ret = unsafe { ffi::_rte_lpm_lookup(self.as_ptr(), ip.into(), &mut next_hop) };
+        (ret == 0).then(|| next_hop)
+    }
+
+    /// Looks up all of `ips` at once, setting the value at the same index of `next_hops` (which must be at least as
+    /// long as `ips`) to the next hop of the longest prefix matching the address, or to `None` if none does.
+    ///
+    /// Returns the number of addresses that matched a prefix.
+    #[inline]
+    pub fn lookup_bulk(&self, ips: &[Ipv4Addr], next_hops: &mut [Option<u32>]) -> usize {
+        assert!(next_hops.len() >= ips.len());
+
+        let mut found = 0;
+        for (ips, next_hops) in ips.chunks(LOOKUP_BULK_MAX).zip(next_hops.chunks_mut(LOOKUP_BULK_MAX)) {
+            let mut raw_ips = [0; LOOKUP_BULK_MAX];
+            for (raw_ip, &ip) in raw_ips.iter_mut().zip(ips) {
+                *raw_ip = ip.into();
+            }
+            found += self.lookup_bulk_raw(&raw_ips[..ips.len()], next_hops);
+        }
+        found
+    }
+
+    /// Looks up the address of each packet of a burst, as returned by `ip_of` (e.g. the packet's source address),
+    /// see [`Self::lookup_bulk`]. Packets for which `ip_of` returns `None` (e.g. non-IPv4 packets) don't match.
+    ///
+    /// Returns the number of packets that matched a prefix.
+    #[inline]
+    pub fn lookup_burst<A, F>(&self, pkts: &[MBuf<A>], mut ip_of: F, next_hops: &mut [Option<u32>]) -> usize
+    where
+        A: Allocator,
+        F: FnMut(&MBuf<A>) -> Option<Ipv4Addr>,
+    {
+        assert!(next_hops.len() >= pkts.len());
+
+        let mut found = 0;
+        for (pkts, next_hops) in pkts.chunks(LOOKUP_BULK_MAX).zip(next_hops.chunks_mut(LOOKUP_BULK_MAX)) {
+            let mut raw_ips = [0; LOOKUP_BULK_MAX];
+            let mut valid = [false; LOOKUP_BULK_MAX];
+            for (i, pkt) in pkts.iter().enumerate() {
+                if let Some(ip) = ip_of(pkt) {
+                    raw_ips[i] = ip.into();
+                    valid[i] = true;
+                }
+            }
+
+            found += self.lookup_bulk_raw(&raw_ips[..pkts.len()], next_hops);
+            for (next_hop, valid) in next_hops.iter_mut().zip(valid) {
+                if !valid && next_hop.take().is_some() {
+                    found -= 1;
+                }
+            }
+        }
+        found
+    }
+
+    /// Looks up at most [`LOOKUP_BULK_MAX`] addresses, in host byte order.
+    #[inline]
+    fn lookup_bulk_raw(&self, ips: &[u32], next_hops: &mut [Option<u32>]) -> usize {
+        let mut raw_next_hops = [0; LOOKUP_BULK_MAX];
+        unsafe { ffi::_rte_lpm_lookup_bulk(self.as_ptr(), ips.as_ptr(), raw_next_hops.as_mut_ptr(), ips.len() as u32) };
+
+        let mut found = 0;
+        for (next_hop, &raw) in next_hops.iter_mut().zip(&raw_next_hops[..ips.len()]) {
+            *next_hop = (raw & ffi::RTE_LPM_LOOKUP_SUCCESS != 0).then(|| raw & MAX_NEXT_HOP);
+            found += usize::from(next_hop.is_some());
+        }
+        found
+    }
+}
+
+impl fmt::Debug for Lpm {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Lpm").field("ptr", &self.ptr).finish()
+    }
+}
+
+impl Drop for Lpm {
+    #[inline]
+    fn drop(&mut self) {
+        unsafe { ffi::rte_lpm_free(self.as_ptr()) }
+    }
+}
+
+/// A table of IPv6 prefixes, see [`Lpm`].
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__lpm6_8h.html>
+pub struct Lpm6 {
+    ptr: NonNull<ffi::rte_lpm6>,
+}
+
+// # Safety
+// Lookups don't modify the table, and modifications require `&mut self`
+unsafe impl Send for Lpm6 {}
+unsafe impl Sync for Lpm6 {}
+
+impl Lpm6 {
+    /// Creates an empty table, see [`Lpm::new`].
+    pub fn new(name: &str, socket_id: Option<SocketId>, max_rules: u32, number_tbl8s: u32) -> Result<Self> {
+        let name = unique_name(name);
+        let config = ffi::rte_lpm6_config { max_rules, number_tbl8s, ..Default::default() };
+        let socket_id = socket_id.map(|id| id.get() as i32).unwrap_or(-1);
+        let ptr = unsafe { ffi::rte_lpm6_create(name.as_ptr(), socket_id, &config) }.rte_ok()?;
+        Ok(Self { ptr })
+    }
+
+    #[inline]
+    fn as_ptr(&self) -> *mut ffi::rte_lpm6 {
+        self.ptr.as_ptr()
+    }
+
+    /// Adds a prefix of `depth` bits (1 to 128), replacing the next hop of the prefix if it's already in the table.
+    ///
+    /// Fails with `EINVAL` if `next_hop` is larger than [`MAX_NEXT_HOP6`], and with `ENOSPC` if the table is full.
+    #[inline]
+    pub fn add(&mut self, ip: Ipv6Addr, depth: u8, next_hop: u32) -> Result<()> {
+        if next_hop > MAX_NEXT_HOP6 {
+            return Err(Error(libc::EINVAL));
+        }
+        unsafe { ffi::rte_lpm6_add(self.as_ptr(), ip.octets().as_ptr(), depth, next_hop) }.rte_ok()?;
+        Ok(())
+    }
+
+    /// Removes a prefix, failing with `ENOENT` if it isn't in the table.
+    #[inline]
+    pub fn delete(&mut self, ip: Ipv6Addr, depth: u8) -> Result<()> {
+        unsafe { ffi::rte_lpm6_delete(self.as_ptr(), ip.octets().as_ptr(), depth) }.rte_ok()?;
+        Ok(())
+    }
+
+    /// Removes all prefixes.
+    #[inline]
+    pub fn clear(&mut self) {
+        unsafe { ffi::rte_lpm6_delete_all(self.as_ptr()) }
+    }
+
+    /// Returns the next hop of the longest prefix matching `ip`.
+    #[inline]
+    pub fn lookup(&self, ip: Ipv6Addr) -> Option<u32> {
+        let mut next_hop = 0;
+        let ret = unsafe { ffi::rte_lpm6_lookup(self.as_ptr(), ip.octets().as_ptr(), &mut next_hop) };
+        (ret == 0).then(|| next_hop)
+    }
+
+    /// Looks up all of `ips` at once, see [`Lpm::lookup_bulk`].
+    #[inline]
+    pub fn lookup_bulk(&self, ips: &[Ipv6Addr], next_hops: &mut [Option<u32>]) -> usize {
+        assert!(next_hops.len() >= ips.len());
+
+        let mut found = 0;
+        for (ips, next_hops) in ips.chunks(LOOKUP_BULK_MAX).zip(next_hops.chunks_mut(LOOKUP_BULK_MAX)) {
+            let mut raw_ips = [[0; 16]; LOOKUP_BULK_MAX];
+            for (raw_ip, ip) in raw_ips.iter_mut().zip(ips) {
+                *raw_ip = ip.octets();
+            }
+            found += self.lookup_bulk_raw(&mut raw_ips[..ips.len()], next_hops);
+        }
+        found
+    }
+
+    /// Looks up the address of each packet of a burst, see [`Lpm::lookup_burst`].
+    #[inline]
+    pub fn lookup_burst<A, F>(&self, pkts: &[MBuf<A>], mut ip_of: F, next_hops: &mut [Option<u32>]) -> usize
+    where
+        A: Allocator,
+        F: FnMut(&MBuf<A>) -> Option<Ipv6Addr>,
+    {
+        assert!(next_hops.len() >= pkts.len());
+
+        let mut found = 0;
+        for (pkts, next_hops) in pkts.chunks(LOOKUP_BULK_MAX).zip(next_hops.chunks_mut(LOOKUP_BULK_MAX)) {
+            let mut raw_ips = [[0; 16]; LOOKUP_BULK_MAX];
+            let mut valid = [false; LOOKUP_BULK_MAX];
+            for (i, pkt) in pkts.iter().enumerate() {
+                if let Some(ip) = ip_of(pkt) {
+                    raw_ips[i] = ip.octets();
+                    valid[i] = true;
+                }
+            }
+
+            found += self.lookup_bulk_raw(&mut raw_ips[..pkts.len()], next_hops);
+            for (next_hop, valid) in next_hops.iter_mut().zip(valid) {
+                if !valid && next_hop.take().is_some() {
+                    found -= 1;
+                }
+            }
+        }
+        found
+    }
+
+    /// Looks up at most [`LOOKUP_BULK_MAX`] addresses.
+    #[inline]
+    fn lookup_bulk_raw(&self, ips: &mut [[u8; 16]], next_hops: &mut [Option<u32>]) -> usize {
+        let mut raw_next_hops = [0; LOOKUP_BULK_MAX];
+        // the addresses aren't modified, the pointer is only mutable because of `uint8_t ips[][16]`
+        unsafe {
+            ffi::rte_lpm6_lookup_bulk_func(
+                self.as_ptr(),
+                ips.as_mut_ptr(),
+                raw_next_hops.as_mut_ptr(),
+                ips.len() as u32,
+            )
+        };
+
+        let mut found = 0;
+        for (next_hop, &raw) in next_hops.iter_mut().zip(&raw_next_hops[..ips.len()]) {
+            // misses are -1
+            *next_hop = u32::try_from(raw).ok();
+            found += usize::from(next_hop.is_some());
+        }
+        found
+    }
+}
+
+impl fmt::Debug for Lpm6 {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Lpm6").field("ptr", &self.ptr).finish()
+    }
+}
+
+impl Drop for Lpm6 {
+    #[inline]
+    fn drop(&mut self) {
+        unsafe { ffi::rte_lpm6_free(self.as_ptr()) }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use rte_test_macros::rte_test;
+
+    use super::*;
+
+    #[rte_test(mock_lcore)]
+    fn longest_prefix_wins() {
+        let mut lpm = Lpm::new("lpm_test", None, 16, 16).unwrap();
+        lpm.add(Ipv4Addr::new(10, 0, 0, 0), 8, 1).unwrap();
+        lpm.add(Ipv4Addr::new(10, 1, 0, 0), 16, 2).unwrap();
+        lpm.add(Ipv4Addr::new(10, 1, 2, 3), 32, 3).unwrap();
+        assert_eq!(lpm.add(Ipv4Addr::new(11, 0, 0, 0), 8, MAX_NEXT_HOP + 1), Err(Error(libc::EINVAL)));
+
+        let ips = [[10, 2, 0, 1], [10, 1, 9, 9], [10, 1, 2, 3], [192, 168, 0, 1]].map(Ipv4Addr::from);
+        let mut next_hops = [None; 4];
+        assert_eq!(lpm.lookup_bulk(&ips, &mut next_hops), 3);
+        assert_eq!(next_hops, [Some(1), Some(2), Some(3), None]);
+        assert_eq!(lpm.lookup(ips[1]), Some(2));
+
+        lpm.delete(Ipv4Addr::new(10, 1, 0, 0), 16).unwrap();
+        assert_eq!(lpm.lookup(ips[1]), Some(1));
+
+        // the name can be reused while the previous table still exists
+        let mut lpm6 = Lpm6::new("lpm_test", None, 16, 1 << 10).unwrap();
+        lpm6.add("2001:db8::".parse().unwrap(), 32, 7).unwrap();
+        let ips: [Ipv6Addr; 2] = ["2001:db8::1".parse().unwrap(), "2001:db9::1".parse().unwrap()];
+        let mut next_hops = [None; 2];
+        assert_eq!(lpm6.lookup_bulk(&ips, &mut next_hops), 1);
+        assert_eq!(next_hops, [Some(7), None]);
+    }
+}
@@ -1,8 +1,12 @@
-use std::ptr::NonNull;
+use std::{mem::MaybeUninit, os::raw::c_void, ptr::NonNull};
 
 use rte_error::ReturnValue as _;
 
-use crate::{mempool::MemoryPool, Result};
+use super::ptr::refcnt;
+use crate::{
+    mempool::{self, MemoryPool},
+    Result,
+};
 
 /// Trait for describing types that can be used as allocators for [`MBuf`](super::MBuf)s.
 ///
@@ -15,19 +19,84 @@ use crate::{mempool::MemoryPool, Result};
 pub trait Allocator {
     fn alloc(&self) -> Result<NonNull<ffi::rte_mbuf>>;
 
+    /// Allocates `mbufs.len()` mbufs at once.
+    ///
+    /// The allocation is all-or-nothing: when `Ok` is returned, every element of `mbufs` has been initialized,
+    /// otherwise none of the allocated mbufs are leaked and `mbufs` should be considered uninitialized.
+    ///
+    /// The default implementation calls [`Self::alloc`] once per mbuf.
+    fn alloc_bulk(&self, mbufs: &mut [MaybeUninit<NonNull<ffi::rte_mbuf>>]) -> Result<()> {
+        for i in 0..mbufs.len() {
+            match self.alloc() {
+                Ok(mbuf) => {
+                    mbufs[i].write(mbuf);
+                }
+                Err(err) => {
+                    for mbuf in &mbufs[..i] {
+                        unsafe { Self::free(mbuf.assume_init()) };
+                    }
+                    return Err(err);
+                }
+            }
+        }
+        Ok(())
+    }
+
     /// # Safety
     /// The caller must ensure `mbuf` points to a valid [`ffi::rte_mbuf`] that was allocated using [`Self::alloc`].
     unsafe fn clone(mbuf: NonNull<ffi::rte_mbuf>) -> Result<NonNull<ffi::rte_mbuf>>;
 
+    /// Creates another reference to the data of `mbuf`, used for cloning a [`SharedMBuf`](super::SharedMBuf).
+    ///
+    /// Unlike [`Self::clone`], the returned mbuf may share its data buffer with `mbuf`,
+    /// so neither of them may be mutated as long as both are alive.
+    ///
+    /// The default implementation creates a deep copy using [`Self::clone`].
+    ///
+    /// # Safety
+    /// The caller must ensure `mbuf` points to a valid [`ffi::rte_mbuf`] that was allocated using [`Self::alloc`].
+    unsafe fn clone_shared(mbuf: NonNull<ffi::rte_mbuf>) -> Result<NonNull<ffi::rte_mbuf>> {
+        Self::clone(mbuf)
+    }
+
     /// # Safety
     /// The caller must ensure `mbuf` points to a valid [`ffi::rte_mbuf`] that was allocated using [`Self::alloc`],
     /// and that the pointer is not used after this function has returned.
     unsafe fn free(mbuf: NonNull<ffi::rte_mbuf>);
+
+    /// Frees all of `mbufs` at once.
+    ///
+    /// The default implementation calls [`Self::free`] once per mbuf.
+    ///
+    /// # Safety
+    /// The caller must uphold the safety requirements of [`Self::free`] for each of the mbufs in `mbufs`.
+    unsafe fn free_bulk(mbufs: &[NonNull<ffi::rte_mbuf>]) {
+        for mbuf in mbufs {
+            Self::free(*mbuf);
+        }
+    }
 }
 
 impl<'a> Allocator for &'a MemoryPool {
     fn alloc(&self) -> Result<NonNull<ffi::rte_mbuf>> {
-        unsafe { ffi::_rte_pktmbuf_alloc(self.0.as_ptr()) }.rte_ok()
+        unsafe { ffi::_rte_pktmbuf_alloc(self.0.as_ptr()) }.rte_ok().map_err(|err| {
+            mempool::record_alloc_failure(self, 1);
+            err
+        })
+    }
+
+    /// Allocates all mbufs using a single call to [`rte_pktmbuf_alloc_bulk`](ffi::_rte_pktmbuf_alloc_bulk),
+    /// which dequeues them from the memory pool (or the current lcore's cache) in one go.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__mbuf_8h.html>
+    fn alloc_bulk(&self, mbufs: &mut [MaybeUninit<NonNull<ffi::rte_mbuf>>]) -> Result<()> {
+        unsafe { ffi::_rte_pktmbuf_alloc_bulk(self.0.as_ptr(), mbufs.as_mut_ptr().cast(), mbufs.len() as u32) }
+            .rte_ok()
+            .map_err(|err| {
+                mempool::record_alloc_failure(self, mbufs.len());
+                err
+            })?;
+        Ok(())
     }
 
     /// Clones this `MBuf` using [`rte_pktmbuf_copy`](ffi::rte_pktmbuf_copy).
@@ -43,13 +112,48 @@ impl<'a> Allocator for &'a MemoryPool {
     /// While a shallow clone is cheaper, it allows violating Rust borrow checker rules, by allowing safe code to create non-mutually-exclusive references to the same memory buffer.
     unsafe fn clone(mbuf: NonNull<ffi::rte_mbuf>) -> Result<NonNull<ffi::rte_mbuf>> {
         let mbuf = mbuf.as_ptr();
-        let ffi::rte_mbuf { data_len, pool, .. } = *mbuf;
-        ffi::rte_pktmbuf_copy(mbuf, pool, 0, data_len.into()).rte_ok()
+        let ffi::rte_mbuf { pkt_len, pool, .. } = *mbuf;
+        ffi::rte_pktmbuf_copy(mbuf, pool, 0, pkt_len).rte_ok()
+    }
+
+    /// Creates an indirect clone of `mbuf` (and of each of its segments) using [`rte_pktmbuf_clone`](ffi::rte_pktmbuf_clone),
+    /// allocated from the same memory pool, which shares the data buffer of `mbuf` rather than copying it.
+    ///
+    /// See also: <https://doc.dpdk.org/guides-21.08/prog_guide/mbuf_lib.html#direct-and-indirect-buffers>
+    unsafe fn clone_shared(mbuf: NonNull<ffi::rte_mbuf>) -> Result<NonNull<ffi::rte_mbuf>> {
+        let mbuf = mbuf.as_ptr();
+        ffi::rte_pktmbuf_clone(mbuf, (*mbuf).pool).rte_ok()
     }
 
     unsafe fn free(mbuf: NonNull<ffi::rte_mbuf>) {
         ffi::_rte_pktmbuf_free(mbuf.as_ptr());
     }
+
+    /// When all of `mbufs` are direct, non-segmented mbufs with a reference count of 1, which were allocated from the same
+    /// memory pool (the common case for received packets), they are returned to the pool with a single call to
+    /// [`rte_mempool_put_bulk`](ffi::_rte_mempool_put_bulk), skipping the per-mbuf checks done by `rte_pktmbuf_free`.
+    ///
+    /// Otherwise, falls back to [`rte_pktmbuf_free_bulk`](ffi::rte_pktmbuf_free_bulk).
+    unsafe fn free_bulk(mbufs: &[NonNull<ffi::rte_mbuf>]) {
+        let pool = match mbufs.first() {
+            Some(first) => first.as_ref().pool,
+            None => return,
+        };
+
+        let fast_free = mbufs.iter().all(|&mbuf| {
+            let ffi::rte_mbuf { pool: mbuf_pool, next, ol_flags, .. } = *mbuf.as_ptr();
+            mbuf_pool == pool
+                && next.is_null()
+                && ol_flags & (ffi::RTE_MBUF_F_INDIRECT | ffi::RTE_MBUF_F_EXTERNAL) == 0
+                && refcnt(mbuf) == 1
+        });
+
+        if fast_free {
+            ffi::_rte_mempool_put_bulk(pool, mbufs.as_ptr() as *const *mut c_void, mbufs.len() as u32);
+        } else {
+            ffi::rte_pktmbuf_free_bulk(mbufs.as_ptr() as *mut *mut ffi::rte_mbuf, mbufs.len() as u32);
+        }
+    }
 }
 
 #[cfg(any(test, feature = "test-utils"))]
@@ -84,6 +188,10 @@ mod test_pool {
                     let mbuf = mbuf.as_mut();
                     mbuf.buf_addr = data;
                     mbuf.buf_len = BUF_SIZE as u16;
+                    // like `rte_pktmbuf_reset_headroom`
+                    mbuf.data_off = (ffi::RTE_PKTMBUF_HEADROOM as usize).min(BUF_SIZE) as u16;
+                    mbuf.nb_segs = 1;
+                    mbuf.refcnt = 1;
                     mbuf.ol_flags &= ffi::RTE_MBUF_F_EXTERNAL;
                     mbuf.port = ffi::RTE_MBUF_PORT_INVALID as u16;
                 }
@@ -92,24 +200,73 @@ mod test_pool {
             }
         }
 
+        /// Clones each of the segments of `mbuf`, preserving the layout of the chain.
         unsafe fn clone(mbuf: NonNull<ffi::rte_mbuf>) -> Result<NonNull<ffi::rte_mbuf>> {
-            let mut clone = Self::alloc(&Self)?;
+            let head = Self::alloc(&Self)?;
+            let mut clone = head;
+            let mut seg = mbuf;
+
+            loop {
+                {
+                    let clone = clone.as_mut();
+                    let seg = seg.as_ref();
 
-            {
-                let clone = clone.as_mut();
-                let mbuf = mbuf.as_ref();
+                    // the segment's data fits at the same offset
+                    clone.data_off = seg.data_off;
+                    ptr::copy_nonoverlapping(
+                        seg.buf_addr.add(seg.data_off.into()),
+                        clone.buf_addr.add(clone.data_off.into()),
+                        seg.data_len.into(),
+                    );
+                    clone.data_len = seg.data_len;
+                }
+
+                seg = match NonNull::new(seg.as_ref().next) {
+                    Some(next) => next,
+                    None => break,
+                };
 
-                ptr::copy_nonoverlapping(mbuf.buf_addr, clone.buf_addr, mbuf.data_len.into());
-                clone.data_len = mbuf.data_len;
-                clone.pkt_len = mbuf.pkt_len;
+                let next = match Self::alloc(&Self) {
+                    Ok(next) => next,
+                    Err(err) => {
+                        Self::free(head);
+                        return Err(err);
+                    }
+                };
+                clone.as_mut().next = next.as_ptr();
+                clone = next;
             }
 
-            Ok(clone)
+            let head_mut = &mut *head.as_ptr();
+            head_mut.pkt_len = mbuf.as_ref().pkt_len;
+            head_mut.nb_segs = mbuf.as_ref().nb_segs;
+
+            Ok(head)
         }
 
+        /// Shares `mbuf` itself by incrementing the reference count of each of its segments,
+        /// similarly to `rte_pktmbuf_refcnt_update`.
+        unsafe fn clone_shared(mbuf: NonNull<ffi::rte_mbuf>) -> Result<NonNull<ffi::rte_mbuf>> {
+            let mut seg = mbuf.as_ptr();
+            while !seg.is_null() {
+                (*seg).refcnt += 1;
+                seg = (*seg).next;
+            }
+            Ok(mbuf)
+        }
+
+        /// Releases a reference to each segment of `mbuf`'s chain, deallocating the segments which are no longer referenced.
         unsafe fn free(mbuf: NonNull<ffi::rte_mbuf>) {
-            dealloc(mbuf.as_ref().buf_addr as _, Self::data_layout());
-            dealloc(mbuf.as_ptr() as _, Layout::new::<ffi::rte_mbuf>());
+            let mut seg = mbuf.as_ptr();
+            while !seg.is_null() {
+                let next = (*seg).next;
+                (*seg).refcnt -= 1;
+                if (*seg).refcnt == 0 {
+                    dealloc((*seg).buf_addr as _, Self::data_layout());
+                    dealloc(seg as _, Layout::new::<ffi::rte_mbuf>());
+                }
+                seg = next;
+            }
         }
     }
 }
@@ -0,0 +1,167 @@
+use std::{
+    fmt,
+    mem::{self, ManuallyDrop},
+    ops::{Deref, DerefMut},
+    ptr::{self, NonNull},
+    slice,
+};
+
+use arrayvec::ArrayVec;
+
+use super::{Allocator, MBuf};
+
+/// A fixed-capacity burst of [`MBuf`]s, which frees all of the mbufs it holds using a single call to
+/// [`Allocator::free_bulk`] (rather than freeing them one by one) when dropped.
+///
+/// `MBufBatch` dereferences into the underlying [`ArrayVec`], so it can be used anywhere an `ArrayVec` of mbufs is expected,
+/// e.g. it can be passed as-is to [`EthDev::rx_burst`] and [`EthDev::tx_burst`].
+///
+/// # Notice
+/// Mbufs removed from the batch by calling `ArrayVec` methods directly (e.g. `pop`, `truncate` or `clear`) are dropped
+/// (and freed) one at a time, use [`Self::free_all`] and [`Self::retain`] instead.
+///
+/// [`EthDev::rx_burst`]: crate::ethdev::EthDev::rx_burst
+/// [`EthDev::tx_burst`]: crate::ethdev::EthDev::tx_burst
+pub struct MBufBatch<A, const CAP: usize>(ArrayVec<MBuf<A>, CAP>)
+where
+    A: Allocator;
+
+impl<A, const CAP: usize> MBufBatch<A, CAP>
+where
+    A: Allocator,
+{
+    #[inline]
+    pub fn new() -> Self {
+        Self(ArrayVec::new())
+    }
+
+    /// Frees all mbufs in this batch using a single call to [`Allocator::free_bulk`], leaving it empty.
+    #[inline]
+    pub fn free_all(&mut self) {
+        let len = self.0.len();
+        if len == 0 {
+            return;
+        }
+
+        unsafe {
+            // set the length first, so that the mbufs aren't dropped again even if `free_bulk` panics
+            self.0.set_len(0);
+            // `MBuf` is a transparent wrapper around `NonNull<rte_mbuf>`
+            let mbufs = slice::from_raw_parts(self.0.as_ptr() as *const NonNull<ffi::rte_mbuf>, len);
+            A::free_bulk(mbufs);
+        }
+    }
+
+    /// Retains only the mbufs specified by the predicate, preserving their order.
+    ///
+    /// Unlike [`ArrayVec::retain`], all mbufs for which `f` returned `false` are freed using a single call to [`Allocator::free_bulk`].
+    pub fn retain<F>(&mut self, mut f: F)
+    where
+        F: FnMut(&mut MBuf<A>) -> bool,
+    {
+        let len = self.0.len();
+        let mut rejected = ArrayVec::<NonNull<ffi::rte_mbuf>, CAP>::new();
+
+        unsafe {
+            // if `f` panics, the remaining mbufs are leaked rather than freed twice
+            self.0.set_len(0);
+
+            let base = self.0.as_mut_ptr();
+            let mut kept = 0;
+
+            for i in 0..len {
+                let mbuf = base.add(i);
+                if f(&mut *mbuf) {
+                    if i != kept {
+                        ptr::copy_nonoverlapping(mbuf, base.add(kept), 1);
+                    }
+                    kept += 1;
+                } else {
+                    rejected.push_unchecked((*mbuf).ptr);
+                }
+            }
+
+            self.0.set_len(kept);
+            A::free_bulk(&rejected);
+        }
+    }
+
+    /// Returns the underlying [`ArrayVec`], whose mbufs will be dropped one at a time.
+    #[inline]
+    pub fn into_inner(self) -> ArrayVec<MBuf<A>, CAP> {
+        let mut this = ManuallyDrop::new(self);
+        mem::take(&mut this.0)
+    }
+}
+
+impl<A, const CAP: usize> Drop for MBufBatch<A, CAP>
+where
+    A: Allocator,
+{
+    #[inline]
+    fn drop(&mut self) {
+        self.free_all();
+    }
+}
+
+impl<A, const CAP: usize> Deref for MBufBatch<A, CAP>
+where
+    A: Allocator,
+{
+    type Target = ArrayVec<MBuf<A>, CAP>;
+
+    #[inline]
+    fn deref(&self) -> &Self::Target {
+        &self.0
+    }
+}
+
+impl<A, const CAP: usize> DerefMut for MBufBatch<A, CAP>
+where
+    A: Allocator,
+{
+    #[inline]
+    fn deref_mut(&mut self) -> &mut Self::Target {
+        &mut self.0
+    }
+}
+
+impl<A, const CAP: usize> Default for MBufBatch<A, CAP>
+where
+    A: Allocator,
+{
+    #[inline]
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<A, const CAP: usize> From<ArrayVec<MBuf<A>, CAP>> for MBufBatch<A, CAP>
+where
+    A: Allocator,
+{
+    #[inline]
+    fn from(mbufs: ArrayVec<MBuf<A>, CAP>) -> Self {
+        Self(mbufs)
+    }
+}
+
+impl<A, const CAP: usize> FromIterator<MBuf<A>> for MBufBatch<A, CAP>
+where
+    A: Allocator,
+{
+    /// Panics if the iterator yields more than `CAP` mbufs, see [`ArrayVec::from_iter`].
+    #[inline]
+    fn from_iter<I: IntoIterator<Item = MBuf<A>>>(iter: I) -> Self {
+        Self(iter.into_iter().collect())
+    }
+}
+
+impl<A, const CAP: usize> fmt::Debug for MBufBatch<A, CAP>
+where
+    A: Allocator,
+{
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_list().entries(self.0.iter()).finish()
+    }
+}
@@ -0,0 +1,159 @@
+use std::{marker::PhantomData, os::raw::c_void, ptr};
+
+use rte_error::Error;
+
+use super::{Allocator, MBuf, SharedMBuf};
+use crate::{mempool::MemoryPool, Result};
+
+/// The largest external buffer that can be attached to a single mbuf (`buf_len` is a `u16`),
+/// larger buffers are split over a chain of mbufs.
+pub const MAX_EXT_SEGMENT: usize = u16::MAX as usize;
+
+/// The shared info of an external buffer, along with the value that owns the buffer's memory,
+/// which is dropped (by [`free_ext_buf`]) once the last mbuf attached to the buffer is freed.
+struct ExtHolder {
+    shinfo: ffi::rte_mbuf_ext_shared_info,
+    _owner: Box<dyn Send>,
+}
+
+unsafe extern "C" fn free_ext_buf(_addr: *mut c_void, opaque: *mut c_void) {
+    drop(Box::from_raw(opaque as *mut ExtHolder));
+}
+
+/// Returns `true` if `shinfo` belongs to a buffer attached by [`SharedMBuf::from_external`],
+/// whose data must never be mutated (it's only `AsRef<[u8]>`).
+#[inline]
+pub(super) unsafe fn is_read_only(shinfo: *const ffi::rte_mbuf_ext_shared_info) -> bool {
+    (*shinfo).free_cb.map(|cb| cb as usize) == Some(free_ext_buf as usize)
+}
+
+/// Returns the IO address of `data`, and checks that its first and last bytes are IOVA-contiguous.
+///
+/// This is only a sanity check: in IOVA-as-VA mode every address translates to itself, and the translation doesn't
+/// prove that the memory is pinned or mapped for DMA, see [`SharedMBuf::from_external`].
+fn iova_of(data: &[u8]) -> Result<u64> {
+    const BAD_IOVA: u64 = u64::MAX;
+
+    let start = unsafe { ffi::rte_mem_virt2iova(data.as_ptr() as *const c_void) };
+    let last = unsafe { ffi::rte_mem_virt2iova(data.as_ptr().add(data.len() - 1) as *const c_void) };
+    if start == BAD_IOVA || last.wrapping_sub(start) != data.len() as u64 - 1 {
+        return Err(Error(libc::EFAULT));
+    }
+    Ok(start)
+}
+
+impl<'mempool> SharedMBuf<&'mempool MemoryPool> {
+    /// Creates a packet whose data is the memory of `buf`, without copying it, by attaching it to mbufs allocated from
+    /// `mempool` as an external buffer (see `rte_pktmbuf_attach_extbuf`). Buffers larger than [`MAX_EXT_SEGMENT`] are
+    /// split over a chain of mbufs.
+    ///
+    /// `buf` (the value owning the memory, e.g. an `Arc<[u8]>` of a pre-built response, or a handle to an application
+    /// arena) is kept alive until the last mbuf referencing its memory is freed, i.e. until the NIC (and any other
+    /// clone of the packet) is done with it, and is then dropped on whichever lcore frees that mbuf.
+    ///
+    /// Fails with `EFAULT` if the memory doesn't translate to IOVA-contiguous chunks of [`MAX_EXT_SEGMENT`], with
+    /// `EINVAL` if it's empty, and if `mempool` is exhausted.
+    ///
+    /// The packet is a [`SharedMBuf`], since the memory is only ever accessed immutably (it never becomes unique).
+    ///
+    /// See also: <https://doc.dpdk.org/guides-21.08/prog_guide/mbuf_lib.html>
+    ///
+    /// # Safety
+    /// The memory of `buf` is read by the NIC using DMA, so it must be DMA-able by any device the packet is sent on,
+    /// i.e. it must be DPDK-managed memory (e.g. allocated from DPDK's hugepages with `rte_malloc`), or memory that was
+    /// registered with `rte_extmem_register` and mapped with `rte_dev_dma_map`, and it must stay pinned (and mapped)
+    /// for as long as `buf` is alive.
+    pub unsafe fn from_external<T>(mempool: &'mempool MemoryPool, buf: T) -> Result<Self>
+    where
+        T: AsRef<[u8]> + Send + 'static,
+    {
+        // box the owner first, so that the memory it refers to doesn't move (if it's stored inline)
+        let owner = Box::new(buf);
+        let data: *const [u8] = (*owner).as_ref();
+        let data = &*data;
+        if data.is_empty() {
+            return Err(Error(libc::EINVAL));
+        }
+
+        let chunks =
+            data.chunks(MAX_EXT_SEGMENT).map(|chunk| Ok((chunk, iova_of(chunk)?))).collect::<Result<Vec<_>>>()?;
+        let nb_segs = u16::try_from(chunks.len()).map_err(|_| Error(libc::EINVAL))?;
+
+        // allocate all mbufs before attaching any of them, so that they are simply freed on failure
+        let mut mbufs = Vec::with_capacity(chunks.len());
+        for _ in &chunks {
+            mbufs.push(MBuf::<&'mempool MemoryPool> { ptr: mempool.alloc()?, _marker: PhantomData });
+        }
+
+        let holder = Box::into_raw(Box::new(ExtHolder {
+            shinfo: ffi::rte_mbuf_ext_shared_info {
+                free_cb: Some(free_ext_buf),
+                // one reference for each mbuf attached to the buffer
+                refcnt: nb_segs,
+                ..Default::default()
+            },
+            _owner: owner,
+        }));
+        (*holder).shinfo.fcb_opaque = holder as *mut c_void;
+
+        let mut segs = mbufs.into_iter().zip(chunks).map(|(mbuf, (chunk, iova))| {
+            let len = chunk.len() as u16;
+            ffi::_rte_pktmbuf_attach_extbuf(
+                mbuf.as_raw(),
+                chunk.as_ptr() as *mut c_void,
+                iova,
+                len,
+                ptr::addr_of_mut!((*holder).shinfo),
+            );
+            (*mbuf.as_raw()).data_len = len;
+            (*mbuf.as_raw()).pkt_len = len.into();
+            mbuf
+        });
+
+        let mut head = segs.next().unwrap();
+        let mut remaining = nb_segs - 1;
+        while let Some(seg) = segs.next() {
+            remaining -= 1;
+            if let Err(seg) = head.append(seg) {
+                // the segments that haven't been attached will never release their reference to the buffer, so the
+                // buffer (or rather, its owner) is only freed along with the partial chain, and with `seg`
+                (*holder).shinfo.refcnt -= remaining;
+                drop((seg, head));
+                return Err(Error(libc::EINVAL));
+            }
+        }
+
+        Ok(head.into_shared())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::sync::Arc;
+
+    use rte_test_macros::rte_test;
+
+    use super::*;
+
+    #[rte_test(mock_lcore)]
+    fn attach_external_buffer() {
+        let mempool = MemoryPool::new("extbuf_test_pool", 16, 0, 0, 0, None).unwrap();
+        let payload: Arc<[u8]> = (0..MAX_EXT_SEGMENT + 100).map(|i| i as u8).collect();
+
+        // the memory of the test isn't DMA-able, but the packet is never sent
+        let pkt = unsafe { SharedMBuf::from_external(&mempool, payload.clone()) }.unwrap();
+        assert_eq!(pkt.nb_segs(), 2);
+        assert_eq!(pkt.pkt_len(), payload.len());
+        assert!(pkt.segments().flatten().eq(payload.iter()));
+        assert!(!pkt.is_unique());
+
+        let clone = pkt.try_clone().unwrap();
+        drop(pkt);
+        assert_eq!(Arc::strong_count(&payload), 2);
+
+        // the owner is dropped along with the last mbuf referencing its memory
+        drop(clone);
+        assert_eq!(Arc::strong_count(&payload), 1);
+        assert_eq!(mempool.get_in_use_count(), 0);
+    }
+}
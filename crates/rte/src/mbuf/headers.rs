@@ -0,0 +1,167 @@
+use std::mem;
+
+use rte_error::Error;
+
+use super::{Allocator, MBuf};
+use crate::Result;
+
+/// A protocol header that can be pushed onto (or popped off) the front of a packet, in place,
+/// see [`MBuf::push_header`].
+///
+/// # Safety
+/// The type must be valid for any bit pattern, have no padding bytes, and have an alignment of 1
+/// (e.g. a `#[repr(C, packed)]` struct of byte arrays), since packet data isn't aligned.
+pub unsafe trait Header: Copy {}
+
+unsafe impl<const N: usize> Header for [u8; N] {}
+
+/// Methods for adding and removing data at either end of a packet without copying it,
+/// equivalent to `rte_pktmbuf_prepend`, `rte_pktmbuf_adj` and `rte_pktmbuf_trim`.
+///
+/// `headroom` and `prepend` (and the header methods based on them) only deal with the first segment,
+/// and `trim` with the last segment.
+impl<A> MBuf<A>
+where
+    A: Allocator,
+{
+    /// Returns the number of bytes that can be prepended to the packet, see [`Self::prepend`].
+    #[inline]
+    pub fn headroom(&self) -> usize {
+        unsafe { self.ptr.as_ref() }.data_off.into()
+    }
+
+    /// Returns the number of bytes that can be appended to the last segment (i.e. to the first segment of a
+    /// contiguous packet), see [`Self::extend_from_slice`].
+    #[inline]
+    pub fn tailroom(&self) -> usize {
+        let ffi::rte_mbuf { data_off, data_len, buf_len, .. } = unsafe { *self.last_segment() };
+        usize::from(buf_len) - usize::from(data_off) - usize::from(data_len)
+    }
+
+    /// Extends the packet by `len` bytes at its front, by moving the start of its data into the headroom, and returns
+    /// the new bytes (whose contents are unspecified), e.g. for writing an encapsulation header.
+    ///
+    /// Fails with `ENOSPC` if there isn't enough headroom.
+    #[inline]
+    pub fn prepend(&mut self, len: usize) -> Result<&mut [u8]> {
+        let len16 = u16::try_from(len).map_err(|_| Error(libc::ENOSPC))?;
+        let data = unsafe { ffi::_rte_pktmbuf_prepend(self.as_raw(), len16) };
+        if data.is_null() {
+            return Err(Error(libc::ENOSPC));
+        }
+        Ok(&mut self[..len])
+    }
+
+    /// Removes `len` bytes from the front of the packet (e.g. a decapsulated header), by moving the start of its data
+    /// forward.
+    ///
+    /// Fails with `EINVAL` if the first segment is shorter than `len`.
+    #[inline]
+    pub fn adj(&mut self, len: usize) -> Result<()> {
+        if len > self.len() {
+            return Err(Error(libc::EINVAL));
+        }
+        unsafe {
+            let mbuf = self.as_raw();
+            (*mbuf).data_off += len as u16;
+            (*mbuf).data_len -= len as u16;
+            (*mbuf).pkt_len -= len as u32;
+        }
+        Ok(())
+    }
+
+    /// Removes `len` bytes from the end of the packet (e.g. a trailer).
+    ///
+    /// Fails with `EINVAL` if the last segment is shorter than `len`.
+    #[inline]
+    pub fn trim(&mut self, len: usize) -> Result<()> {
+        unsafe {
+            let last = self.last_segment();
+            if len > (*last).data_len.into() {
+                return Err(Error(libc::EINVAL));
+            }
+            (*last).data_len -= len as u16;
+            (*self.as_raw()).pkt_len -= len as u32;
+        }
+        Ok(())
+    }
+
+    /// Returns the header at the front of the packet, if the first segment is long enough.
+    #[inline]
+    pub fn header<H: Header>(&self) -> Option<&H> {
+        self.get(..mem::size_of::<H>()).map(|bytes| unsafe { &*(bytes.as_ptr() as *const H) })
+    }
+
+    /// Returns the header at the front of the packet mutably, see [`Self::header`].
+    #[inline]
+    pub fn header_mut<H: Header>(&mut self) -> Option<&mut H> {
+        self.get_mut(..mem::size_of::<H>()).map(|bytes| unsafe { &mut *(bytes.as_mut_ptr() as *mut H) })
+    }
+
+    /// Prepends `header` to the packet in place (i.e. without copying the rest of the packet), see [`Self::prepend`],
+    /// and returns it, e.g. for updating fields that depend on the rest of the packet.
+    #[inline]
+    pub fn push_header<H: Header>(&mut self, header: H) -> Result<&mut H> {
+        let bytes = self.prepend(mem::size_of::<H>())?;
+        let ptr = bytes.as_mut_ptr() as *mut H;
+        unsafe {
+            ptr.write(header);
+            Ok(&mut *ptr)
+        }
+    }
+
+    /// Removes the header at the front of the packet, and returns it, see [`Self::adj`].
+    #[inline]
+    pub fn pop_header<H: Header>(&mut self) -> Option<H> {
+        let header = *self.header::<H>()?;
+        // the first segment is long enough
+        let _ = self.adj(mem::size_of::<H>());
+        Some(header)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::mbuf::GlobalAllocator;
+
+    #[repr(C, packed)]
+    #[derive(Debug, Clone, Copy, PartialEq, Eq)]
+    struct Vlan {
+        tpid: [u8; 2],
+        tci: [u8; 2],
+    }
+
+    unsafe impl Header for Vlan {}
+
+    #[test]
+    fn push_and_pop_headers() {
+        let mut mbuf = MBuf::<GlobalAllocator>::new_with_data(b"\x08\x00payload!");
+        let (headroom, tailroom) = (mbuf.headroom(), mbuf.tailroom());
+        let data = mbuf.as_ptr();
+
+        let vlan = Vlan { tpid: 0x8100u16.to_be_bytes(), tci: 42u16.to_be_bytes() };
+        mbuf.push_header(vlan).unwrap().tci = 7u16.to_be_bytes();
+        mbuf.push_header(*b"\xaa\xbb").unwrap();
+        assert_eq!(mbuf.headroom(), headroom - 6);
+        assert_eq!(&mbuf[..], b"\xaa\xbb\x81\x00\x00\x07\x08\x00payload!");
+        assert_eq!(mbuf.pkt_len(), 16);
+
+        assert_eq!(mbuf.pop_header::<[u8; 2]>(), Some(*b"\xaa\xbb"));
+        assert_eq!(mbuf.pop_header::<Vlan>(), Some(Vlan { tpid: [0x81, 0x00], tci: [0, 7] }));
+        // the data hasn't moved
+        assert_eq!(mbuf.as_ptr(), data);
+
+        mbuf.trim(1).unwrap();
+        assert_eq!(&mbuf[..], b"\x08\x00payload");
+        assert_eq!(mbuf.tailroom(), tailroom + 1);
+        assert_eq!(mbuf.trim(10), Err(Error(libc::EINVAL)));
+        assert_eq!(mbuf.adj(10), Err(Error(libc::EINVAL)));
+        assert_eq!(mbuf.prepend(headroom + 1), Err(Error(libc::ENOSPC)));
+
+        mbuf.adj(9).unwrap();
+        assert!(mbuf.is_empty());
+        assert_eq!(mbuf.pkt_len(), 0);
+        assert_eq!(mbuf.pop_header::<Vlan>(), None);
+    }
+}
@@ -1,9 +1,12 @@
 use std::{marker::PhantomData, ptr::NonNull};
 
-use ffi::_bindgen_ty_13::{RTE_MBUF_L2_LEN_BITS, RTE_MBUF_L3_LEN_BITS};
+use ffi::_bindgen_ty_13::{
+    RTE_MBUF_L2_LEN_BITS, RTE_MBUF_L3_LEN_BITS, RTE_MBUF_L4_LEN_BITS, RTE_MBUF_OUTL2_LEN_BITS, RTE_MBUF_OUTL3_LEN_BITS,
+    RTE_MBUF_TSO_SEGSZ_BITS,
+};
 
-use super::ptr::AsPtr;
-use crate::flags::PktTxOffload;
+use super::{ptr::AsPtr, timestamp};
+use crate::flags::{PacketType, PktRxOffload, PktTxOffload};
 
 /// A struct that only allows running [`MetadataExt`] methods on an [`MBuf`].
 ///
@@ -20,7 +23,126 @@ pub struct MetadataPart<'a> {
     pub(super) _marker: PhantomData<&'a mut ()>,
 }
 
+/// The result of the checksum validation done by the NIC for a received packet, based on its RX offload flags.
+///
+/// See also: [`PktRxOffload`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ChecksumStatus {
+    /// No information about the checksum is available.
+    Unknown,
+    /// The checksum in the packet is wrong.
+    Bad,
+    /// The checksum in the packet is valid.
+    Good,
+    /// The checksum in the packet is not correct, but the integrity of the data has been verified
+    /// (e.g. when the checksum is computed by the NIC on transmission of a forwarded packet).
+    IntegrityVerified,
+}
+
+impl ChecksumStatus {
+    #[inline]
+    fn from_flags(flags: PktRxOffload, bad: PktRxOffload, good: PktRxOffload) -> Self {
+        match (flags.contains(bad), flags.contains(good)) {
+            (false, false) => ChecksumStatus::Unknown,
+            (true, false) => ChecksumStatus::Bad,
+            (false, true) => ChecksumStatus::Good,
+            (true, true) => ChecksumStatus::IntegrityVerified,
+        }
+    }
+
+    /// Returns `true` if the packet doesn't need to be dropped (or have its checksum validated in software).
+    #[inline]
+    pub fn is_valid(self) -> bool {
+        matches!(self, ChecksumStatus::Good | ChecksumStatus::IntegrityVerified)
+    }
+}
+
+/// Methods for reading and writing the metadata of an mbuf.
+///
+/// The getters read fields that are filled by the driver when a packet is received (given that the corresponding
+/// offloads, e.g. `RTE_ETH_RX_OFFLOAD_RSS_HASH`, have been enabled), which allows classifying packets without parsing
+/// their headers in software.
 pub trait MetadataExt: AsPtr {
+    /// Returns the RX offload flags, from the [`ol_flags`](https://doc.dpdk.org/api-2.2/structrte__mbuf.html#a319d580a6e1ef13692631d7b0d6d5c98) field.
+    #[inline]
+    fn rx_ol_flags(&self) -> PktRxOffload {
+        PktRxOffload::from_bits_truncate(unsafe { self.as_ptr().as_ref().ol_flags })
+    }
+
+    /// Returns the packet type, as recognized by the NIC.
+    ///
+    /// See also: [`EthDev::supported_ptypes`](crate::ethdev::EthDev::supported_ptypes), which lists the packet types
+    /// a device can recognize.
+    #[inline]
+    fn packet_type(&self) -> PacketType {
+        PacketType::from_bits_truncate(unsafe { self.as_ptr().as_ref().__bindgen_anon_1.packet_type })
+    }
+
+    /// Returns the RSS hash computed by the NIC, if it has been set.
+    #[inline]
+    fn rss_hash(&self) -> Option<u32> {
+        self.rx_ol_flags()
+            .contains(PktRxOffload::RSS_HASH)
+            .then(|| unsafe { self.as_ptr().as_ref().__bindgen_anon_2.hash.rss })
+    }
+
+    /// Returns the value set by a [`FlowRule::mark`](crate::ethdev::flow::FlowRule::mark) action of the flow rule
+    /// that matched the packet, if any.
+    #[inline]
+    fn flow_mark(&self) -> Option<u32> {
+        self.rx_ol_flags()
+            .contains(PktRxOffload::FDIR_ID)
+            .then(|| unsafe { self.as_ptr().as_ref().__bindgen_anon_2.hash.fdir.hi })
+    }
+
+    /// Returns the VLAN TCI of the packet (in host byte order), if the NIC reported it (`RTE_MBUF_F_RX_VLAN`), whether
+    /// or not the VLAN header was also stripped from the packet's data (see [`PktRxOffload::VLAN_STRIPPED`]).
+    #[inline]
+    fn vlan_tci(&self) -> Option<u16> {
+        self.rx_ol_flags().contains(PktRxOffload::VLAN).then(|| unsafe { self.as_ptr().as_ref().vlan_tci })
+    }
+
+    /// Returns the outer VLAN TCI of the packet (in host byte order), if it was a QinQ packet whose outer VLAN TCI was
+    /// reported by the NIC (`RTE_MBUF_F_RX_QINQ`), whether or not the outer VLAN header was also stripped from the
+    /// packet's data (see [`PktRxOffload::QINQ_STRIPPED`]).
+    #[inline]
+    fn vlan_tci_outer(&self) -> Option<u16> {
+        self.rx_ol_flags().contains(PktRxOffload::QINQ).then(|| unsafe { self.as_ptr().as_ref().vlan_tci_outer })
+    }
+
+    /// Returns the time at which the packet was received, in the device's clock, if the NIC has set it
+    /// (which requires `RTE_ETH_RX_OFFLOAD_TIMESTAMP`, and that [`register_rx_timestamp`] has been called).
+    ///
+    /// See also: [`ClockSync`](crate::latency::ClockSync), which converts it to TSC cycles.
+    ///
+    /// [`register_rx_timestamp`]: super::register_rx_timestamp
+    #[inline]
+    fn rx_timestamp(&self) -> Option<u64> {
+        timestamp::rx_timestamp(unsafe { self.as_ptr().as_ref() })
+    }
+
+    /// Returns the status of the IP header checksum, as validated by the NIC.
+    #[inline]
+    fn ip_checksum(&self) -> ChecksumStatus {
+        ChecksumStatus::from_flags(self.rx_ol_flags(), PktRxOffload::IP_CKSUM_BAD, PktRxOffload::IP_CKSUM_GOOD)
+    }
+
+    /// Returns the status of the L4 (TCP, UDP or SCTP) checksum, as validated by the NIC.
+    #[inline]
+    fn l4_checksum(&self) -> ChecksumStatus {
+        ChecksumStatus::from_flags(self.rx_ol_flags(), PktRxOffload::L4_CKSUM_BAD, PktRxOffload::L4_CKSUM_GOOD)
+    }
+
+    /// Returns the status of the outer L4 checksum of a tunneled packet, as validated by the NIC.
+    #[inline]
+    fn outer_l4_checksum(&self) -> ChecksumStatus {
+        ChecksumStatus::from_flags(
+            self.rx_ol_flags(),
+            PktRxOffload::OUTER_L4_CKSUM_BAD,
+            PktRxOffload::OUTER_L4_CKSUM_GOOD,
+        )
+    }
+
     /// Sets the [`l2_len`](https://doc.dpdk.org/api-2.2/structrte__mbuf.html#aa25a7c259438b9eba28bcedc33846620) field.
     #[inline]
     fn set_l2_len(&mut self, len: u64) {
@@ -41,6 +163,69 @@ pub trait MetadataExt: AsPtr {
         }
     }
 
+    /// Sets the [`l4_len`](https://doc.dpdk.org/api-2.2/structrte__mbuf.html) field,
+    /// i.e. the length of the L4 header (required for TSO).
+    #[inline]
+    fn set_l4_len(&mut self, len: u64) {
+        assert!(len < 1 << RTE_MBUF_L4_LEN_BITS);
+        unsafe {
+            let mbuf = self.as_ptr().as_mut();
+            mbuf.__bindgen_anon_3.__bindgen_anon_1.set_l4_len(len);
+        }
+    }
+
+    /// Sets the [`tso_segsz`](https://doc.dpdk.org/api-2.2/structrte__mbuf.html) field,
+    /// i.e. the maximum size of the payload of each of the segments created by TSO.
+    #[inline]
+    fn set_tso_segsz(&mut self, segsz: u64) {
+        assert!(segsz < 1 << RTE_MBUF_TSO_SEGSZ_BITS);
+        unsafe {
+            let mbuf = self.as_ptr().as_mut();
+            mbuf.__bindgen_anon_3.__bindgen_anon_1.set_tso_segsz(segsz);
+        }
+    }
+
+    /// Sets the `outer_l2_len` field, i.e. the length of the outer L2 header of a tunneled packet.
+    #[inline]
+    fn set_outer_l2_len(&mut self, len: u64) {
+        assert!(len < 1 << RTE_MBUF_OUTL2_LEN_BITS);
+        unsafe {
+            let mbuf = self.as_ptr().as_mut();
+            mbuf.__bindgen_anon_3.__bindgen_anon_1.set_outer_l2_len(len);
+        }
+    }
+
+    /// Sets the `outer_l3_len` field, i.e. the length of the outer L3 header of a tunneled packet.
+    #[inline]
+    fn set_outer_l3_len(&mut self, len: u64) {
+        assert!(len < 1 << RTE_MBUF_OUTL3_LEN_BITS);
+        unsafe {
+            let mbuf = self.as_ptr().as_mut();
+            mbuf.__bindgen_anon_3.__bindgen_anon_1.set_outer_l3_len(len);
+        }
+    }
+
+    /// Sets the [`vlan_tci`](https://doc.dpdk.org/api-2.2/structrte__mbuf.html) field (in host byte order),
+    /// which is inserted by the NIC when the [`PktTxOffload::VLAN`] flag is enabled.
+    #[inline]
+    fn set_vlan_tci(&mut self, tci: u16) {
+        unsafe { self.as_ptr().as_mut().vlan_tci = tci };
+    }
+
+    /// Sets the `vlan_tci_outer` field (in host byte order),
+    /// which is inserted by the NIC as the outer VLAN when the [`PktTxOffload::QINQ`] flag is enabled.
+    #[inline]
+    fn set_vlan_tci_outer(&mut self, tci: u16) {
+        unsafe { self.as_ptr().as_mut().vlan_tci_outer = tci };
+    }
+
+    /// Sets the packet type, e.g. after parsing the headers in software when the NIC doesn't recognize them,
+    /// as required by [GRO](crate::gro).
+    #[inline]
+    fn set_packet_type(&mut self, ptype: PacketType) {
+        unsafe { self.as_ptr().as_mut().__bindgen_anon_1.packet_type = ptype.bits() };
+    }
+
     /// Enables (bitwise-or) the given flags on the [`ol_flags`](https://doc.dpdk.org/api-2.2/structrte__mbuf.html#a319d580a6e1ef13692631d7b0d6d5c98) field.
     ///
     /// See also: [`PktTxOffload`].
@@ -1,6 +1,15 @@
 mod allocator;
+mod batch;
+mod ext;
+mod headers;
 mod metadata;
+mod prefetch;
+mod private;
 mod ptr;
+mod segments;
+mod send;
+mod shared;
+mod timestamp;
 
 use std::{
     fmt,
@@ -11,12 +20,25 @@ use std::{
     slice,
 };
 
+use arrayvec::ArrayVec;
+
 #[cfg(any(test, feature = "test-utils"))]
 pub use self::allocator::GlobalAllocator;
 pub use self::{
     allocator::Allocator,
-    metadata::{MetadataExt, MetadataPart},
+    batch::MBufBatch,
+    ext::MAX_EXT_SEGMENT,
+    headers::Header,
+    metadata::{ChecksumStatus, MetadataExt, MetadataPart},
+    prefetch::{prefetch0, BurstIter, PrefetchExt, DEFAULT_PREFETCH_DISTANCE},
+    private::PrivateData,
+    ptr::OwnedMBuf,
+    segments::Segments,
+    send::SendMBuf,
+    shared::SharedMBuf,
+    timestamp::register_rx_timestamp,
 };
+use crate::Result;
 
 /// This struct is a Rust-y wrapper around a pointer to DPDK's [`rte_mbuf`](ffi::rte_mbuf) struct.
 ///
@@ -31,14 +53,16 @@ pub use self::{
 /// An `MBuf` is, memory-wise, a transparent wrapper around the [`NonNull`] type, which means it can be safely transmuted with a raw pointer, `*mut rte_mbuf`, so long as that pointer is known to be non-zero.
 ///
 /// # Thread safety
-/// While in the future, it might be possible to mark `MBuf` as `Send`, right now it implements neither `Sync` nor `Send`,
-/// which means it cannot be used in a threaded context in any way.
+/// `MBuf` implements neither `Sync` nor `Send`, so it cannot be moved to another thread by accident.
 /// ```rust
 /// # use static_assertions::assert_not_impl_any;
 /// # use rte::{mempool::MemoryPool, mbuf::MBuf};
 /// assert_not_impl_any!(MBuf<&MemoryPool>: Send, Sync);
 /// ```
 ///
+/// Handing mbufs over to other lcores (e.g. from an RX lcore to worker lcores) is done explicitly, either by wrapping
+/// them in a [`SendMBuf`], or by enqueueing them on a [`Ring`](crate::ring::Ring).
+///
 /// # Allocators
 /// `MBuf` is generic over a type implementing the [`Allocator`] trait.
 ///
@@ -51,8 +75,11 @@ pub use self::{
 /// # See also
 /// - The DPDK documentation on the [Mbuf Library](https://doc.dpdk.org/guides-21.08/prog_guide/mbuf_lib.html).
 ///
-/// # Implementation notes
-/// - This wrapper completely ignores all but the first segment of an mbuf.
+/// # Multi-segment mbufs
+/// Dereferencing an `MBuf` (as well as the [`Vec`]-like methods, e.g. [`MBuf::extend_from_slice`]) only accesses the
+/// data of its first segment. Chained mbufs (e.g. as received with `RTE_ETH_RX_OFFLOAD_SCATTER`, or when using LRO) can be
+/// handled with [`MBuf::segments`], [`MBuf::read`], [`MBuf::append`] and [`MBuf::linearize`], while [`MBuf::pkt_len`]
+/// returns the length of the whole packet.
 #[repr(transparent)]
 pub struct MBuf<A>
 where
@@ -77,6 +104,14 @@ where
     pub fn new_with_data<T: AsRef<[u8]>>(data: T) -> Self {
         Self::new_with_provider_and_data(&A::default(), data)
     }
+
+    /// Fill the remaining capacity of `mbufs` with empty mbufs, allocated with a default [allocator](Allocator).
+    ///
+    /// See [`Self::alloc_bulk_with_provider`].
+    #[inline]
+    pub fn alloc_bulk<const CAP: usize>(mbufs: &mut ArrayVec<Self, CAP>) -> Result<()> {
+        Self::alloc_bulk_with_provider(&A::default(), mbufs)
+    }
 }
 
 impl<A> MBuf<A>
@@ -98,6 +133,28 @@ where
         mbuf.extend_from_slice(data.as_ref());
         mbuf
     }
+
+    /// Fill the remaining capacity of `mbufs` (i.e. `CAP - mbufs.len()`) with empty mbufs allocated with
+    /// the given [allocator](Allocator), using a single call to [`Allocator::alloc_bulk`].
+    ///
+    /// The allocation is all-or-nothing: if the allocator cannot provide enough mbufs, an error is returned
+    /// and `mbufs` is left unchanged.
+    #[inline]
+    pub fn alloc_bulk_with_provider<const CAP: usize>(provider: &A, mbufs: &mut ArrayVec<Self, CAP>) -> Result<()> {
+        let old_len = mbufs.len();
+
+        unsafe {
+            // `MBuf` is a transparent wrapper around `NonNull<rte_mbuf>`, see also `EthDev::rx_burst`
+            let spare_cap = slice::from_raw_parts_mut(
+                mbufs.as_mut_ptr().add(old_len) as *mut MaybeUninit<NonNull<ffi::rte_mbuf>>,
+                mbufs.remaining_capacity(),
+            );
+            provider.alloc_bulk(spare_cap)?;
+            mbufs.set_len(CAP);
+        }
+
+        Ok(())
+    }
 }
 
 impl<A> MBuf<A>
@@ -164,23 +221,32 @@ where
         }
     }
 
+    /// Returns the spare capacity of the last segment, i.e. the bytes after its data.
     fn spare_capacity_mut(&mut self) -> &mut [MaybeUninit<u8>] {
         unsafe {
-            let ffi::rte_mbuf { buf_addr, data_off, data_len, buf_len, .. } = *self.ptr.as_ref();
+            let ffi::rte_mbuf { buf_addr, data_off, data_len, buf_len, .. } = *self.last_segment();
             let spare_cap = buf_addr.add(data_off.into()).add(data_len.into());
-            let buf_end = spare_cap.add(buf_len.into());
-            slice::from_raw_parts_mut(spare_cap as _, spare_cap.offset_from(buf_end) as usize)
+            let buf_end = buf_addr.add(buf_len.into());
+            slice::from_raw_parts_mut(spare_cap as _, buf_end.offset_from(spare_cap) as usize)
         }
     }
 
-    unsafe fn set_len(&mut self, len: usize) {
-        debug_assert!(len <= self.capacity());
-        let mbuf = self.ptr.as_ptr();
-        (*mbuf).data_len = len as u16;
-        (*mbuf).pkt_len = len as u32;
+    /// Grows the last segment by `additional` bytes (of its spare capacity), adjusting the total packet length
+    /// accordingly.
+    unsafe fn grow_last_segment(&mut self, additional: usize) {
+        debug_assert!(additional <= self.tailroom());
+        let seg = self.last_segment();
+        (*seg).data_len += additional as u16;
+        (*self.ptr.as_ptr()).pkt_len += additional as u32;
     }
 
     /// See [`Vec::extend_from_slice`].
+    ///
+    /// The data is appended to the last segment of a chained packet (like `rte_pktmbuf_append`), which must have
+    /// enough spare capacity, see [`Self::tailroom`].
+    ///
+    /// # Panics
+    /// Panics if `other` doesn't fit in the spare capacity of the last segment.
     #[inline]
     pub fn extend_from_slice(&mut self, other: &[u8]) {
         // SAFETY: &[T] and &[MaybeUninit<T>] have the same layout
@@ -188,7 +254,7 @@ where
 
         self.spare_capacity_mut()[..other.len()].copy_from_slice(uninit_other);
         unsafe {
-            self.set_len(self.len() + other.len());
+            self.grow_last_segment(other.len());
         }
     }
 
@@ -292,3 +358,128 @@ pub fn alloc_mbufs<const CAP: usize, B: AsRef<[u8]>, I: IntoIterator<Item = B>>(
 ) -> arrayvec::ArrayVec<MBuf<GlobalAllocator>, CAP> {
     iter.into_iter().map(MBuf::<GlobalAllocator>::new_with_data).collect()
 }
+
+#[cfg(test)]
+mod tests {
+    use arrayvec::ArrayVec;
+
+    use super::{ChecksumStatus, GlobalAllocator, MBuf, MBufBatch, MetadataExt};
+    use crate::flags::{PacketType, PktRxOffload};
+
+    #[test]
+    fn alloc_bulk_fills_remaining_capacity() {
+        let mut mbufs = ArrayVec::<MBuf<GlobalAllocator>, 4>::new();
+        mbufs.push(MBuf::new_with_data(b"\x00\x01"));
+
+        MBuf::alloc_bulk(&mut mbufs).unwrap();
+
+        assert!(mbufs.is_full());
+        assert_eq!(&mbufs[0][..], b"\x00\x01");
+        assert!(mbufs[1..].iter().all(|mbuf| mbuf.is_empty()));
+    }
+
+    #[test]
+    fn chained_segments() {
+        let mut mbuf = MBuf::<GlobalAllocator>::new_with_data(b"\x00\x01\x02");
+        mbuf.append(MBuf::new_with_data(b"\x03\x04")).unwrap();
+        mbuf.append(MBuf::new_with_data(b"\x05")).unwrap();
+
+        assert_eq!(mbuf.nb_segs(), 3);
+        assert_eq!(mbuf.pkt_len(), 6);
+        assert!(!mbuf.is_contiguous());
+        assert_eq!(mbuf.segments().collect::<Vec<_>>(), [&b"\x00\x01\x02"[..], b"\x03\x04", b"\x05"]);
+
+        let mut buf = [0; 4];
+        assert_eq!(mbuf.read(1, &mut buf[..2]), Some(&b"\x01\x02"[..]));
+        assert_eq!(mbuf.read(2, &mut buf), Some(&b"\x02\x03\x04\x05"[..]));
+        assert_eq!(mbuf.read(3, &mut buf), None);
+
+        mbuf.extend_from_slice(b"\xff");
+        assert_eq!(mbuf.pkt_len(), 7);
+        assert_eq!(mbuf.segments().last(), Some(&b"\x05\xff"[..]));
+
+        mbuf.linearize().unwrap();
+        assert!(mbuf.is_contiguous());
+        assert_eq!(mbuf.pkt_len(), 7);
+        assert_eq!(&mbuf[..], b"\x00\x01\x02\x03\x04\x05\xff");
+    }
+
+    #[test]
+    fn shared_clones() {
+        let shared = MBuf::<GlobalAllocator>::new_with_data(b"\x00\x01").into_shared();
+        let clone = shared.clone();
+
+        assert_eq!(&clone[..], b"\x00\x01");
+        assert_eq!(clone.as_slice().as_ptr(), shared.as_slice().as_ptr());
+
+        let shared = shared.try_into_unique().unwrap_err();
+        drop(clone);
+
+        let mut mbuf = shared.try_into_unique().unwrap();
+        mbuf[0] = 0xff;
+        assert_eq!(&mbuf[..], b"\xff\x01");
+    }
+
+    #[test]
+    fn batch_retain_keeps_order() {
+        let mut batch: MBufBatch<GlobalAllocator, 4> =
+            [b"\x00", b"\x01", b"\x02", b"\x03"].into_iter().map(MBuf::new_with_data).collect();
+
+        batch.retain(|mbuf| mbuf[0] % 2 == 1);
+
+        assert_eq!(batch.len(), 2);
+        assert_eq!(&batch[0][..], b"\x01");
+        assert_eq!(&batch[1][..], b"\x03");
+
+        batch.free_all();
+        assert!(batch.is_empty());
+    }
+
+    #[test]
+    fn rx_metadata() {
+        let mbuf = MBuf::<GlobalAllocator>::new_with_data(b"\x00");
+        assert_eq!(mbuf.rss_hash(), None);
+        assert_eq!(mbuf.vlan_tci(), None);
+        assert_eq!(mbuf.ip_checksum(), ChecksumStatus::Unknown);
+
+        unsafe {
+            let raw = &mut *mbuf.ptr.as_ptr();
+            raw.ol_flags = (PktRxOffload::RSS_HASH | PktRxOffload::VLAN | PktRxOffload::IP_CKSUM_MASK).bits()
+                | PktRxOffload::L4_CKSUM_BAD.bits();
+            raw.__bindgen_anon_2.hash.rss = 0xdead_beef;
+            raw.vlan_tci = 100;
+            raw.__bindgen_anon_1.packet_type =
+                (PacketType::L2_ETHER_VLAN | PacketType::L3_IPV4_EXT_UNKNOWN | PacketType::L4_TCP).bits();
+        }
+
+        assert_eq!(mbuf.rss_hash(), Some(0xdead_beef));
+        assert_eq!(mbuf.vlan_tci(), Some(100));
+        assert_eq!(mbuf.vlan_tci_outer(), None);
+        assert_eq!(mbuf.ip_checksum(), ChecksumStatus::IntegrityVerified);
+        assert_eq!(mbuf.l4_checksum(), ChecksumStatus::Bad);
+        assert_eq!(mbuf.packet_type().l4(), PacketType::L4_TCP);
+        assert!(mbuf.packet_type().is_ipv4());
+        assert!(!mbuf.packet_type().is_tunnel());
+    }
+
+    #[test]
+    fn tx_offload_metadata() {
+        let mut mbuf = MBuf::<GlobalAllocator>::new_with_data(b"\x00");
+        mbuf.set_l2_len(14);
+        mbuf.set_l3_len(20);
+        mbuf.set_l4_len(20);
+        mbuf.set_tso_segsz(1460);
+        mbuf.set_outer_l2_len(14);
+        mbuf.set_outer_l3_len(40);
+        mbuf.set_vlan_tci(100);
+
+        let raw = unsafe { mbuf.ptr.as_ref() };
+        let tx_offload = unsafe { &raw.__bindgen_anon_3.__bindgen_anon_1 };
+        assert_eq!(
+            (tx_offload.l2_len(), tx_offload.l3_len(), tx_offload.l4_len(), tx_offload.tso_segsz()),
+            (14, 20, 20, 1460)
+        );
+        assert_eq!((tx_offload.outer_l2_len(), tx_offload.outer_l3_len()), (14, 40));
+        assert_eq!(raw.vlan_tci, 100);
+    }
+}
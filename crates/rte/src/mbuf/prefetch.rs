@@ -0,0 +1,162 @@
+use std::mem;
+
+use super::{Allocator, MBuf};
+
+/// The default prefetch distance used by [`PrefetchExt`], i.e. how many packets ahead of the one being processed
+/// have their data prefetched (their mbuf headers are prefetched twice as far ahead).
+pub const DEFAULT_PREFETCH_DISTANCE: usize = 4;
+
+/// Prefetches the cache line containing `ptr` into all levels of the cache, equivalent to `rte_prefetch0`.
+///
+/// This is only a hint, `ptr` doesn't have to be valid.
+#[inline(always)]
+pub fn prefetch0<T>(ptr: *const T) {
+    #[cfg(target_arch = "x86_64")]
+    unsafe {
+        use std::arch::x86_64::{_mm_prefetch, _MM_HINT_T0};
+        _mm_prefetch(ptr as *const i8, _MM_HINT_T0)
+    }
+
+    #[cfg(target_arch = "aarch64")]
+    unsafe {
+        std::arch::asm!("prfm pldl1keep, [{}]", in(reg) ptr, options(nostack, readonly, preserves_flags))
+    }
+
+    #[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+    let _ = ptr;
+}
+
+impl<A> MBuf<A>
+where
+    A: Allocator,
+{
+    /// Prefetches the first cache line of the mbuf's header (which holds the fields needed for accessing its data,
+    /// as well as the RX metadata).
+    #[inline(always)]
+    pub fn prefetch_header(&self) {
+        prefetch0(self.ptr.as_ptr());
+    }
+
+    /// Prefetches the first cache line of the mbuf's data, which reads the mbuf's header
+    /// (so it should already be in the cache, see [`Self::prefetch_header`]).
+    #[inline(always)]
+    pub fn prefetch_data(&self) {
+        prefetch0(self.data_ptr());
+    }
+}
+
+/// An iterator over a burst of packets, which prefetches the packets ahead of the one it yields,
+/// see [`PrefetchExt::iter_prefetched`].
+#[derive(Debug)]
+pub struct BurstIter<'a, A>
+where
+    A: Allocator,
+{
+    pkts: &'a mut [MBuf<A>],
+    distance: usize,
+}
+
+impl<'a, A> BurstIter<'a, A>
+where
+    A: Allocator,
+{
+    /// Creates an iterator over `pkts`, prefetching the data of the packet `distance` positions ahead of the one
+    /// being yielded, and the header of the packet `2 * distance` positions ahead.
+    ///
+    /// The packets within that distance of the start of the burst are prefetched right away.
+    #[inline]
+    pub fn new(pkts: &'a mut [MBuf<A>], distance: usize) -> Self {
+        pkts.iter().take(2 * distance).for_each(MBuf::prefetch_header);
+        pkts.iter().take(distance).for_each(MBuf::prefetch_data);
+        Self { pkts, distance }
+    }
+}
+
+impl<'a, A> Iterator for BurstIter<'a, A>
+where
+    A: Allocator,
+{
+    type Item = &'a mut MBuf<A>;
+
+    #[inline(always)]
+    fn next(&mut self) -> Option<Self::Item> {
+        let (pkt, rest) = mem::take(&mut self.pkts).split_first_mut()?;
+        if self.distance > 0 {
+            // the packets before these ones have been prefetched already
+            if let Some(ahead) = rest.get(2 * self.distance - 1) {
+                ahead.prefetch_header();
+            }
+            if let Some(ahead) = rest.get(self.distance - 1) {
+                ahead.prefetch_data();
+            }
+        }
+        self.pkts = rest;
+        Some(pkt)
+    }
+
+    #[inline]
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        (self.pkts.len(), Some(self.pkts.len()))
+    }
+}
+
+impl<A> ExactSizeIterator for BurstIter<'_, A> where A: Allocator {}
+
+/// Processing bursts of packets (e.g. as filled by [`EthDev::rx_burst`]) while prefetching the packets ahead,
+/// hiding the cache misses of the first access to each packet's header and data.
+///
+/// ```rust,ignore
+/// let mut pkts = ArrayVec::<_, 32>::new();
+/// unsafe { dev.rx_burst(0, &mempool, &mut pkts) };
+/// pkts.for_each_prefetched(DEFAULT_PREFETCH_DISTANCE, |pkt| classify(pkt));
+/// ```
+///
+/// [`EthDev::rx_burst`]: crate::ethdev::EthDev::rx_burst
+pub trait PrefetchExt<A>
+where
+    A: Allocator,
+{
+    /// Returns an iterator over the packets, see [`BurstIter::new`].
+    fn iter_prefetched(&mut self, distance: usize) -> BurstIter<'_, A>;
+
+    /// Calls `f` on each of the packets in order, see [`Self::iter_prefetched`].
+    #[inline]
+    fn for_each_prefetched<F>(&mut self, distance: usize, f: F)
+    where
+        F: FnMut(&mut MBuf<A>),
+    {
+        self.iter_prefetched(distance).for_each(f)
+    }
+}
+
+impl<A> PrefetchExt<A> for [MBuf<A>]
+where
+    A: Allocator,
+{
+    #[inline]
+    fn iter_prefetched(&mut self, distance: usize) -> BurstIter<'_, A> {
+        BurstIter::new(self, distance)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use arrayvec::ArrayVec;
+
+    use super::*;
+    use crate::mbuf::{alloc_mbufs, GlobalAllocator};
+
+    #[test]
+    fn iterates_in_order() {
+        let mut pkts: ArrayVec<MBuf<GlobalAllocator>, 16> = alloc_mbufs((0..11u8).map(|i| [i]));
+
+        for distance in [0, 1, 4, 32] {
+            let iter = pkts.iter_prefetched(distance);
+            assert_eq!(iter.len(), 11);
+            assert!(iter.map(|pkt| pkt[0]).eq(0..11));
+        }
+
+        pkts.for_each_prefetched(DEFAULT_PREFETCH_DISTANCE, |pkt| pkt[0] *= 2);
+        assert!(pkts.iter().map(|pkt| pkt[0]).eq((0..11).map(|i| i * 2)));
+    }
+}
@@ -0,0 +1,78 @@
+use std::mem;
+
+use super::MBuf;
+use crate::mempool::{MemoryPool, TypedMemoryPool};
+
+/// Per-packet metadata stored in the private area of each mbuf (right after its `rte_mbuf` header),
+/// see [`TypedMemoryPool`].
+///
+/// The private area isn't reset when an mbuf is allocated, i.e. it holds whatever was written to it during the mbuf's
+/// previous use (or zeroes, for an mbuf that was never used), so it should be initialized when a packet is received,
+/// e.g. with `*pkt.private_mut() = Default::default()`.
+///
+/// # Safety
+/// The type must be valid for any bit pattern (including all zeroes), and have an alignment of at most
+/// `RTE_MBUF_PRIV_ALIGN` (8 bytes).
+pub unsafe trait PrivateData: Copy {}
+
+unsafe impl PrivateData for u8 {}
+unsafe impl PrivateData for u16 {}
+unsafe impl PrivateData for u32 {}
+unsafe impl PrivateData for u64 {}
+unsafe impl<T: PrivateData, const N: usize> PrivateData for [T; N] {}
+
+/// Access to the private area of mbufs allocated from a [`TypedMemoryPool`], which is as cheap as accessing a field of
+/// the `rte_mbuf` itself.
+impl<'mempool, P> MBuf<&'mempool TypedMemoryPool<P>>
+where
+    P: PrivateData,
+{
+    /// Returns the packet's metadata.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__mbuf_8h.html>
+    #[inline]
+    pub fn private(&self) -> &P {
+        unsafe { &*self.private_ptr() }
+    }
+
+    /// Returns the packet's metadata mutably.
+    #[inline]
+    pub fn private_mut(&mut self) -> &mut P {
+        unsafe { &mut *self.private_ptr() }
+    }
+
+    /// Like `rte_mbuf_to_priv`.
+    #[inline]
+    fn private_ptr(&self) -> *mut P {
+        unsafe { (self.ptr.as_ptr() as *mut u8).add(mem::size_of::<ffi::rte_mbuf>()) as *mut P }
+    }
+
+    /// Forgets the type of the packet's metadata, e.g. for transmitting the packet, or for enqueueing it on a
+    /// [`Ring`](crate::ring::Ring). The metadata is kept, see [`MBuf::into_typed`].
+    #[inline]
+    pub fn into_untyped(self) -> MBuf<&'mempool MemoryPool> {
+        let ptr = self.ptr;
+        mem::forget(self);
+        MBuf { ptr, _marker: Default::default() }
+    }
+}
+
+impl<'mempool> MBuf<&'mempool MemoryPool> {
+    /// Gives access to the packet's metadata, e.g. for a packet received from a queue that was set up with `pool`,
+    /// or dequeued from a [`Ring`](crate::ring::Ring).
+    ///
+    /// Fails (and returns the packet) if the packet wasn't allocated from `pool`.
+    #[inline]
+    pub fn into_typed<P>(self, pool: &'mempool TypedMemoryPool<P>) -> Result<MBuf<&'mempool TypedMemoryPool<P>>, Self>
+    where
+        P: PrivateData,
+    {
+        // the pool is in the first cache line of the mbuf, along with the fields used for processing the packet anyway
+        if unsafe { self.ptr.as_ref() }.pool != pool.0.as_ptr() {
+            return Err(self);
+        }
+        let ptr = self.ptr;
+        mem::forget(self);
+        Ok(MBuf { ptr, _marker: Default::default() })
+    }
+}
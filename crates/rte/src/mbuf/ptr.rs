@@ -1,11 +1,33 @@
-use std::ptr::NonNull;
+use std::{
+    ptr::{addr_of, NonNull},
+    sync::atomic::{AtomicU16, Ordering},
+};
 
-use super::{metadata::MetadataPart, Allocator, MBuf};
+use super::{metadata::MetadataPart, Allocator, MBuf, SharedMBuf};
 
 pub trait AsPtr {
     fn as_ptr(&self) -> NonNull<ffi::rte_mbuf>;
 }
 
+/// Types that own a reference to an mbuf, which they release (using [`Self::Allocator`]) when dropped.
+///
+/// Allows handing the ownership of arrays of such types over to DPDK, e.g. by [`EthDev::tx_burst`](crate::ethdev::EthDev::tx_burst).
+///
+/// # Safety
+/// Implementors must be `#[repr(transparent)]` wrappers around a [`NonNull<ffi::rte_mbuf>`], which can be forgotten
+/// (i.e. not dropped) once the mbuf has been handed over to DPDK.
+pub unsafe trait OwnedMBuf {
+    type Allocator: Allocator;
+}
+
+unsafe impl<A: Allocator> OwnedMBuf for MBuf<A> {
+    type Allocator = A;
+}
+
+unsafe impl<A: Allocator> OwnedMBuf for SharedMBuf<A> {
+    type Allocator = A;
+}
+
 impl<A: Allocator> AsPtr for MBuf<A> {
     #[inline]
     fn as_ptr(&self) -> NonNull<ffi::rte_mbuf> {
@@ -19,3 +41,13 @@ impl AsPtr for MetadataPart<'_> {
         self.ptr
     }
 }
+
+/// Reads the reference count of the given mbuf, equivalent to `rte_mbuf_refcnt_read`.
+///
+/// # Safety
+/// `mbuf` must point to a valid [`ffi::rte_mbuf`].
+#[inline]
+pub(crate) unsafe fn refcnt(mbuf: NonNull<ffi::rte_mbuf>) -> u16 {
+    // DPDK updates the reference count atomically, so it has to be read atomically as well
+    (*(addr_of!((*mbuf.as_ptr()).refcnt) as *const AtomicU16)).load(Ordering::Relaxed)
+}
@@ -0,0 +1,192 @@
+use std::{iter::FusedIterator, marker::PhantomData, mem, ptr, slice};
+
+use rte_error::Error;
+
+use super::{Allocator, MBuf};
+use crate::Result;
+
+/// Returns the data of a single segment as a slice.
+///
+/// # Safety
+/// `seg` must point to a valid [`ffi::rte_mbuf`] segment, whose data outlives `'a`.
+#[inline]
+unsafe fn segment_data<'a>(seg: *const ffi::rte_mbuf) -> &'a [u8] {
+    let ffi::rte_mbuf { buf_addr, data_off, data_len, .. } = *seg;
+    slice::from_raw_parts((buf_addr as *const u8).add(data_off.into()), data_len.into())
+}
+
+/// Methods for handling multi-segment (chained) mbufs.
+///
+/// Notice that dereferencing an `MBuf` (and all methods based on it) only ever accesses the first segment.
+impl<A> MBuf<A>
+where
+    A: Allocator,
+{
+    /// Returns the total length of the packet, i.e. the sum of the lengths of all of its segments.
+    #[inline]
+    pub fn pkt_len(&self) -> usize {
+        unsafe { self.ptr.as_ref() }.pkt_len as usize
+    }
+
+    /// Returns the number of segments this packet is made of.
+    #[inline]
+    pub fn nb_segs(&self) -> u16 {
+        unsafe { self.ptr.as_ref() }.nb_segs
+    }
+
+    /// Returns `true` if the whole packet is stored in a single segment, i.e. if `self[..]` is the entire packet.
+    #[inline]
+    pub fn is_contiguous(&self) -> bool {
+        unsafe { self.ptr.as_ref() }.next.is_null()
+    }
+
+    /// Returns an iterator over the data of each of this packet's segments, without copying.
+    #[inline]
+    pub fn segments(&self) -> Segments<'_> {
+        Segments { next: self.ptr.as_ptr(), _marker: PhantomData }
+    }
+
+    pub(super) fn last_segment(&self) -> *mut ffi::rte_mbuf {
+        let mut seg = self.ptr.as_ptr();
+        unsafe {
+            while !(*seg).next.is_null() {
+                seg = (*seg).next;
+            }
+        }
+        seg
+    }
+
+    /// Chains `tail` at the end of this packet, equivalent to [`rte_pktmbuf_chain`](https://doc.dpdk.org/api-21.08/rte__mbuf_8h.html).
+    ///
+    /// Returns `tail` back if the resulting packet would have more than [`u16::MAX`] segments.
+    #[inline]
+    pub fn append(&mut self, tail: MBuf<A>) -> std::result::Result<(), MBuf<A>> {
+        unsafe {
+            let head = self.ptr.as_ptr();
+            let tail_seg = tail.ptr.as_ptr();
+
+            let nb_segs = match (*head).nb_segs.checked_add((*tail_seg).nb_segs) {
+                Some(nb_segs) => nb_segs,
+                None => return Err(tail),
+            };
+
+            (*self.last_segment()).next = tail_seg;
+            (*head).nb_segs = nb_segs;
+            (*head).pkt_len += (*tail_seg).pkt_len;
+            (*tail_seg).pkt_len = (*tail_seg).data_len.into();
+        }
+
+        // the chain (and thus `tail`) will be freed along with `self`
+        mem::forget(tail);
+        Ok(())
+    }
+
+    /// Copies the data of all segments into the first one, and frees the rest of the chain, so that `self[..]` is
+    /// the entire packet. Equivalent to `rte_pktmbuf_linearize`.
+    ///
+    /// Does nothing if the packet is already [contiguous](Self::is_contiguous), returns an error (with `ENOBUFS`)
+    /// if there isn't enough room in the first segment, in which case the packet is left unchanged.
+    pub fn linearize(&mut self) -> Result<()> {
+        if self.is_contiguous() {
+            return Ok(());
+        }
+
+        let head = self.ptr.as_ptr();
+        let pkt_len = self.pkt_len();
+
+        if pkt_len > self.capacity() {
+            return Err(Error(libc::ENOBUFS));
+        }
+
+        unsafe {
+            let rest = (*head).next;
+
+            let mut dst = self.data_ptr().add(self.data_len());
+            let mut seg = rest;
+            while !seg.is_null() {
+                let data = segment_data(seg);
+                ptr::copy_nonoverlapping(data.as_ptr(), dst, data.len());
+                dst = dst.add(data.len());
+                seg = (*seg).next;
+            }
+
+            (*head).next = ptr::null_mut();
+            (*head).nb_segs = 1;
+            (*head).data_len = pkt_len as u16;
+
+            A::free(ptr::NonNull::new_unchecked(rest));
+        }
+
+        Ok(())
+    }
+
+    /// Reads `buf.len()` bytes of the packet starting at `offset`, even if they span across multiple segments.
+    ///
+    /// If the requested bytes are all stored in a single segment, a slice pointing into it is returned
+    /// and `buf` is left untouched, otherwise the bytes are copied into `buf`. This makes it possible to read headers
+    /// without copying in the (common) case where they're stored contiguously. Equivalent to `rte_pktmbuf_read`.
+    ///
+    /// Returns `None` if the packet is shorter than `offset + buf.len()`.
+    pub fn read<'a>(&'a self, offset: usize, buf: &'a mut [u8]) -> Option<&'a [u8]> {
+        let len = buf.len();
+        if offset.checked_add(len)? > self.pkt_len() {
+            return None;
+        }
+
+        let mut segments = self.segments();
+        let mut offset = offset;
+
+        // skip to the segment where the requested range starts
+        let first = loop {
+            let seg = segments.next()?;
+            if offset < seg.len() || (len == 0 && offset == seg.len()) {
+                break seg;
+            }
+            offset -= seg.len();
+        };
+
+        if let Some(data) = first.get(offset..offset + len) {
+            return Some(data);
+        }
+
+        let mut copied = first.len() - offset;
+        buf[..copied].copy_from_slice(&first[offset..]);
+
+        for seg in segments {
+            if copied == len {
+                break;
+            }
+            let n = seg.len().min(len - copied);
+            buf[copied..copied + n].copy_from_slice(&seg[..n]);
+            copied += n;
+        }
+
+        Some(&*buf)
+    }
+}
+
+/// An iterator over the data of each segment of an [`MBuf`], see [`MBuf::segments`].
+#[derive(Clone)]
+pub struct Segments<'a> {
+    next: *const ffi::rte_mbuf,
+    _marker: PhantomData<&'a [u8]>,
+}
+
+impl<'a> Iterator for Segments<'a> {
+    type Item = &'a [u8];
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.next.is_null() {
+            return None;
+        }
+
+        unsafe {
+            let seg = self.next;
+            self.next = (*seg).next;
+            Some(segment_data(seg))
+        }
+    }
+}
+
+impl FusedIterator for Segments<'_> {}
@@ -0,0 +1,60 @@
+use std::fmt;
+
+use super::{Allocator, MBuf};
+
+/// An owned [`MBuf`] that can be sent to another thread (e.g. from an RX lcore to a worker lcore).
+///
+/// `MBuf` itself is not `Send`, so that mbufs are not moved between threads by accident. Wrapping an `MBuf`
+/// in a `SendMBuf` makes handing it over explicit: the sending thread gives up its ownership of the mbuf,
+/// and the receiving thread retrieves it using [`Self::into_inner`].
+///
+/// For moving bursts of mbufs between lcores, prefer using a [`Ring`](crate::ring::Ring).
+///
+/// ```rust
+/// # use static_assertions::assert_impl_all;
+/// # use rte::{mempool::MemoryPool, mbuf::SendMBuf};
+/// assert_impl_all!(SendMBuf<&MemoryPool>: Send);
+/// ```
+#[repr(transparent)]
+pub struct SendMBuf<A>(MBuf<A>)
+where
+    A: Allocator;
+
+// # Safety
+// An `MBuf` is the sole owner of its mbuf (and data buffer), so it can be moved to another thread
+// as long as its allocator can free it from that thread.
+unsafe impl<A> Send for SendMBuf<A> where A: Allocator + Send {}
+
+impl<A> SendMBuf<A>
+where
+    A: Allocator,
+{
+    #[inline]
+    pub fn new(mbuf: MBuf<A>) -> Self {
+        Self(mbuf)
+    }
+
+    #[inline]
+    pub fn into_inner(self) -> MBuf<A> {
+        self.0
+    }
+}
+
+impl<A> From<MBuf<A>> for SendMBuf<A>
+where
+    A: Allocator,
+{
+    #[inline]
+    fn from(mbuf: MBuf<A>) -> Self {
+        Self::new(mbuf)
+    }
+}
+
+impl<A> fmt::Debug for SendMBuf<A>
+where
+    A: Allocator,
+{
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_tuple("SendMBuf").field(&self.0).finish()
+    }
+}
@@ -0,0 +1,171 @@
+use std::{
+    fmt,
+    marker::PhantomData,
+    mem,
+    ops::Deref,
+    ptr::{self, NonNull},
+    sync::atomic::{AtomicU16, Ordering},
+};
+
+use super::{ext, ptr::refcnt, Allocator, MBuf};
+use crate::Result;
+
+/// A shared, read-only reference to a packet, which is cheap to clone, meant for sending the same packet to multiple
+/// destinations (e.g. for port mirroring, multicast fan-out or packet capture).
+///
+/// Unlike cloning an [`MBuf`], which creates a deep copy of the packet, cloning a `SharedMBuf` uses
+/// [`Allocator::clone_shared`], which (for [`MemoryPool`]) creates an [indirect mbuf] that points to
+/// the same data buffer as the original, using [`rte_pktmbuf_clone`](ffi::rte_pktmbuf_clone).
+///
+/// Since the data buffer may be shared, a `SharedMBuf` only allows immutable access to the packet: it dereferences
+/// into a `&MBuf<A>` (and never into a `&mut MBuf<A>`). An `MBuf` can be retrieved back using [`Self::try_into_unique`],
+/// once all other references to the data buffer have been dropped.
+///
+/// Dropping a `SharedMBuf` releases its reference to the data buffer, which is freed once the last reference has been dropped.
+///
+/// [`MemoryPool`]: crate::mempool::MemoryPool
+/// [indirect mbuf]: https://doc.dpdk.org/guides-21.08/prog_guide/mbuf_lib.html#direct-and-indirect-buffers
+#[repr(transparent)]
+pub struct SharedMBuf<A>
+where
+    A: Allocator,
+{
+    ptr: NonNull<ffi::rte_mbuf>,
+    _marker: PhantomData<A>,
+}
+
+/// Returns `true` if `seg` holds the only reference to its data buffer.
+#[inline]
+unsafe fn is_unique_segment(seg: NonNull<ffi::rte_mbuf>) -> bool {
+    if refcnt(seg) != 1 {
+        return false;
+    }
+
+    let ffi::rte_mbuf { ol_flags, buf_addr, priv_size, shinfo, .. } = *seg.as_ptr();
+
+    if ol_flags & ffi::RTE_MBUF_F_EXTERNAL != 0 {
+        // the data buffer is an external buffer, shared through its `rte_mbuf_ext_shared_info`
+        if ext::is_read_only(shinfo) {
+            return false;
+        }
+        let shinfo_refcnt = ptr::addr_of!((*shinfo).refcnt) as *const AtomicU16;
+        (*shinfo_refcnt).load(Ordering::Relaxed) == 1
+    } else if ol_flags & ffi::RTE_MBUF_F_INDIRECT != 0 {
+        // the data buffer belongs to a direct mbuf, whose reference count is the number of mbufs attached to it,
+        // see `rte_mbuf_from_indirect`
+        let direct = (buf_addr as *mut u8).sub(mem::size_of::<ffi::rte_mbuf>() + usize::from(priv_size));
+        refcnt(NonNull::new_unchecked(direct as *mut ffi::rte_mbuf)) == 1
+    } else {
+        true
+    }
+}
+
+impl<A> SharedMBuf<A>
+where
+    A: Allocator,
+{
+    /// Creates another reference to this packet, without copying its data, see [`Allocator::clone_shared`].
+    #[inline]
+    pub fn try_clone(&self) -> Result<Self> {
+        let ptr = unsafe { A::clone_shared(self.ptr) }?;
+        Ok(Self { ptr, _marker: PhantomData })
+    }
+
+    /// Returns `true` if this is the only reference to the data of all of the packet's segments,
+    /// i.e. if [`Self::try_into_unique`] would succeed.
+    #[inline]
+    pub fn is_unique(&self) -> bool {
+        let mut seg = Some(self.ptr);
+        while let Some(s) = seg {
+            unsafe {
+                if !is_unique_segment(s) {
+                    return false;
+                }
+                seg = NonNull::new((*s.as_ptr()).next);
+            }
+        }
+        true
+    }
+
+    /// Converts this reference back into a (mutable) [`MBuf`] if it is the only remaining reference to the packet's data,
+    /// or returns it back otherwise.
+    #[inline]
+    pub fn try_into_unique(self) -> std::result::Result<MBuf<A>, Self> {
+        if self.is_unique() {
+            let ptr = self.ptr;
+            mem::forget(self);
+            Ok(MBuf { ptr, _marker: PhantomData })
+        } else {
+            Err(self)
+        }
+    }
+}
+
+impl<A> MBuf<A>
+where
+    A: Allocator,
+{
+    /// Converts this mbuf into a [`SharedMBuf`], which can be cheaply cloned (without copying the packet's data),
+    /// but only allows immutable access to the packet.
+    #[inline]
+    pub fn into_shared(self) -> SharedMBuf<A> {
+        let ptr = self.ptr;
+        mem::forget(self);
+        SharedMBuf { ptr, _marker: PhantomData }
+    }
+}
+
+impl<A> From<MBuf<A>> for SharedMBuf<A>
+where
+    A: Allocator,
+{
+    #[inline]
+    fn from(mbuf: MBuf<A>) -> Self {
+        mbuf.into_shared()
+    }
+}
+
+impl<A> Deref for SharedMBuf<A>
+where
+    A: Allocator,
+{
+    type Target = MBuf<A>;
+
+    #[inline]
+    fn deref(&self) -> &Self::Target {
+        // SAFETY: both types are transparent wrappers around the same pointer, and `&MBuf` only allows reading the packet
+        unsafe { &*(self as *const Self as *const MBuf<A>) }
+    }
+}
+
+impl<A> Clone for SharedMBuf<A>
+where
+    A: Allocator,
+{
+    #[track_caller]
+    #[inline]
+    fn clone(&self) -> Self {
+        self.try_clone().expect("Failed to allocate shared mbuf clone")
+    }
+}
+
+impl<A> Drop for SharedMBuf<A>
+where
+    A: Allocator,
+{
+    #[inline]
+    fn drop(&mut self) {
+        unsafe {
+            A::free(self.ptr);
+        }
+    }
+}
+
+impl<A> fmt::Debug for SharedMBuf<A>
+where
+    A: Allocator,
+{
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        <[u8] as fmt::Debug>::fmt(self, f)
+    }
+}
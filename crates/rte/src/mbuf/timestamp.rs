@@ -0,0 +1,43 @@
+use std::sync::atomic::{AtomicI32, AtomicU64, Ordering};
+
+use rte_error::ReturnValue as _;
+
+use crate::Result;
+
+/// The offset of the RX timestamp dynamic field within the mbuf, or -1 if it hasn't been registered.
+static OFFSET: AtomicI32 = AtomicI32::new(-1);
+/// The `ol_flags` bit set by drivers on packets whose RX timestamp is valid, or 0 if it hasn't been registered.
+static FLAG: AtomicU64 = AtomicU64::new(0);
+
+/// Registers (or looks up, if it's already registered) the mbuf dynamic field in which drivers store the RX
+/// timestamp of each packet, in the device's clock (see [`EthDev::read_clock`]), when `RTE_ETH_RX_OFFLOAD_TIMESTAMP`
+/// is enabled, which is read by [`MetadataExt::rx_timestamp`].
+///
+/// Must be called after configuring devices (which registers the field), and before reading timestamps.
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__mbuf__dyn_8h.html>
+///
+/// [`EthDev::read_clock`]: crate::ethdev::EthDev::read_clock
+/// [`MetadataExt::rx_timestamp`]: super::MetadataExt::rx_timestamp
+#[inline]
+pub fn register_rx_timestamp() -> Result<()> {
+    let mut offset = -1;
+    let mut flag = 0;
+    unsafe { ffi::rte_mbuf_dyn_rx_timestamp_register(&mut offset, &mut flag) }.rte_ok()?;
+    OFFSET.store(offset, Ordering::Relaxed);
+    // publishes the offset to the threads which observe the flag
+    FLAG.store(flag, Ordering::Release);
+    Ok(())
+}
+
+/// Returns the RX timestamp of `mbuf`, if it has been set by the driver.
+#[inline(always)]
+pub(super) fn rx_timestamp(mbuf: &ffi::rte_mbuf) -> Option<u64> {
+    let flag = FLAG.load(Ordering::Acquire);
+    if flag == 0 || mbuf.ol_flags & flag == 0 {
+        return None;
+    }
+    // the flag is stored (with release ordering) after the offset, so the offset is known once the flag is
+    let offset = OFFSET.load(Ordering::Relaxed) as usize;
+    Some(unsafe { (mbuf as *const ffi::rte_mbuf as *const u8).add(offset).cast::<u64>().read_unaligned() })
+}
@@ -0,0 +1,454 @@
+mod telemetry;
+mod typed;
+
+use std::{
+    ffi::{CStr, CString},
+    fmt,
+    mem::{size_of_val, ManuallyDrop},
+    ops::Deref,
+    ptr::{addr_of, NonNull},
+    slice,
+};
+
+use arrayvec::ArrayVec;
+use once_cell::sync::OnceCell;
+use rte_error::{Error, ReturnValue as _};
+
+pub(crate) use self::telemetry::record_alloc_failure;
+pub use self::{
+    telemetry::{AllocFailures, MempoolStats, MempoolTelemetry, WatermarkEvent, WatermarkMonitor, MAX_TRACKED_POOLS},
+    typed::TypedMemoryPool,
+};
+use crate::{ethdev::EthDev, lcore, mbuf::MBuf, memory::SocketId, Result};
+
+/// The mempool driver ("ops") that stores a memory pool's free objects.
+///
+/// The (per-lcore) cache in front of the driver absorbs most allocations, so the driver mostly matters for pools
+/// whose cache is often empty (or full), e.g. pools that are filled by one lcore and drained by another.
+///
+/// See also: <https://doc.dpdk.org/guides-21.08/prog_guide/mempool_lib.html>
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum MempoolOps {
+    /// The default driver that DPDK was built with (`RTE_MBUF_DEFAULT_MEMPOOL_OPS`), normally `ring_mp_mc`.
+    Default,
+    /// The driver selected with the `--mbuf-pool-ops-name` EAL option, or the platform's hardware mempool driver
+    /// (e.g. on OCTEON), or [`Self::Default`] (see `rte_mbuf_best_mempool_ops`).
+    Platform,
+    /// A ring that is safe for multiple producers and consumers.
+    RingMpMc,
+    /// A ring for a single producer and a single consumer, i.e. pools that are only ever used by a single lcore.
+    RingSpSc,
+    /// A ring for multiple producers (freeing lcores) and a single consumer (allocating lcore).
+    RingMpSc,
+    /// A ring for a single producer (freeing lcore) and multiple consumers (allocating lcores).
+    RingSpMc,
+    /// A (spinlock-protected) stack, which reuses the most recently freed objects while they are still cached.
+    Stack,
+    /// A lock-free stack.
+    LfStack,
+    /// Stores objects in contiguous buckets, to allocate objects that are close together in memory.
+    Bucket,
+    /// Any other driver, by name.
+    Custom(&'static CStr),
+}
+
+impl Default for MempoolOps {
+    fn default() -> Self {
+        Self::Default
+    }
+}
+
+impl MempoolOps {
+    /// Returns the driver's name, as registered with DPDK.
+    #[inline]
+    pub fn name(self) -> &'static CStr {
+        let name: &'static [u8] = match self {
+            Self::Default => ffi::RTE_MBUF_DEFAULT_MEMPOOL_OPS,
+            Self::Platform => return unsafe { CStr::from_ptr(ffi::rte_mbuf_best_mempool_ops()) },
+            Self::RingMpMc => b"ring_mp_mc\0",
+            Self::RingSpSc => b"ring_sp_sc\0",
+            Self::RingMpSc => b"ring_mp_sc\0",
+            Self::RingSpMc => b"ring_sp_mc\0",
+            Self::Stack => b"stack\0",
+            Self::LfStack => b"lf_stack\0",
+            Self::Bucket => b"bucket\0",
+            Self::Custom(name) => return name,
+        };
+        CStr::from_bytes_with_nul(name).unwrap()
+    }
+}
+
+/// An external memory area for [`MemoryPool::new_extbuf`]: its virtual and IO addresses, length, and the size of
+/// each of the data rooms it is split into.
+pub type ExtMem = ffi::rte_pktmbuf_extmem;
+
+#[repr(transparent)]
+pub struct MemoryPool(pub(crate) NonNull<ffi::rte_mempool>);
+
+// # Safety
+// All operations that can be performed on a memory pool are implemented in a thread-safe manner by DPDK, as mentioned (briefly) here:
+// [Thread Safety of DPDK Functions](https://doc.dpdk.org/guides-20.08/prog_guide/thread_safety_dpdk_functions.html#fast-path-apis)
+unsafe impl Send for MemoryPool {}
+unsafe impl Sync for MemoryPool {}
+
+impl MemoryPool {
+    /// Creates a new memory pool, using the [default](MempoolOps::Default) mempool driver.
+    ///
+    /// Uses the [`ffi::rte_pktmbuf_pool_create_by_ops`] function under the hood.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__mbuf_8h.html#a9e4bd0ae9e01d0f4dfe7d27cfb0d9a7f>
+    #[inline]
+    pub fn new<S: Into<Vec<u8>>>(
+        name: S,
+        size: u32,
+        cache_size: u32,
+        private_size: u16,
+        data_room_size: u16,
+        socket_id: Option<SocketId>,
+    ) -> Result<Self> {
+        Self::new_with_ops(name, size, cache_size, private_size, data_room_size, socket_id, MempoolOps::Default)
+    }
+
+    /// Creates a new memory pool, using the given mempool driver.
+    ///
+    /// Fails with `EINVAL` if the driver isn't available.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__mbuf_8h.html#a9e4bd0ae9e01d0f4dfe7d27cfb0d9a7f>
+    #[inline]
+    pub fn new_with_ops<S: Into<Vec<u8>>>(
+        name: S,
+        size: u32,
+        cache_size: u32,
+        private_size: u16,
+        data_room_size: u16,
+        socket_id: Option<SocketId>,
+        ops: MempoolOps,
+    ) -> Result<Self> {
+        let name = CString::new(name).unwrap();
+        let ops = ops.name();
+
+        unsafe {
+            ffi::rte_pktmbuf_pool_create_by_ops(
+                name.as_ptr(),
+                size,
+                cache_size,
+                private_size,
+                data_room_size,
+                socket_id.map(|id| id.get() as i32).unwrap_or(-1),
+                ops.as_ptr() as _,
+            )
+        }
+        .rte_ok()
+        .map(Self)
+    }
+
+    /// Creates a new memory pool whose mbufs' data rooms are carved out of the given (pinned) external memory areas,
+    /// rather than out of the pool's own memory, using `rte_pktmbuf_pool_create_extbuf`.
+    ///
+    /// Every area must be large enough for its share of `size` data rooms of `data_room_size` bytes each
+    /// (`elt_size` must be at least `data_room_size`).
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__mbuf_8h.html>
+    ///
+    /// # Safety
+    /// The caller must guarantee that the memory of every area remains valid (and mapped for DMA by every device
+    /// that uses the pool) until the pool is freed, and that it isn't accessed other than through the pool's mbufs.
+    #[inline]
+    pub unsafe fn new_extbuf<S: Into<Vec<u8>>>(
+        name: S,
+        size: u32,
+        cache_size: u32,
+        private_size: u16,
+        data_room_size: u16,
+        socket_id: Option<SocketId>,
+        ext_mem: &[ExtMem],
+    ) -> Result<Self> {
+        let name = CString::new(name).unwrap();
+
+        ffi::rte_pktmbuf_pool_create_extbuf(
+            name.as_ptr(),
+            size,
+            cache_size,
+            private_size,
+            data_room_size,
+            socket_id.map(|id| id.get() as i32).unwrap_or(-1),
+            ext_mem.as_ptr(),
+            ext_mem.len() as u32,
+        )
+        .rte_ok()
+        .map(Self)
+    }
+
+    /// Looks up an existing memory pool by name, e.g. a pool created by the primary process, from a secondary process
+    /// (see `--proc-type`), which can then allocate and free mbufs from the pool like the primary does.
+    ///
+    /// The returned handle doesn't own the pool, i.e. dropping it doesn't free the pool, which remains owned by
+    /// whichever [`MemoryPool`] created it. Fails with `ENOENT` if there is no such pool.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__mempool_8h.html>
+    ///
+    /// # Safety
+    /// The caller must guarantee that the pool outlives the returned handle (and the mbufs allocated from it), i.e.
+    /// that its owner doesn't drop it in the meantime, e.g. because it's owned by the primary process, which outlives
+    /// its secondary processes.
+    #[inline]
+    pub unsafe fn lookup<S: Into<Vec<u8>>>(name: S) -> Result<MemoryPoolRef> {
+        let name = CString::new(name).unwrap();
+        let ptr = ffi::rte_mempool_lookup(name.as_ptr()).rte_ok()?;
+        Ok(MemoryPoolRef(ManuallyDrop::new(Self(ptr))))
+    }
+
+    /// Fills the remaining capacity of `mbufs` with empty mbufs allocated from this memory pool,
+    /// using a single call to `rte_pktmbuf_alloc_bulk`.
+    ///
+    /// The allocation is all-or-nothing: if the pool does not have enough free mbufs,
+    /// an error is returned and `mbufs` is left unchanged.
+    ///
+    /// See also: [`MBuf::alloc_bulk_with_provider`].
+    #[inline]
+    pub fn alloc_bulk<'a, const CAP: usize>(&'a self, mbufs: &mut ArrayVec<MBuf<&'a Self>, CAP>) -> Result<()> {
+        MBuf::alloc_bulk_with_provider(&self, mbufs)
+    }
+
+    #[inline]
+    pub fn name(&self) -> &[u8] {
+        let name = unsafe {
+            let name = addr_of!((*self.0.as_ptr()).name);
+            slice::from_raw_parts::<'_, u8>(name as _, size_of_val(&*name))
+        };
+
+        // trim slice after the first nul character found
+        if let Some((null_pos, _)) = name.iter().enumerate().find(|(_, c)| **c == 0) {
+            &name[..null_pos]
+        } else {
+            name
+        }
+    }
+
+    /// Returns the NUMA socket this memory pool was allocated on, or `None` if it was allocated on any socket.
+    #[inline]
+    pub fn socket_id(&self) -> Option<SocketId> {
+        SocketId::new(unsafe { (*self.0.as_ptr()).socket_id } as u32)
+    }
+
+    /// Returns the name of the mempool driver used by this memory pool.
+    #[inline]
+    pub fn ops_name(&self) -> &CStr {
+        unsafe {
+            let ops = ffi::_rte_mempool_get_ops((*self.0.as_ptr()).ops_index);
+            CStr::from_ptr((*ops).name.as_ptr())
+        }
+    }
+
+    /// Returns the size of this memory pool, i.e. the number of mbufs it has capacity for.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/structrte__mempool.html#ab2c6b258f02add8fdf4cfc7c371dd772>
+    #[inline]
+    pub fn size(&self) -> u32 {
+        unsafe { (*self.0.as_ptr()).size }
+    }
+
+    /// See also: <https://doc.dpdk.org/api-21.08/structrte__mempool.html#ac0fc8e6a5ca95e81e5d94522c86cfc9c>
+    #[inline]
+    pub fn cache_size(&self) -> u32 {
+        unsafe { (*self.0.as_ptr()).cache_size }
+    }
+
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__mbuf_8h.html#afc63705bb85669e2a1ea17e3279d59ce>
+    #[inline]
+    pub fn private_data_size(&self) -> u16 {
+        unsafe { ffi::_rte_pktmbuf_priv_size(self.0.as_ptr()) }
+    }
+
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__mbuf_8h.html#ac8fe14dae4b72eeecadcb684af5a9703>
+    #[inline]
+    pub fn data_room_size(&self) -> u16 {
+        unsafe { ffi::_rte_pktmbuf_data_room_size(self.0.as_ptr()) }
+    }
+
+    /// Returns the number of free mbufs in this memory pool's capacity.
+    ///
+    /// This walks the caches of all (possible) lcores, see [`Self::telemetry`] for a cheaper alternative.
+    ///
+    /// Equivalent to `mempool.size() - mempool.get_in_use_count()`.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__mempool_8h.html#a505a815fc46e027a0a2054df124bc514>
+    #[inline]
+    pub fn get_available_count(&self) -> u32 {
+        unsafe { ffi::rte_mempool_avail_count(self.0.as_ptr()) }
+    }
+
+    /// Returns the number of used mbufs in this memory pool's capacity.
+    ///
+    /// Equivalent to `mempool.size() - mempool.get_available_count()`.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__mempool_8h.html#abce09dff484b6726ced4da3bbe3b2e55>
+    #[inline]
+    pub fn get_in_use_count(&self) -> u32 {
+        unsafe { ffi::rte_mempool_in_use_count(self.0.as_ptr()) }
+    }
+}
+
+impl fmt::Debug for MemoryPool {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("MemoryPool")
+            .field("name", &String::from_utf8_lossy(self.name()))
+            .field("size", &self.size())
+            .field("cache_size", &self.cache_size())
+            .field("in_use", &self.get_in_use_count())
+            .field("private_data_size", &self.private_data_size())
+            .field("data_room_size", &self.data_room_size())
+            .finish()
+    }
+}
+
+impl Drop for MemoryPool {
+    #[inline]
+    fn drop(&mut self) {
+        telemetry::forget_pool(self);
+        unsafe { ffi::rte_mempool_free(self.0.as_ptr()) }
+    }
+}
+
+/// A handle to a memory pool that is owned by someone else (e.g. by another process), see [`MemoryPool::lookup`].
+pub struct MemoryPoolRef(ManuallyDrop<MemoryPool>);
+
+impl Deref for MemoryPoolRef {
+    type Target = MemoryPool;
+
+    #[inline]
+    fn deref(&self) -> &Self::Target {
+        &self.0
+    }
+}
+
+impl fmt::Debug for MemoryPoolRef {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_tuple("MemoryPoolRef").field(&*self.0).finish()
+    }
+}
+
+/// The parameters of the memory pools created by a [`MempoolSet`], see [`MemoryPool::new_with_ops`].
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct MempoolConfig {
+    pub size: u32,
+    pub cache_size: u32,
+    pub private_size: u16,
+    pub data_room_size: u16,
+    pub ops: MempoolOps,
+}
+
+const SOCKET_ANY_SLOT: usize = ffi::RTE_MAX_NUMA_NODES as usize;
+
+/// A set of identical memory pools, one per NUMA socket, each created on first use.
+///
+/// Allocating mbufs from a pool on a remote socket makes every access to them (by both the CPU and the NIC)
+/// cross the socket interconnect, so each lcore (and each receive queue) should use the pool of its own socket,
+/// see [`Self::for_lcore`] and [`Self::for_port`].
+///
+/// The pool of socket `N` is named `"{name}_{N}"`, and the pool for an unknown socket is named `"{name}_any"`.
+pub struct MempoolSet {
+    name: String,
+    config: MempoolConfig,
+    pools: Box<[OnceCell<MemoryPool>]>,
+}
+
+impl MempoolSet {
+    /// Creates an empty set, without creating any memory pools.
+    #[inline]
+    pub fn new<S: Into<String>>(name: S, config: MempoolConfig) -> Self {
+        let pools = (0..=SOCKET_ANY_SLOT).map(|_| OnceCell::new()).collect();
+        Self { name: name.into(), config, pools }
+    }
+
+    #[inline]
+    pub fn config(&self) -> &MempoolConfig {
+        &self.config
+    }
+
+    /// Returns the pool of the given socket (or the pool for any socket, if `None`), creating it if needed.
+    ///
+    /// Fails with `EINVAL` if the socket ID is out of range.
+    #[inline]
+    pub fn for_socket(&self, socket_id: Option<SocketId>) -> Result<&MemoryPool> {
+        let slot = match socket_id {
+            Some(id) if (id.get() as usize) < SOCKET_ANY_SLOT => id.get() as usize,
+            Some(_) => return Err(Error(libc::EINVAL)),
+            None => SOCKET_ANY_SLOT,
+        };
+
+        self.pools[slot].get_or_try_init(|| {
+            let name = match socket_id {
+                Some(id) => format!("{}_{}", self.name, id.get()),
+                None => format!("{}_any", self.name),
+            };
+            let MempoolConfig { size, cache_size, private_size, data_room_size, ops } = self.config;
+            MemoryPool::new_with_ops(name, size, cache_size, private_size, data_room_size, socket_id, ops)
+        })
+    }
+
+    /// Returns the pool of the given lcore's socket, see [`Self::for_socket`].
+    #[inline]
+    pub fn for_lcore(&self, lcore: lcore::Id) -> Result<&MemoryPool> {
+        self.for_socket(lcore.socket_id())
+    }
+
+    /// Returns the pool of the current lcore's socket, see [`Self::for_socket`].
+    #[inline]
+    pub fn for_current_lcore(&self) -> Result<&MemoryPool> {
+        self.for_socket(lcore::socket_id())
+    }
+
+    /// Returns the pool of the socket the device is attached to, which should be used for its receive queues
+    /// (see [`EthDev::rx_queue_setup`]).
+    ///
+    /// Fails if the port ID is invalid, and returns the pool for any socket if the device's socket is unknown.
+    #[inline]
+    pub fn for_port(&self, dev: &EthDev) -> Result<&MemoryPool> {
+        if unsafe { ffi::rte_eth_dev_is_valid_port(dev.port_id()) } == 0 {
+            return Err(Error(libc::ENODEV));
+        }
+        self.for_socket(dev.socket_id().ok())
+    }
+
+    /// Returns an iterator over the pools that have been created so far.
+    #[inline]
+    pub fn iter(&self) -> impl Iterator<Item = &MemoryPool> {
+        self.pools.iter().filter_map(OnceCell::get)
+    }
+}
+
+impl fmt::Debug for MempoolSet {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("MempoolSet")
+            .field("name", &self.name)
+            .field("config", &self.config)
+            .field("pools", &self.iter().collect::<Vec<_>>())
+            .finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use rte_test_macros::rte_test;
+
+    use super::*;
+
+    #[rte_test(mock_lcore)]
+    fn lookup() {
+        let pool = MemoryPool::new("lookup_test_pool", 16, 0, 0, ffi::RTE_MBUF_DEFAULT_BUF_SIZE as u16, None).unwrap();
+
+        let found = unsafe { MemoryPool::lookup("lookup_test_pool") }.unwrap();
+        assert_eq!(found.name(), b"lookup_test_pool");
+        assert_eq!(found.size(), pool.size());
+
+        // the pool is shared, and dropping the handle doesn't free it
+        let mbuf = MBuf::new_with_provider(&&*found);
+        assert_eq!(pool.get_in_use_count(), 1);
+        drop(mbuf);
+        drop(found);
+        assert_eq!(pool.get_in_use_count(), 0);
+
+        assert_eq!(unsafe { MemoryPool::lookup("lookup_test_missing") }.unwrap_err(), Error(libc::ENOENT));
+    }
+}
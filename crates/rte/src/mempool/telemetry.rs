@@ -0,0 +1,278 @@
+//! Cheap counters for sizing memory pools and detecting their exhaustion.
+//!
+//! A starved pool usually shows up only indirectly, as `rx_missed_errors` (or `rx_nombuf`) on the ports it feeds,
+//! so these counters are meant to be sampled periodically (e.g. every second) for every pool:
+//! - [`MemoryPool::cache_len`] reads the number of objects in a single lcore's cache, without walking all caches.
+//! - [`MemoryPool::telemetry`] reads the common pool's count, and the caches of the enabled lcores only.
+//! - [`MemoryPool::alloc_failures`] counts the allocations (made through [`Allocator`](crate::mbuf::Allocator)) that
+//!   failed, and [`MemoryPool::stats`] returns DPDK's own statistics when DPDK is built with `RTE_LIBRTE_MEMPOOL_STATS`.
+//! - [`WatermarkMonitor`] reports pools whose available count drops below (and recovers above) a low watermark.
+
+use std::{
+    ptr,
+    sync::{
+        atomic::{AtomicPtr, AtomicU64, Ordering},
+        Mutex,
+    },
+};
+
+use super::MemoryPool;
+use crate::lcore;
+
+/// The maximum number of memory pools whose allocation failures are counted, see [`MemoryPool::alloc_failures`].
+pub const MAX_TRACKED_POOLS: usize = 64;
+
+struct FailureCounter {
+    pool: AtomicPtr<ffi::rte_mempool>,
+    calls: AtomicU64,
+    objs: AtomicU64,
+}
+
+#[allow(clippy::declare_interior_mutable_const)]
+const UNUSED: FailureCounter =
+    FailureCounter { pool: AtomicPtr::new(ptr::null_mut()), calls: AtomicU64::new(0), objs: AtomicU64::new(0) };
+
+static FAILURES: [FailureCounter; MAX_TRACKED_POOLS] = [UNUSED; MAX_TRACKED_POOLS];
+/// Serializes claiming and releasing counters, so that a pool never ends up with two counters when several lcores
+/// fail their first allocation from it at the same time (counting itself is lock-free).
+static CLAIMS: Mutex<()> = Mutex::new(());
+
+fn find_counter(pool: *mut ffi::rte_mempool) -> Option<&'static FailureCounter> {
+    FAILURES.iter().find(|counter| counter.pool.load(Ordering::Acquire) == pool)
+}
+
+/// Records a failed allocation of `count` objects from `pool`, claiming a free counter on the pool's first failure.
+#[cold]
+pub(crate) fn record_alloc_failure(pool: &MemoryPool, count: usize) {
+    let pool = pool.0.as_ptr();
+    let counter = find_counter(pool).or_else(|| {
+        let _claims = CLAIMS.lock().unwrap_or_else(|err| err.into_inner());
+        // another lcore may have claimed a counter for the pool in the meantime
+        find_counter(pool).or_else(|| {
+            let counter = FAILURES.iter().find(|counter| counter.pool.load(Ordering::Relaxed).is_null())?;
+            counter.pool.store(pool, Ordering::Release);
+            Some(counter)
+        })
+    });
+
+    // pools beyond `MAX_TRACKED_POOLS` aren't counted
+    if let Some(counter) = counter {
+        counter.calls.fetch_add(1, Ordering::Relaxed);
+        counter.objs.fetch_add(count as u64, Ordering::Relaxed);
+    }
+}
+
+/// Releases the pool's counter (if any), called when the pool is freed.
+pub(crate) fn forget_pool(pool: &MemoryPool) {
+    let _claims = CLAIMS.lock().unwrap_or_else(|err| err.into_inner());
+    if let Some(counter) = find_counter(pool.0.as_ptr()) {
+        counter.calls.store(0, Ordering::Relaxed);
+        counter.objs.store(0, Ordering::Relaxed);
+        counter.pool.store(ptr::null_mut(), Ordering::Release);
+    }
+}
+
+/// The number of failed allocations from a memory pool, see [`MemoryPool::alloc_failures`].
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct AllocFailures {
+    /// The number of calls that failed (a failed bulk allocation is counted once).
+    pub calls: u64,
+    /// The number of objects that these calls failed to allocate.
+    pub objs: u64,
+}
+
+/// DPDK's statistics of a memory pool, summed over all lcores, see [`MemoryPool::stats`].
+pub type MempoolStats = ffi::_rte_mempool_stats;
+
+/// A sample of a memory pool's fill levels, see [`MemoryPool::telemetry`].
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct MempoolTelemetry {
+    pub size: u32,
+    /// The number of free objects in the common pool, i.e. excluding the lcores' caches.
+    pub common_pool_count: u32,
+    /// The number of free objects in the caches of the enabled lcores.
+    pub cached: u32,
+    /// The largest number of free objects in the cache of a single (enabled) lcore.
+    pub max_cache_len: u32,
+    pub alloc_failures: AllocFailures,
+}
+
+impl MempoolTelemetry {
+    /// Returns the number of free objects, including the ones in the lcores' caches.
+    #[inline]
+    pub fn available(&self) -> u32 {
+        (self.common_pool_count + self.cached).min(self.size)
+    }
+
+    /// Returns the fraction of objects that are in use.
+    #[inline]
+    pub fn utilization(&self) -> f64 {
+        if self.size == 0 {
+            0.0
+        } else {
+            1.0 - f64::from(self.available()) / f64::from(self.size)
+        }
+    }
+}
+
+impl MemoryPool {
+    /// Returns the number of objects in the given lcore's cache of this memory pool,
+    /// or `None` if the pool has no caches, or if the lcore ID is out of range.
+    ///
+    /// This only reads the lcore's cache, whereas [`Self::get_available_count`] walks the caches of all lcores.
+    #[inline]
+    pub fn cache_len(&self, lcore: lcore::Id) -> Option<u32> {
+        let caches = unsafe { (*self.0.as_ptr()).local_cache };
+        if caches.is_null() || lcore.get() >= ffi::RTE_MAX_LCORE {
+            return None;
+        }
+        Some(unsafe { ptr::read_volatile(ptr::addr_of!((*caches.add(lcore.get() as usize)).len)) })
+    }
+
+    /// Returns the number of free objects in the common pool, i.e. excluding the lcores' caches.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__mempool_8h.html>
+    #[inline]
+    pub fn common_pool_count(&self) -> u32 {
+        unsafe { ffi::rte_mempool_ops_get_count(self.0.as_ptr()) }
+    }
+
+    /// Returns the number of failed allocations from this memory pool made through
+    /// [`Allocator`](crate::mbuf::Allocator), which are counted even if DPDK is built without mempool statistics.
+    ///
+    /// Only the first [`MAX_TRACKED_POOLS`] pools to fail an allocation are counted.
+    #[inline]
+    pub fn alloc_failures(&self) -> AllocFailures {
+        find_counter(self.0.as_ptr())
+            .map(|counter| AllocFailures {
+                calls: counter.calls.load(Ordering::Relaxed),
+                objs: counter.objs.load(Ordering::Relaxed),
+            })
+            .unwrap_or_default()
+    }
+
+    /// Returns DPDK's statistics of this memory pool, which are only collected if DPDK is built with
+    /// `RTE_LIBRTE_MEMPOOL_STATS` (otherwise `None` is returned).
+    ///
+    /// Unlike [`Self::alloc_failures`], these also count allocations made by the PMDs when refilling their RX rings.
+    #[inline]
+    pub fn stats(&self) -> Option<MempoolStats> {
+        let mut stats = MempoolStats::default();
+        match unsafe { ffi::_rte_mempool_get_stats(self.0.as_ptr(), &mut stats) } {
+            0 => Some(stats),
+            _ => None,
+        }
+    }
+
+    /// Samples the fill levels of this memory pool, reading only the caches of the enabled lcores.
+    #[inline]
+    pub fn telemetry(&self) -> MempoolTelemetry {
+        let (cached, max_cache_len) = lcore::Id::iter_enabled(false)
+            .filter_map(|lcore| self.cache_len(lcore))
+            .fold((0, 0), |(sum, max), len| (sum + len, u32::max(max, len)));
+
+        MempoolTelemetry {
+            size: self.size(),
+            common_pool_count: self.common_pool_count(),
+            cached,
+            max_cache_len,
+            alloc_failures: self.alloc_failures(),
+        }
+    }
+}
+
+/// A transition reported by [`WatermarkMonitor::poll`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum WatermarkEvent {
+    /// The pool's available count has dropped below its low watermark.
+    Low(MempoolTelemetry),
+    /// The pool's available count has returned to (or above) its low watermark.
+    Recovered(MempoolTelemetry),
+}
+
+/// Polls a set of memory pools, reporting the ones whose available count crosses their low watermark.
+#[derive(Debug, Default)]
+pub struct WatermarkMonitor<'a> {
+    pools: Vec<(&'a MemoryPool, u32, bool)>,
+}
+
+impl<'a> WatermarkMonitor<'a> {
+    #[inline]
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Starts monitoring a memory pool, reporting it when fewer than `low_watermark` objects are available.
+    #[inline]
+    pub fn watch(&mut self, pool: &'a MemoryPool, low_watermark: u32) {
+        self.pools.push((pool, low_watermark, false));
+    }
+
+    /// Samples all monitored pools (see [`MemoryPool::telemetry`]),
+    /// and calls `f` for each pool that crossed its low watermark since the previous call.
+    #[inline]
+    pub fn poll<F>(&mut self, mut f: F)
+    where
+        F: FnMut(&MemoryPool, WatermarkEvent),
+    {
+        for (pool, low_watermark, is_low) in &mut self.pools {
+            let telemetry = pool.telemetry();
+            let now_low = telemetry.available() < *low_watermark;
+            if now_low != *is_low {
+                *is_low = now_low;
+                f(pool, if now_low { WatermarkEvent::Low(telemetry) } else { WatermarkEvent::Recovered(telemetry) });
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::{sync::Barrier, thread};
+
+    use rte_test_macros::rte_test;
+
+    use super::*;
+
+    fn counters_of(pool: &MemoryPool) -> usize {
+        FAILURES.iter().filter(|counter| counter.pool.load(Ordering::Acquire) == pool.0.as_ptr()).count()
+    }
+
+    #[rte_test(mock_lcore)]
+    fn concurrent_first_failures() {
+        const THREADS: usize = 8;
+
+        for i in 0..16 {
+            let pool = MemoryPool::new(format!("telemetry_race_{i}"), 15, 0, 0, 0, None).unwrap();
+            let barrier = Barrier::new(THREADS);
+            thread::scope(|s| {
+                for _ in 0..THREADS {
+                    s.spawn(|| {
+                        barrier.wait();
+                        record_alloc_failure(&pool, 2);
+                    });
+                }
+            });
+
+            assert_eq!(counters_of(&pool), 1);
+            assert_eq!(pool.alloc_failures(), AllocFailures { calls: THREADS as u64, objs: 2 * THREADS as u64 });
+
+            // the counter is released along with the pool
+            let raw = pool.0.as_ptr();
+            drop(pool);
+            assert!(FAILURES.iter().all(|counter| counter.pool.load(Ordering::Acquire) != raw));
+        }
+    }
+
+    #[test]
+    fn telemetry_ratios() {
+        let telemetry = MempoolTelemetry { size: 1000, common_pool_count: 600, cached: 150, ..Default::default() };
+        assert_eq!(telemetry.available(), 750);
+        assert!((telemetry.utilization() - 0.25).abs() < f64::EPSILON);
+
+        // the caches and the common pool are read at different times, so their sum may (briefly) exceed the size
+        let telemetry = MempoolTelemetry { size: 1000, common_pool_count: 990, cached: 20, ..Default::default() };
+        assert_eq!(telemetry.available(), 1000);
+        assert_eq!(MempoolTelemetry::default().utilization(), 0.0);
+    }
+}
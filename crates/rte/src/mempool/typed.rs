@@ -0,0 +1,212 @@
+use std::{
+    fmt,
+    marker::PhantomData,
+    mem::{self, MaybeUninit},
+    ops::Deref,
+    ptr::{self, NonNull},
+};
+
+use arrayvec::ArrayVec;
+use rte_error::Error;
+
+use super::{MemoryPool, MempoolOps};
+use crate::{
+    mbuf::{Allocator, MBuf, PrivateData},
+    memory::SocketId,
+    Result,
+};
+
+const PRIV_ALIGN: usize = ffi::RTE_MBUF_PRIV_ALIGN as usize;
+
+/// A memory pool whose mbufs have room for a `P` in their private area (right after their `rte_mbuf` header), for
+/// keeping per-packet metadata (e.g. a flow id or a verdict) along with each packet, instead of in a side array.
+///
+/// The mbufs allocated from this pool give access to their metadata with [`MBuf::private`] and [`MBuf::private_mut`].
+/// Since the pool derefs to a [`MemoryPool`], it can be used wherever a `MemoryPool` is expected (e.g. for setting up
+/// receive queues), and the mbufs allocated by such APIs can be converted with [`MBuf::into_typed`], or received with
+/// [`EthDev::rx_burst_typed`](crate::ethdev::EthDev::rx_burst_typed).
+#[repr(transparent)]
+pub struct TypedMemoryPool<P> {
+    pool: MemoryPool,
+    _marker: PhantomData<fn() -> P>,
+}
+
+impl<P> TypedMemoryPool<P>
+where
+    P: PrivateData,
+{
+    /// Returns the size of the private area of the pool's mbufs, i.e. the size of `P` rounded up to
+    /// `RTE_MBUF_PRIV_ALIGN`.
+    ///
+    /// Fails with `EINVAL` if `P` is too large, or if its alignment is larger than `RTE_MBUF_PRIV_ALIGN`.
+    #[inline]
+    fn private_size() -> Result<u16> {
+        if mem::align_of::<P>() > PRIV_ALIGN {
+            return Err(Error(libc::EINVAL));
+        }
+        let size = (mem::size_of::<P>() + PRIV_ALIGN - 1) / PRIV_ALIGN * PRIV_ALIGN;
+        u16::try_from(size).map_err(|_| Error(libc::EINVAL))
+    }
+
+    /// Creates a new memory pool, see [`MemoryPool::new`].
+    #[inline]
+    pub fn new<S: Into<Vec<u8>>>(
+        name: S,
+        size: u32,
+        cache_size: u32,
+        data_room_size: u16,
+        socket_id: Option<SocketId>,
+    ) -> Result<Self> {
+        Self::new_with_ops(name, size, cache_size, data_room_size, socket_id, MempoolOps::Default)
+    }
+
+    /// Creates a new memory pool, using the given mempool driver, see [`MemoryPool::new_with_ops`].
+    #[inline]
+    pub fn new_with_ops<S: Into<Vec<u8>>>(
+        name: S,
+        size: u32,
+        cache_size: u32,
+        data_room_size: u16,
+        socket_id: Option<SocketId>,
+        ops: MempoolOps,
+    ) -> Result<Self> {
+        let private_size = Self::private_size()?;
+        let pool = MemoryPool::new_with_ops(name, size, cache_size, private_size, data_room_size, socket_id, ops)?;
+        Ok(Self { pool, _marker: PhantomData })
+    }
+
+    /// Fills the remaining capacity of `mbufs` with empty mbufs allocated from this memory pool,
+    /// see [`MemoryPool::alloc_bulk`].
+    #[inline]
+    pub fn alloc_bulk<'a, const CAP: usize>(&'a self, mbufs: &mut ArrayVec<MBuf<&'a Self>, CAP>) -> Result<()> {
+        MBuf::alloc_bulk_with_provider(&self, mbufs)
+    }
+}
+
+impl<P> Deref for TypedMemoryPool<P> {
+    type Target = MemoryPool;
+
+    #[inline]
+    fn deref(&self) -> &Self::Target {
+        &self.pool
+    }
+}
+
+impl<P> fmt::Debug for TypedMemoryPool<P> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_tuple("TypedMemoryPool").field(&self.pool).finish()
+    }
+}
+
+/// Copies the private area of `src` (i.e. a `P`) to that of `dst`, which neither `rte_pktmbuf_copy` nor
+/// `rte_pktmbuf_clone` do, so that a clone doesn't return the metadata left by the previous user of its mbuf.
+///
+/// # Safety
+/// Both mbufs must have been allocated from a [`TypedMemoryPool<P>`].
+#[inline]
+unsafe fn copy_private<P>(src: NonNull<ffi::rte_mbuf>, dst: NonNull<ffi::rte_mbuf>) -> NonNull<ffi::rte_mbuf> {
+    let offset = mem::size_of::<ffi::rte_mbuf>();
+    ptr::copy_nonoverlapping(
+        (src.as_ptr() as *const u8).add(offset),
+        (dst.as_ptr() as *mut u8).add(offset),
+        mem::size_of::<P>(),
+    );
+    dst
+}
+
+/// Same as the allocator of [`MemoryPool`], except that clones keep the metadata of the original mbuf, since the type
+/// of the private area only matters to the mbufs.
+impl<'a, P> Allocator for &'a TypedMemoryPool<P> {
+    #[inline]
+    fn alloc(&self) -> Result<NonNull<ffi::rte_mbuf>> {
+        (&self.pool).alloc()
+    }
+
+    #[inline]
+    fn alloc_bulk(&self, mbufs: &mut [MaybeUninit<NonNull<ffi::rte_mbuf>>]) -> Result<()> {
+        (&self.pool).alloc_bulk(mbufs)
+    }
+
+    #[inline]
+    unsafe fn clone(mbuf: NonNull<ffi::rte_mbuf>) -> Result<NonNull<ffi::rte_mbuf>> {
+        <&MemoryPool>::clone(mbuf).map(|clone| copy_private::<P>(mbuf, clone))
+    }
+
+    #[inline]
+    unsafe fn clone_shared(mbuf: NonNull<ffi::rte_mbuf>) -> Result<NonNull<ffi::rte_mbuf>> {
+        <&MemoryPool>::clone_shared(mbuf).map(|clone| copy_private::<P>(mbuf, clone))
+    }
+
+    #[inline]
+    unsafe fn free(mbuf: NonNull<ffi::rte_mbuf>) {
+        <&MemoryPool>::free(mbuf)
+    }
+
+    #[inline]
+    unsafe fn free_bulk(mbufs: &[NonNull<ffi::rte_mbuf>]) {
+        <&MemoryPool>::free_bulk(mbufs)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use rte_test_macros::rte_test;
+
+    use super::*;
+
+    #[repr(C)]
+    #[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+    struct Meta {
+        flow_id: u32,
+        verdict: u8,
+    }
+
+    unsafe impl PrivateData for Meta {}
+
+    #[rte_test(mock_lcore)]
+    fn private_area() {
+        let pool = TypedMemoryPool::<Meta>::new("typed_test_pool", 16, 0, ffi::RTE_MBUF_DEFAULT_BUF_SIZE as u16, None)
+            .unwrap();
+        assert_eq!(pool.private_data_size(), 8);
+
+        let mut mbufs = ArrayVec::<_, 4>::new();
+        pool.alloc_bulk(&mut mbufs).unwrap();
+        for (i, mbuf) in mbufs.iter_mut().enumerate() {
+            *mbuf.private_mut() = Meta { flow_id: i as u32, verdict: 1 };
+            mbuf.extend_from_slice(&vec![0xff; mbuf.tailroom()]);
+        }
+        // the private area is separate from the data room
+        assert!(mbufs.iter().enumerate().all(|(i, mbuf)| *mbuf.private() == Meta { flow_id: i as u32, verdict: 1 }));
+
+        // the metadata survives the round trip through an untyped mbuf, but only for the pool it was allocated from
+        let mbuf = mbufs.pop().unwrap().into_untyped();
+        let mbuf = mbuf.into_typed(&pool).unwrap();
+        assert_eq!(mbuf.private().flow_id, 3);
+
+        let other = TypedMemoryPool::<u64>::new("typed_test_other", 16, 0, 0, None).unwrap();
+        assert!(mbuf.into_untyped().into_typed(&other).is_err());
+    }
+
+    #[rte_test(mock_lcore)]
+    fn clones_keep_private_area() {
+        let pool = TypedMemoryPool::<Meta>::new("typed_test_clone", 16, 0, ffi::RTE_MBUF_DEFAULT_BUF_SIZE as u16, None)
+            .unwrap();
+
+        // leave stale metadata in every mbuf of the pool, for the clones to be allocated from
+        let mut mbufs = ArrayVec::<_, 16>::new();
+        pool.alloc_bulk(&mut mbufs).unwrap();
+        mbufs.iter_mut().for_each(|mbuf| *mbuf.private_mut() = Meta { flow_id: 0xdead, verdict: 0xff });
+        drop(mbufs);
+
+        let mut mbuf = MBuf::new_with_provider_and_data(&&pool, b"\x00\x01");
+        *mbuf.private_mut() = Meta { flow_id: 7, verdict: 1 };
+
+        let copy = mbuf.clone();
+        assert_eq!(*copy.private(), Meta { flow_id: 7, verdict: 1 });
+
+        let shared = mbuf.into_shared();
+        let clone = shared.try_clone().unwrap();
+        assert_eq!(*clone.private(), Meta { flow_id: 7, verdict: 1 });
+        assert_eq!(&clone[..], b"\x00\x01");
+    }
+}
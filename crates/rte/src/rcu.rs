@@ -0,0 +1,243 @@
+//! Publishing read-mostly data (e.g. classification rule sets) to data-plane lcores without stalling them,
+//! using quiescent-state-based reclamation (QSBR), the same scheme as DPDK's `rte_rcu_qsbr`.
+//!
+//! The control plane builds a new version of the data off to the side, and [publishes](RcuCell::publish) it with
+//! a single atomic pointer swap. Readers never wait: each reader lcore reads the current version through its own
+//! [`RcuReader`] while processing a burst, and reports a [quiescent state](RcuReader::quiescent) between bursts
+//! (e.g. once per iteration of its poll loop), meaning it no longer holds any references to the data.
+//! The previous version is dropped once every registered reader has reported a quiescent state since the swap.
+//!
+//! The borrow checker enforces the readers' side of the protocol: a reference returned by [`RcuReader::get`]
+//! cannot outlive the next call to [`RcuReader::quiescent`].
+//!
+//! ```rust,ignore
+//! let rules = Arc::new(RcuCell::new(Acl::build("acl", None, &rules)?));
+//! let mut reader = rules.reader(); // moved to a worker lcore
+//! loop {
+//!     // ... rx_burst
+//!     reader.get().classify_burst(&pkts, 14, &mut verdicts)?;
+//!     // ... tx_burst
+//!     reader.quiescent();
+//! }
+//! ```
+
+use std::{
+    fmt,
+    sync::{
+        atomic::{AtomicPtr, AtomicU64, Ordering},
+        Arc, Mutex,
+    },
+    thread,
+    time::Duration,
+};
+
+/// The version reported by readers that have been dropped (or that are offline), which never blocks reclamation.
+const OFFLINE: u64 = u64::MAX;
+
+#[derive(Debug)]
+struct ReaderState {
+    /// The version of the cell the reader has observed at its last quiescent state.
+    seen: AtomicU64,
+}
+
+/// A cell holding the current version of a value, which is read without locking by [`RcuReader`]s,
+/// and replaced by [`Self::publish`], see the [module documentation](self).
+pub struct RcuCell<T> {
+    current: AtomicPtr<T>,
+    version: AtomicU64,
+    readers: Mutex<Vec<Arc<ReaderState>>>,
+    /// Serializes writers, which hold it while waiting for readers
+    writer: Mutex<()>,
+}
+
+// # Safety
+// Readers on other threads get `&T`s, and the cell drops values (replaced by other threads) from the writer's thread.
+unsafe impl<T: Send + Sync> Send for RcuCell<T> {}
+unsafe impl<T: Send + Sync> Sync for RcuCell<T> {}
+
+impl<T> RcuCell<T> {
+    #[inline]
+    pub fn new(value: T) -> Self {
+        Self {
+            current: AtomicPtr::new(Box::into_raw(Box::new(value))),
+            version: AtomicU64::new(0),
+            readers: Mutex::new(Vec::new()),
+            writer: Mutex::new(()),
+        }
+    }
+
+    /// Registers a new reader, which must report quiescent states regularly for [`Self::publish`] to make progress.
+    #[inline]
+    pub fn reader(self: &Arc<Self>) -> RcuReader<T> {
+        let state = Arc::new(ReaderState { seen: AtomicU64::new(self.version.load(Ordering::SeqCst)) });
+        self.readers.lock().unwrap().push(state.clone());
+        RcuReader { cell: self.clone(), state }
+    }
+
+    /// Replaces the current value with `value`, and waits until all readers have reported a quiescent state
+    /// before dropping the previous value.
+    ///
+    /// Must not be called by a registered reader (which would wait for itself), i.e. it's meant for the control plane.
+    #[inline]
+    pub fn publish(&self, value: T) {
+        drop(self.replace(value));
+    }
+
+    /// Replaces the current value with `value`, and returns the previous value,
+    /// once all readers have reported a quiescent state (so that none of them can still be using it).
+    pub fn replace(&self, value: T) -> T {
+        let _writer = self.writer.lock().unwrap();
+
+        let new = Box::into_raw(Box::new(value));
+        let old = self.current.swap(new, Ordering::SeqCst);
+        let version = self.version.fetch_add(1, Ordering::SeqCst) + 1;
+        self.synchronize(version);
+
+        // Safety: no reader holds a reference to `old` anymore, and it was created by `Box::into_raw`
+        *unsafe { Box::from_raw(old) }
+    }
+
+    fn synchronize(&self, version: u64) {
+        let mut backoff = Duration::from_micros(1);
+        loop {
+            let mut readers = self.readers.lock().unwrap();
+            // readers whose handle has been dropped are only referenced by the cell
+            readers.retain(|reader| Arc::strong_count(reader) > 1);
+            if readers.iter().all(|reader| reader.seen.load(Ordering::SeqCst) >= version) {
+                return;
+            }
+            drop(readers);
+
+            thread::sleep(backoff);
+            backoff = (backoff * 2).min(Duration::from_millis(1));
+        }
+    }
+
+    /// Returns the number of times the value has been replaced.
+    #[inline]
+    pub fn version(&self) -> u64 {
+        self.version.load(Ordering::Relaxed)
+    }
+
+    /// Returns a mutable reference to the current value, which requires that there are no readers.
+    #[inline]
+    pub fn get_mut(&mut self) -> &mut T {
+        unsafe { &mut *self.current.load(Ordering::Relaxed) }
+    }
+}
+
+impl<T> Drop for RcuCell<T> {
+    fn drop(&mut self) {
+        // readers hold a reference to the cell, so there are none left
+        drop(unsafe { Box::from_raw(self.current.load(Ordering::Relaxed)) });
+    }
+}
+
+impl<T: fmt::Debug> fmt::Debug for RcuCell<T> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("RcuCell")
+            .field("version", &self.version())
+            .field("readers", &self.readers.lock().unwrap().len())
+            .finish_non_exhaustive()
+    }
+}
+
+/// A registered reader of an [`RcuCell`], which should be owned by a single (data-plane) lcore.
+///
+/// Dropping the reader unregisters it.
+pub struct RcuReader<T> {
+    cell: Arc<RcuCell<T>>,
+    state: Arc<ReaderState>,
+}
+
+impl<T> RcuReader<T> {
+    /// Returns the current value, which remains valid until the next call to [`Self::quiescent`].
+    #[inline(always)]
+    pub fn get(&self) -> &T {
+        if self.state.seen.load(Ordering::Relaxed) == OFFLINE {
+            self.online();
+        }
+        // Safety: the value isn't dropped before this reader reports a quiescent state, which requires `&mut self`
+        unsafe { &*self.cell.current.load(Ordering::SeqCst) }
+    }
+
+    /// Reports that this reader no longer holds any references to the cell's value.
+    #[inline(always)]
+    pub fn quiescent(&mut self) {
+        let version = self.cell.version.load(Ordering::SeqCst);
+        if self.state.seen.load(Ordering::Relaxed) != version {
+            self.state.seen.store(version, Ordering::SeqCst);
+        }
+    }
+
+    /// Marks this reader as offline (e.g. before its lcore goes to sleep), so that it doesn't hold up writers
+    /// until it reads the value again.
+    #[inline]
+    pub fn offline(&mut self) {
+        self.state.seen.store(OFFLINE, Ordering::SeqCst);
+    }
+
+    #[cold]
+    fn online(&self) {
+        // same as registering a new reader, see `RcuCell::reader`
+        self.state.seen.store(self.cell.version.load(Ordering::SeqCst), Ordering::SeqCst);
+    }
+
+    #[inline]
+    pub fn cell(&self) -> &Arc<RcuCell<T>> {
+        &self.cell
+    }
+}
+
+impl<T> Drop for RcuReader<T> {
+    fn drop(&mut self) {
+        self.state.seen.store(OFFLINE, Ordering::SeqCst);
+    }
+}
+
+impl<T> fmt::Debug for RcuReader<T> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("RcuReader").field("seen", &self.state.seen.load(Ordering::Relaxed)).finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::sync::atomic::AtomicBool;
+
+    use super::*;
+
+    #[test]
+    fn publish_waits_for_readers() {
+        let cell = Arc::new(RcuCell::new(vec![1]));
+        let mut reader = cell.reader();
+        assert_eq!(reader.get(), &[1]);
+
+        let published = Arc::new(AtomicBool::new(false));
+        let writer = thread::spawn({
+            let (cell, published) = (cell.clone(), published.clone());
+            move || {
+                let old = cell.replace(vec![2]);
+                published.store(true, Ordering::SeqCst);
+                old
+            }
+        });
+
+        // the writer can't return the old value before the reader reports a quiescent state
+        while cell.version() == 0 {
+            thread::yield_now();
+        }
+        thread::sleep(Duration::from_millis(20));
+        assert!(!published.load(Ordering::SeqCst));
+        assert_eq!(reader.get(), &[2]);
+
+        reader.quiescent();
+        assert_eq!(writer.join().unwrap(), [1]);
+
+        // dropped (and offline) readers don't block writers
+        reader.offline();
+        cell.publish(vec![3]);
+        drop(reader);
+        cell.publish(vec![4]);
+    }
+}
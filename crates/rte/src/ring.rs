@@ -0,0 +1,369 @@
+//! Lock-free rings for passing mbufs between lcores, based on DPDK's [Ring Library](https://doc.dpdk.org/guides-21.08/prog_guide/ring_lib.html).
+//!
+//! A ring allows building pipelines in which some lcores receive packets and hand them over to
+//! (possibly many more) worker lcores, instead of processing every packet to completion on the lcore that received it.
+//!
+//! A [`Ring`] is created along with a [`Producer`] and a [`Consumer`] handle, which are `Send`, and can be moved
+//! to the lcores enqueueing and dequeueing mbufs, respectively.
+//! When a side of the ring uses a multi-thread [`SyncMode`], its handle can be cloned (see [`Producer::try_clone`]
+//! and [`Consumer::try_clone`]) to be used by several lcores concurrently.
+
+use std::{
+    ffi::CString,
+    fmt,
+    marker::PhantomData,
+    mem,
+    os::raw::c_void,
+    ptr::{self, NonNull},
+    sync::Arc,
+};
+
+use arrayvec::ArrayVec;
+use rte_error::ReturnValue as _;
+
+use crate::{
+    mbuf::{MBuf, OwnedMBuf},
+    memory::SocketId,
+    mempool::MemoryPool,
+    Result,
+};
+
+/// The synchronization mode of a side (producer or consumer) of a [`Ring`].
+///
+/// See also: <https://doc.dpdk.org/guides-21.08/prog_guide/ring_lib.html>
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum SyncMode {
+    /// Only a single thread enqueues (or dequeues) at a time: the cheapest mode.
+    Single,
+    /// Multiple threads may enqueue (or dequeue) concurrently, using the classic compare-and-swap based algorithm.
+    Multi,
+    /// Multiple threads, using the Relaxed Tail Sync mode, which behaves better than [`Self::Multi`]
+    /// in overcommitted scenarios (i.e. when the threads may be preempted).
+    MultiRelaxedTail,
+    /// Multiple threads, using the Head/Tail Sync mode, in which only one of the threads may access the ring at a time.
+    MultiHeadTail,
+}
+
+impl SyncMode {
+    #[inline]
+    fn producer_flags(self) -> u32 {
+        match self {
+            SyncMode::Single => ffi::RING_F_SP_ENQ,
+            SyncMode::Multi => 0,
+            SyncMode::MultiRelaxedTail => ffi::RING_F_MP_RTS_ENQ,
+            SyncMode::MultiHeadTail => ffi::RING_F_MP_HTS_ENQ,
+        }
+    }
+
+    #[inline]
+    fn consumer_flags(self) -> u32 {
+        match self {
+            SyncMode::Single => ffi::RING_F_SC_DEQ,
+            SyncMode::Multi => 0,
+            SyncMode::MultiRelaxedTail => ffi::RING_F_MC_RTS_DEQ,
+            SyncMode::MultiHeadTail => ffi::RING_F_MC_HTS_DEQ,
+        }
+    }
+}
+
+/// A fixed-size, lock-free FIFO of owned mbufs (either [`MBuf`]s or [`SharedMBuf`](crate::mbuf::SharedMBuf)s),
+/// allocated from a [`MemoryPool`] that outlives the ring.
+///
+/// Any mbufs remaining in the ring are freed when the ring is dropped, i.e. once both its [`Producer`] and [`Consumer`]
+/// handles (and all of their clones) have been dropped.
+///
+/// See also: <https://doc.dpdk.org/api-21.08/rte__ring_8h.html>
+pub struct Ring<'mempool, M = MBuf<&'mempool MemoryPool>>
+where
+    M: OwnedMBuf<Allocator = &'mempool MemoryPool>,
+{
+    ptr: NonNull<ffi::rte_ring>,
+    _marker: PhantomData<(M, &'mempool MemoryPool)>,
+}
+
+// # Safety
+// The ring's enqueue and dequeue operations are thread-safe, as specified by the sync mode of each side of the ring.
+// Single-threaded sides are guaranteed to be accessed by one thread at a time, since their handles can't be cloned and
+// enqueueing/dequeueing requires a mutable reference to the handle.
+// The mbufs themselves are owned by the ring while they're enqueued, and are allocated from a (thread-safe) memory pool.
+unsafe impl<'mempool, M> Send for Ring<'mempool, M> where M: OwnedMBuf<Allocator = &'mempool MemoryPool> {}
+unsafe impl<'mempool, M> Sync for Ring<'mempool, M> where M: OwnedMBuf<Allocator = &'mempool MemoryPool> {}
+
+impl<'mempool, M> Ring<'mempool, M>
+where
+    M: OwnedMBuf<Allocator = &'mempool MemoryPool>,
+{
+    /// Creates a new ring, which can hold up to `count` mbufs, allocated from on the given NUMA socket (or any socket).
+    ///
+    /// The ring is created with `RING_F_EXACT_SZ`, so `count` doesn't have to be a power of 2.
+    ///
+    /// Uses the [`ffi::rte_ring_create`] function under the hood.
+    ///
+    /// See also: <https://doc.dpdk.org/api-21.08/rte__ring_8h.html>
+    #[inline]
+    pub fn new<S: Into<Vec<u8>>>(
+        name: S,
+        count: u32,
+        socket_id: Option<SocketId>,
+        producer: SyncMode,
+        consumer: SyncMode,
+    ) -> Result<(Producer<'mempool, M>, Consumer<'mempool, M>)> {
+        let name = CString::new(name).unwrap();
+        let flags = ffi::RING_F_EXACT_SZ | producer.producer_flags() | consumer.consumer_flags();
+
+        let ptr = unsafe {
+            ffi::rte_ring_create(name.as_ptr(), count, socket_id.map(|id| id.get() as i32).unwrap_or(-1), flags)
+        }
+        .rte_ok()?;
+
+        let ring = Arc::new(Self { ptr, _marker: PhantomData });
+        Ok((Producer { ring: ring.clone(), mode: producer }, Consumer { ring, mode: consumer }))
+    }
+
+    /// Returns the number of mbufs the ring can hold.
+    #[inline]
+    pub fn capacity(&self) -> u32 {
+        unsafe { (*self.ptr.as_ptr()).capacity }
+    }
+
+    /// Returns the number of mbufs currently in the ring.
+    ///
+    /// Since the ring may be used concurrently, the returned value might already be out-of-date.
+    #[inline]
+    pub fn len(&self) -> u32 {
+        unsafe { ffi::_rte_ring_count(self.ptr.as_ptr()) }
+    }
+
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Returns the number of mbufs that can currently be enqueued on the ring.
+    ///
+    /// Since the ring may be used concurrently, the returned value might already be out-of-date.
+    #[inline]
+    pub fn free_count(&self) -> u32 {
+        unsafe { ffi::_rte_ring_free_count(self.ptr.as_ptr()) }
+    }
+
+    /// Enqueues mbufs from the start of `items`, removing the ones that were enqueued from it.
+    #[inline]
+    fn enqueue<const CAP: usize>(&self, items: &mut ArrayVec<M, CAP>, bulk: bool) -> usize {
+        let ring = self.ptr.as_ptr();
+        // `M` is a transparent wrapper around `NonNull<rte_mbuf>` (see `OwnedMBuf`)
+        let obj_table = items.as_ptr() as *const *mut c_void;
+        let n = items.len() as u32;
+
+        let enqueued = unsafe {
+            if bulk {
+                ffi::_rte_ring_enqueue_bulk(ring, obj_table, n, ptr::null_mut())
+            } else {
+                ffi::_rte_ring_enqueue_burst(ring, obj_table, n, ptr::null_mut())
+            }
+        } as usize;
+
+        // the ring assumes ownership of the mbufs that were enqueued, so they must not be dropped
+        items.drain(..enqueued).for_each(mem::forget);
+        enqueued
+    }
+
+    /// Dequeues mbufs into the spare capacity of `items`.
+    #[inline]
+    fn dequeue<const CAP: usize>(&self, items: &mut ArrayVec<M, CAP>, bulk: bool) -> usize {
+        let ring = self.ptr.as_ptr();
+        let len = items.len();
+
+        unsafe {
+            let obj_table = items.as_mut_ptr().add(len) as *mut *mut c_void;
+            let n = items.remaining_capacity() as u32;
+
+            let dequeued = if bulk {
+                ffi::_rte_ring_dequeue_bulk(ring, obj_table, n, ptr::null_mut())
+            } else {
+                ffi::_rte_ring_dequeue_burst(ring, obj_table, n, ptr::null_mut())
+            } as usize;
+
+            items.set_len(len + dequeued);
+            dequeued
+        }
+    }
+}
+
+impl<'mempool, M> fmt::Debug for Ring<'mempool, M>
+where
+    M: OwnedMBuf<Allocator = &'mempool MemoryPool>,
+{
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Ring").field("capacity", &self.capacity()).field("len", &self.len()).finish()
+    }
+}
+
+impl<'mempool, M> Drop for Ring<'mempool, M>
+where
+    M: OwnedMBuf<Allocator = &'mempool MemoryPool>,
+{
+    #[inline]
+    fn drop(&mut self) {
+        let mut remaining = ArrayVec::<M, 32>::new();
+        while self.dequeue(&mut remaining, false) > 0 {
+            remaining.clear();
+        }
+
+        unsafe { ffi::rte_ring_free(self.ptr.as_ptr()) }
+    }
+}
+
+/// The enqueueing side of a [`Ring`].
+pub struct Producer<'mempool, M = MBuf<&'mempool MemoryPool>>
+where
+    M: OwnedMBuf<Allocator = &'mempool MemoryPool>,
+{
+    ring: Arc<Ring<'mempool, M>>,
+    mode: SyncMode,
+}
+
+impl<'mempool, M> Producer<'mempool, M>
+where
+    M: OwnedMBuf<Allocator = &'mempool MemoryPool>,
+{
+    #[inline]
+    pub fn ring(&self) -> &Ring<'mempool, M> {
+        &self.ring
+    }
+
+    /// Returns another handle to the same ring, if the producer side of the ring is multi-threaded.
+    #[inline]
+    pub fn try_clone(&self) -> Option<Self> {
+        (self.mode != SyncMode::Single).then(|| Self { ring: self.ring.clone(), mode: self.mode })
+    }
+
+    /// Enqueues a single mbuf, returning it back if the ring is full.
+    #[inline]
+    pub fn enqueue(&mut self, item: M) -> std::result::Result<(), M> {
+        let mut items = ArrayVec::<M, 1>::new();
+        items.push(item);
+        self.ring.enqueue(&mut items, true);
+        items.pop().map_or(Ok(()), Err)
+    }
+
+    /// Enqueues as many mbufs from the start of `items` as the ring has room for.
+    ///
+    /// Mbufs that have been enqueued are removed from `items`, and the number of enqueued mbufs is returned.
+    /// Any mbufs remaining in `items` after this method has completed were NOT enqueued.
+    #[inline]
+    pub fn enqueue_burst<const CAP: usize>(&mut self, items: &mut ArrayVec<M, CAP>) -> usize {
+        self.ring.enqueue(items, false)
+    }
+
+    /// Enqueues all of `items`, or none of them if the ring doesn't have enough room.
+    ///
+    /// Returns `true` if the mbufs have been enqueued (in which case `items` is left empty).
+    #[inline]
+    pub fn enqueue_bulk<const CAP: usize>(&mut self, items: &mut ArrayVec<M, CAP>) -> bool {
+        self.ring.enqueue(items, true) > 0 || items.is_empty()
+    }
+}
+
+impl<'mempool, M> fmt::Debug for Producer<'mempool, M>
+where
+    M: OwnedMBuf<Allocator = &'mempool MemoryPool>,
+{
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Producer").field("ring", &self.ring).field("mode", &self.mode).finish()
+    }
+}
+
+/// The dequeueing side of a [`Ring`].
+pub struct Consumer<'mempool, M = MBuf<&'mempool MemoryPool>>
+where
+    M: OwnedMBuf<Allocator = &'mempool MemoryPool>,
+{
+    ring: Arc<Ring<'mempool, M>>,
+    mode: SyncMode,
+}
+
+impl<'mempool, M> Consumer<'mempool, M>
+where
+    M: OwnedMBuf<Allocator = &'mempool MemoryPool>,
+{
+    #[inline]
+    pub fn ring(&self) -> &Ring<'mempool, M> {
+        &self.ring
+    }
+
+    /// Returns another handle to the same ring, if the consumer side of the ring is multi-threaded.
+    #[inline]
+    pub fn try_clone(&self) -> Option<Self> {
+        (self.mode != SyncMode::Single).then(|| Self { ring: self.ring.clone(), mode: self.mode })
+    }
+
+    /// Dequeues a single mbuf, if the ring isn't empty.
+    #[inline]
+    pub fn dequeue(&mut self) -> Option<M> {
+        let mut items = ArrayVec::<M, 1>::new();
+        self.ring.dequeue(&mut items, true);
+        items.pop()
+    }
+
+    /// Dequeues up to `CAP - items.len()` mbufs, appending them to `items`.
+    ///
+    /// Returns the number of dequeued mbufs.
+    #[inline]
+    pub fn dequeue_burst<const CAP: usize>(&mut self, items: &mut ArrayVec<M, CAP>) -> usize {
+        self.ring.dequeue(items, false)
+    }
+
+    /// Fills the remaining capacity of `items` with mbufs from the ring, or dequeues none of them
+    /// if the ring doesn't contain enough mbufs.
+    ///
+    /// Returns the number of dequeued mbufs.
+    #[inline]
+    pub fn dequeue_bulk<const CAP: usize>(&mut self, items: &mut ArrayVec<M, CAP>) -> usize {
+        self.ring.dequeue(items, true)
+    }
+}
+
+impl<'mempool, M> fmt::Debug for Consumer<'mempool, M>
+where
+    M: OwnedMBuf<Allocator = &'mempool MemoryPool>,
+{
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Consumer").field("ring", &self.ring).field("mode", &self.mode).finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::thread;
+
+    use rte_test_macros::rte_test;
+
+    use super::*;
+
+    #[rte_test(mock_lcore)]
+    fn handoff_between_threads() {
+        let mempool =
+            MemoryPool::new("ring_test_pool", 256, 0, 0, ffi::RTE_MBUF_DEFAULT_BUF_SIZE as u16, None).unwrap();
+        let (mut producer, mut consumer) =
+            Ring::new("ring_test", 100, None, SyncMode::Single, SyncMode::Single).unwrap();
+        assert_eq!(producer.ring().capacity(), 100);
+        assert!(producer.try_clone().is_none());
+
+        let mut items = ArrayVec::<_, 8>::new();
+        for i in 0..8u8 {
+            items.push(MBuf::new_with_provider_and_data(&&mempool, [i]));
+        }
+        assert!(producer.enqueue_bulk(&mut items));
+        assert!(items.is_empty());
+
+        thread::scope(|s| {
+            s.spawn(|| {
+                let mut items = ArrayVec::<MBuf<&MemoryPool>, 8>::new();
+                assert_eq!(consumer.dequeue_burst(&mut items), 8);
+                assert!(items.iter().enumerate().all(|(i, mbuf)| mbuf[..] == [i as u8]));
+            });
+        });
+        assert!(consumer.ring().is_empty());
+    }
+}
@@ -0,0 +1,202 @@
+//! A higher-level runner for poll-loop workers, built on [`lcore::Id::spawn`]:
+//! - Worker closures can capture their environment, and their return values are collected by [`LcoreRuntime::join`].
+//! - [`assign_queues`] maps the queues of Ethernet devices to worker lcores on the same NUMA socket as the device,
+//!   since polling a queue from a remote socket costs a cross-socket access for every descriptor and packet.
+//! - All workers share a [`StopFlag`], which they should check once per iteration of their poll loop.
+
+use std::{
+    fmt,
+    sync::{
+        atomic::{AtomicBool, Ordering},
+        Arc,
+    },
+};
+
+use rte_error::Error;
+
+use crate::{ethdev::EthDev, launch::JoinHandle, lcore, memory::SocketId, Result};
+
+/// A flag shared by all workers of an [`LcoreRuntime`], signaling them to return from their poll loops.
+#[derive(Debug, Clone, Default)]
+pub struct StopFlag(Arc<AtomicBool>);
+
+impl StopFlag {
+    #[inline]
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    #[inline]
+    pub fn stop(&self) {
+        self.0.store(true, Ordering::Relaxed);
+    }
+
+    /// Returns `true` once [`Self::stop`] has been called, cheap enough to check on every poll.
+    #[inline(always)]
+    pub fn is_stopped(&self) -> bool {
+        self.0.load(Ordering::Relaxed)
+    }
+}
+
+/// A receive and transmit queue pair of an Ethernet device, assigned to a worker lcore by [`assign_queues`].
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct QueueAssignment {
+    pub lcore: lcore::Id,
+    pub dev: EthDev,
+    pub rx_queue: u16,
+    pub tx_queue: u16,
+}
+
+/// Assigns the first `nb_queues` queue pairs of each device to its own worker lcore, on the device's NUMA socket.
+///
+/// Queue pair `i` is made of RX queue `i` and TX queue `i`. Devices whose socket is unknown (see [`EthDev::socket_id`])
+/// are assigned lcores from any socket, after all other devices.
+/// Fails with `ENOSPC` if there aren't enough enabled worker lcores on a device's socket.
+#[inline]
+pub fn assign_queues(devs: &[EthDev], nb_queues: u16) -> Result<Vec<QueueAssignment>> {
+    let lcores = lcore::Id::iter_enabled(true).map(|id| (id, id.socket_id())).collect::<Vec<_>>();
+    let sockets = devs.iter().map(|dev| dev.socket_id().ok()).collect::<Vec<_>>();
+
+    let picked = pick_lcores(&sockets, nb_queues, &lcores).ok_or(Error(libc::ENOSPC))?;
+
+    Ok(picked
+        .into_iter()
+        .map(|(dev_idx, queue, lcore)| QueueAssignment {
+            lcore,
+            dev: devs[dev_idx].clone(),
+            rx_queue: queue,
+            tx_queue: queue,
+        })
+        .collect())
+}
+
+/// Returns `(device index, queue, lcore)` for every queue of every device, or `None` if there aren't enough lcores.
+fn pick_lcores(
+    sockets: &[Option<SocketId>],
+    nb_queues: u16,
+    lcores: &[(lcore::Id, Option<SocketId>)],
+) -> Option<Vec<(usize, u16, lcore::Id)>> {
+    let mut free = lcores.to_vec();
+    let mut picked = Vec::with_capacity(sockets.len() * usize::from(nb_queues));
+
+    // devices on a known socket go first, so that they aren't starved by devices that can use any lcore
+    let (known, unknown): (Vec<_>, Vec<_>) = sockets.iter().enumerate().partition(|(_, socket)| socket.is_some());
+    for (dev_idx, socket) in known.into_iter().chain(unknown) {
+        for queue in 0..nb_queues {
+            let pos = free.iter().position(|(_, lcore_socket)| socket.is_none() || lcore_socket == socket)?;
+            picked.push((dev_idx, queue, free.remove(pos).0));
+        }
+    }
+
+    picked.sort_unstable_by_key(|&(dev_idx, queue, _)| (dev_idx, queue));
+    Some(picked)
+}
+
+/// Runs closures on worker lcores, sharing a [`StopFlag`] between them, see the [module documentation](self).
+///
+/// Dropping the runtime without calling [`Self::join`] stops all workers and waits for them to return.
+///
+/// **NOTE:** should be used on main lcore only, see [`lcore::Id::spawn`].
+pub struct LcoreRuntime<R> {
+    stop: StopFlag,
+    workers: Vec<JoinHandle<R>>,
+}
+
+impl<R: Send + 'static> LcoreRuntime<R> {
+    #[inline]
+    pub fn new() -> Self {
+        Self { stop: StopFlag::new(), workers: Vec::new() }
+    }
+
+    /// Returns the flag that is shared by all workers.
+    #[inline]
+    pub fn stop_flag(&self) -> &StopFlag {
+        &self.stop
+    }
+
+    /// Runs a closure on the given worker lcore, passing it the runtime's stop flag.
+    #[inline]
+    pub fn spawn<F>(&mut self, lcore: lcore::Id, f: F) -> Result<()>
+    where
+        F: FnOnce(StopFlag) -> R + Send + 'static,
+    {
+        let stop = self.stop.clone();
+        self.workers.push(lcore.spawn(move || f(stop))?);
+        Ok(())
+    }
+
+    /// Runs a copy of a closure for each queue assignment (see [`assign_queues`]), on the assigned lcore.
+    #[inline]
+    pub fn spawn_assigned<I, F>(&mut self, assignments: I, f: F) -> Result<()>
+    where
+        I: IntoIterator<Item = QueueAssignment>,
+        F: FnOnce(QueueAssignment, StopFlag) -> R + Clone + Send + 'static,
+    {
+        for assignment in assignments {
+            let f = f.clone();
+            self.spawn(assignment.lcore, move |stop| f(assignment, stop))?;
+        }
+        Ok(())
+    }
+
+    /// Signals all workers to stop, see [`StopFlag`].
+    #[inline]
+    pub fn stop(&self) {
+        self.stop.stop();
+    }
+
+    /// Waits for all workers to return, and returns their return values in the order they were spawned.
+    ///
+    /// Note that this doesn't signal the workers to stop, see [`Self::stop`].
+    #[inline]
+    pub fn join(mut self) -> Vec<(lcore::Id, R)> {
+        self.workers.drain(..).map(|worker| (worker.lcore(), worker.join())).collect()
+    }
+}
+
+impl<R: Send + 'static> Default for LcoreRuntime<R> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<R> Drop for LcoreRuntime<R> {
+    fn drop(&mut self) {
+        if !self.workers.is_empty() {
+            self.stop.stop();
+            self.workers.drain(..).for_each(|worker| drop(worker.join()));
+        }
+    }
+}
+
+impl<R> fmt::Debug for LcoreRuntime<R> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        let lcores = self.workers.iter().map(JoinHandle::lcore).collect::<Vec<_>>();
+        f.debug_struct("LcoreRuntime").field("stopped", &self.stop.is_stopped()).field("lcores", &lcores).finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn socket(id: u32) -> Option<SocketId> {
+        SocketId::new(id)
+    }
+
+    #[test]
+    fn numa_local_assignment() {
+        let lcores = [(1, 0), (2, 0), (3, 1), (4, 1), (5, 1)].map(|(id, s)| (lcore::Id::new(id), socket(s)));
+
+        // one device per socket, plus a virtual device that fits in the remaining lcore
+        let picked = pick_lcores(&[socket(1), None, socket(0)], 1, &lcores).unwrap();
+        let picked = picked.into_iter().map(|(dev, queue, lcore)| (dev, queue, lcore.get())).collect::<Vec<_>>();
+        assert_eq!(picked, [(0, 0, 3), (1, 0, 2), (2, 0, 1)]);
+
+        let picked = pick_lcores(&[socket(1)], 3, &lcores).unwrap();
+        assert!(picked.iter().all(|(_, _, lcore)| lcore.get() >= 3));
+
+        // there are only 2 lcores on socket 0
+        assert!(pick_lcores(&[socket(0)], 3, &lcores).is_none());
+    }
+}